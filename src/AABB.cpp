@@ -11,6 +11,14 @@ AABB::AABB(const Mesh& mesh)
 	compute(mesh);
 }
 
+AABB::AABB(const glm::vec3& min, const glm::vec3& max)
+	: m_min(min)
+	, m_max(max)
+	, m_size(max - min)
+{
+
+}
+
 void AABB::compute(const Mesh& mesh)
 {
 	const std::vector<Vertex>& vertices = mesh.getVertices();
@@ -41,7 +49,33 @@ void AABB::compute(const Mesh& mesh)
 	m_size = m_max - m_min;
 }
 
+void AABB::extend(const glm::vec3& point)
+{
+	m_min = glm::min(m_min, point);
+	m_max = glm::max(m_max, point);
+
+	m_size = m_max - m_min;
+}
+
+void AABB::extend(const AABB& other)
+{
+	m_min = glm::min(m_min, other.m_min);
+	m_max = glm::max(m_max, other.m_max);
+
+	m_size = m_max - m_min;
+}
+
+glm::vec3 AABB::getCenter() const
+{
+	return (m_min + m_max) * 0.5f;
+}
+
 float AABB::getLongestSide() const
 {
 	return std::max({ m_size.x, m_size.y, m_size.z });
 }
+
+AABB AABB::getEmpty()
+{
+	return AABB(glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()));
+}
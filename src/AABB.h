@@ -17,6 +17,8 @@ public:
 
 	explicit AABB(const Mesh& mesh);
 
+	AABB(const glm::vec3& min, const glm::vec3& max);
+
 	AABB(const AABB& other) = default;
 
 	AABB(AABB&& other) = default;
@@ -29,6 +31,14 @@ public:
 
 	void compute(const Mesh& mesh);
 
+	void extend(const glm::vec3& point);
+
+	void extend(const AABB& other);
+
+	glm::vec3 getCenter() const;
+
 	float getLongestSide() const;
 
+	static AABB getEmpty(); //!<inverted box which any call to extend() turns into a valid one
+
 };
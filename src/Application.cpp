@@ -8,7 +8,8 @@ std::unique_ptr<MainWindow> Application::m_mainWindow;
 MouseEventHandler Application::m_mouseEventHandler;
 ConcurrencyHandler Application::m_concurrencyHandler;
 Heightmap Application::m_heightmap;
-Heightmap Application::m_heightmapOrig;
+std::shared_ptr<const Heightmap> Application::m_heightmapOrig = std::make_shared<const Heightmap>();
+HeightmapHistory Application::m_heightmapHistory;
 QVector<Application::MaterialTexture> Application::m_materialTextures;
 
 void Application::init(int& argc, char* argv[])
@@ -23,7 +24,7 @@ void Application::init(int& argc, char* argv[])
 	m_mainWindow = std::make_unique<MainWindow>();
 
 	MyGLWidget& glWidget = m_mainWindow->getGLWidget();
-	Renderer& renderer = glWidget.getRenderer();
+	RendererProxy& renderer = glWidget.getRenderer();
 
 	m_mouseEventHandler.init(&glWidget);
 	glWidget.installEventFilter(&m_mouseEventHandler);
@@ -32,13 +33,24 @@ void Application::init(int& argc, char* argv[])
 	QObject::connect(m_mainWindow.get(), &MainWindow::generateHeightmapPerlin, &m_concurrencyHandler, &ConcurrencyHandler::onGenerateHeightmapPerlin);
 	QObject::connect(m_mainWindow.get(), &MainWindow::generateHeightmapDiamond, &m_concurrencyHandler, &ConcurrencyHandler::onGenerateHeightmapDiamond);
 	QObject::connect(m_mainWindow.get(), &MainWindow::generateHeightmapFault, &m_concurrencyHandler, &ConcurrencyHandler::onGenerateHeightmapFault);
+	QObject::connect(m_mainWindow.get(), &MainWindow::erodeHeightmapHydraulic, &m_concurrencyHandler, &ConcurrencyHandler::onErodeHeightmapHydraulic);
+	QObject::connect(m_mainWindow.get(), &MainWindow::erodeHeightmapThermal, &m_concurrencyHandler, &ConcurrencyHandler::onErodeHeightmapThermal);
+	QObject::connect(m_mainWindow.get(), &MainWindow::fillDepressions, &m_concurrencyHandler, &ConcurrencyHandler::onFillDepressions);
+	QObject::connect(m_mainWindow.get(), &MainWindow::computeFlowAccumulation, &m_concurrencyHandler, &ConcurrencyHandler::onComputeFlowAccumulation);
 	QObject::connect(&m_concurrencyHandler, &ConcurrencyHandler::heightmapGenerated, m_mainWindow.get(), &MainWindow::onHeightmapGenerated);
+	QObject::connect(m_mainWindow.get(), &MainWindow::importHeightmap, &m_concurrencyHandler, &ConcurrencyHandler::onImportHeightmap);
+	QObject::connect(&m_concurrencyHandler, &ConcurrencyHandler::heightmapImported, m_mainWindow.get(), &MainWindow::onHeightmapImported);
 	QObject::connect(m_mainWindow.get(), &MainWindow::createMesh, &m_concurrencyHandler, &ConcurrencyHandler::onCreateMesh);
 	QObject::connect(&m_concurrencyHandler, &ConcurrencyHandler::meshCreated, m_mainWindow.get(), &MainWindow::onMeshCreated);
 	QObject::connect(m_mainWindow.get(), &MainWindow::loadMesh, &m_concurrencyHandler, &ConcurrencyHandler::onLoadMesh);
 	QObject::connect(&m_concurrencyHandler, &ConcurrencyHandler::meshLoaded, m_mainWindow.get(), &MainWindow::onMeshLoaded);
 	QObject::connect(m_mainWindow.get(), &MainWindow::saveMesh, &m_concurrencyHandler, &ConcurrencyHandler::onSaveMesh);
+	QObject::connect(m_mainWindow.get(), &MainWindow::saveMeshTiles, &m_concurrencyHandler, &ConcurrencyHandler::onSaveMeshTiles);
 	QObject::connect(&m_concurrencyHandler, &ConcurrencyHandler::meshSaved, m_mainWindow.get(), &MainWindow::onMeshSaved);
+	QObject::connect(m_mainWindow.get(), &MainWindow::loadTexture, &m_concurrencyHandler, &ConcurrencyHandler::onLoadTexture);
+	QObject::connect(&m_concurrencyHandler, &ConcurrencyHandler::textureLoaded, m_mainWindow.get(), &MainWindow::onTextureLoaded);
+	QObject::connect(m_mainWindow.get(), &MainWindow::applyHeightExponent, &m_concurrencyHandler, &ConcurrencyHandler::onApplyHeightExponent);
+	QObject::connect(&m_concurrencyHandler, &ConcurrencyHandler::heightExponentApplied, m_mainWindow.get(), &MainWindow::onHeightExponentApplied);
 
 	std::string vs1 = FileLoader::loadFile(":/shaders/terrain.vert");
 	std::string fs1 = FileLoader::loadFile(":/shaders/terrain.frag");
@@ -7,14 +7,18 @@
 #include <QString>
 #include <QVector>
 
+#include <memory>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "ConcurrencyHandler.h"
 #include "Heightmap.h"
+#include "HeightmapHistory.h"
 #include "MainWindow.h"
 #include "MouseEventHandler.h"
+#include "TextureImage.h"
 
 class Application
 {
@@ -25,6 +29,8 @@ public:
 	{
 		QImage m_image;
 		QString m_filename;
+		QColor m_averageColor;
+		TextureImage m_textureImage; //!<m_image scaled, mipmapped and encoded for the array texture
 	};
 
 	static bool m_initialized;
@@ -33,7 +39,8 @@ public:
 	static MouseEventHandler m_mouseEventHandler;
 	static ConcurrencyHandler m_concurrencyHandler;
 	static Heightmap m_heightmap;
-	static Heightmap m_heightmapOrig;
+	static std::shared_ptr<const Heightmap> m_heightmapOrig; //!<shared with running height exponent requests, replaced as a whole, null after undo or redo until the exponent needs it
+	static HeightmapHistory m_heightmapHistory; //!<states of m_heightmap after each operation, without the height exponent preview
 	static QVector<MaterialTexture> m_materialTextures;
 
 	static void init(int& argc, char* argv[]);
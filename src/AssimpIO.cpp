@@ -3,12 +3,32 @@
 #include <assimp/Exporter.hpp>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
 #include "AssimpIO.h"
+#include "MeshCache.h"
+#include "MeshWriter.h"
+#include "Parallel.h"
 
-std::vector<Mesh> AssimpIO::loadModel(const std::string& filename)
+std::vector<Mesh> AssimpIO::loadModel(const std::string& filename, bool mergeMeshes)
 {
 	std::vector<Mesh> meshes;
 
+	//cache files are mapped and copied, only the bounding volume hierarchy is rebuilt
+
+	if (isCacheFile(filename))
+	{
+		Mesh mesh;
+		if (MeshCache::load(filename, mesh))
+		{
+			meshes.push_back(std::move(mesh));
+		}
+
+		return meshes;
+	}
+
 	Assimp::Importer import;
 	const aiScene* scene = import.ReadFile(filename, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
 
@@ -17,7 +37,80 @@ std::vector<Mesh> AssimpIO::loadModel(const std::string& filename)
 		return meshes;
 	}
 
-	meshes = processNode(scene->mRootNode, scene);
+	std::vector<MeshInstance> instances = collectMeshInstances(scene);
+
+	if (instances.empty())
+	{
+		return meshes;
+	}
+
+	if (!mergeMeshes)
+	{
+		meshes.resize(instances.size());
+
+		Parallel::forRange(static_cast<int>(instances.size()), [&instances, &meshes](int begin, int end)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				const aiMesh* mesh = instances[i].m_mesh;
+
+				std::vector<Vertex> vertices(mesh->mNumVertices);
+				std::vector<int> indices(3 * getTriangleCount(mesh));
+				std::vector<glm::vec2> uvs(mesh->HasTextureCoords(0) ? mesh->mNumVertices : 0);
+
+				convertMesh(instances[i], vertices.data(), indices.data(), uvs.empty() ? nullptr : uvs.data());
+
+				meshes[i].set(std::move(vertices), std::move(indices), std::move(uvs), mesh->HasNormals());
+			}
+		});
+
+		//meshes without triangles stay empty
+
+		meshes.erase(std::remove_if(meshes.begin(), meshes.end(), [](const Mesh& mesh) { return mesh.empty(); }), meshes.end());
+
+		return meshes;
+	}
+
+	//every instance gets its own range of the merged buffers, so they can be filled concurrently
+
+	int vertexCount = 0;
+	int indexCount = 0;
+	bool allHaveNormals = true;
+	bool allHaveUVs = true;
+
+	for (MeshInstance& instance : instances)
+	{
+		instance.m_firstVertex = vertexCount;
+		instance.m_firstIndex = indexCount;
+
+		vertexCount += instance.m_mesh->mNumVertices;
+		indexCount += 3 * getTriangleCount(instance.m_mesh);
+		allHaveNormals = allHaveNormals && instance.m_mesh->HasNormals();
+		allHaveUVs = allHaveUVs && instance.m_mesh->HasTextureCoords(0);
+	}
+
+	std::vector<Vertex> vertices(vertexCount);
+	std::vector<int> indices(indexCount);
+	std::vector<glm::vec2> uvs(allHaveUVs ? vertexCount : 0);
+
+	Parallel::forRange(static_cast<int>(instances.size()), [&instances, &vertices, &indices, &uvs](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const MeshInstance& instance = instances[i];
+
+			convertMesh(instance,
+				vertices.data() + instance.m_firstVertex,
+				indices.data() + instance.m_firstIndex,
+				uvs.empty() ? nullptr : uvs.data() + instance.m_firstVertex);
+		}
+	});
+
+	Mesh mesh;
+	if (mesh.set(std::move(vertices), std::move(indices), std::move(uvs), allHaveNormals))
+	{
+		meshes.push_back(std::move(mesh));
+	}
 
 	return meshes;
 }
@@ -28,6 +121,18 @@ bool AssimpIO::saveMesh(const Mesh& mesh, const std::string& filename, const std
 	{
 		return false;
 	}
+
+	//the common formats are streamed straight from the mesh, building an aiScene would copy it twice
+
+	if (MeshWriter::isSupported(formatId))
+	{
+		return MeshWriter::save(mesh, filename, formatId);
+	}
+
+	if (formatId == MeshCache::FORMAT_ID)
+	{
+		return MeshCache::save(mesh, filename);
+	}
 	
 	aiScene scene;
 
@@ -111,6 +216,8 @@ std::vector<std::string> AssimpIO::getImportExtensions()
 		}
 	}
 
+	extensions.push_back(std::string("*.") + MeshCache::FORMAT_ID);
+
 	return extensions;
 }
 
@@ -129,56 +236,117 @@ std::vector<AssimpIO::ExportFormat> AssimpIO::getExportFormats()
 		formats.push_back(format);
 	}
 
+	ExportFormat cacheFormat;
+	cacheFormat.id = MeshCache::FORMAT_ID;
+	cacheFormat.description = "Terrain mesh cache";
+	cacheFormat.extension = MeshCache::FORMAT_ID;
+	formats.push_back(cacheFormat);
+
 	return formats;
 }
 
-std::vector<Mesh> AssimpIO::processNode(aiNode* node, const aiScene* scene)
+bool AssimpIO::isCacheFile(const std::string& filename)
 {
-	std::vector<Mesh> meshes;
-	meshes.reserve(node->mNumMeshes);
+	std::string extension = std::string(".") + MeshCache::FORMAT_ID;
 
-	for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+	if (filename.size() < extension.size())
 	{
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(processMesh(mesh, scene));
+		return false;
 	}
 
-	for (unsigned int i = 0; i < node->mNumChildren; ++i)
+	std::string fileExtension = filename.substr(filename.size() - extension.size());
+	std::transform(fileExtension.begin(), fileExtension.end(), fileExtension.begin(), [](unsigned char c)
 	{
-		std::vector<Mesh> meshes2 = processNode(node->mChildren[i], scene);
-		meshes.insert(meshes.end(), meshes2.begin(), meshes2.end());
-	}
+		return static_cast<char>(std::tolower(c));
+	});
 
-	return meshes;
+	return fileExtension == extension;
 }
 
-Mesh AssimpIO::processMesh(aiMesh* mesh, const aiScene* scene)
+std::vector<AssimpIO::MeshInstance> AssimpIO::collectMeshInstances(const aiScene* scene)
 {
-	std::vector<Vertex> vertices;
-	vertices.reserve(mesh->mNumVertices);
-	
-	for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
+	std::vector<MeshInstance> instances;
+
+	std::vector<std::pair<const aiNode*, aiMatrix4x4>> pendingNodes;
+	pendingNodes.push_back(std::make_pair(scene->mRootNode, scene->mRootNode->mTransformation));
+
+	while (!pendingNodes.empty())
 	{
-		Vertex vertex;
+		const aiNode* node = pendingNodes.back().first;
+		aiMatrix4x4 transform = pendingNodes.back().second;
+		pendingNodes.pop_back();
 
-		vertex.m_position.x = mesh->mVertices[i].x;
-		vertex.m_position.y = mesh->mVertices[i].y;
-		vertex.m_position.z = mesh->mVertices[i].z;
+		for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+		{
+			MeshInstance instance;
+			instance.m_mesh = scene->mMeshes[node->mMeshes[i]];
+			instance.m_transform = transform;
+			instances.push_back(instance);
+		}
 
-		vertices.push_back(vertex);
+		for (unsigned int i = 0; i < node->mNumChildren; ++i)
+		{
+			const aiNode* child = node->mChildren[i];
+			pendingNodes.push_back(std::make_pair(child, transform * child->mTransformation));
+		}
 	}
 
-	std::vector<int> indices;
-	indices.reserve(3 * mesh->mNumFaces);
+	return instances;
+}
+
+int AssimpIO::getTriangleCount(const aiMesh* mesh)
+{
+	int triangleCount = 0;
 
 	for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
 	{
-		indices.push_back(mesh->mFaces[i].mIndices[0]);
-		indices.push_back(mesh->mFaces[i].mIndices[1]);
-		indices.push_back(mesh->mFaces[i].mIndices[2]);
+		if (mesh->mFaces[i].mNumIndices == 3)
+		{
+			triangleCount++;
+		}
+	}
+
+	return triangleCount;
+}
+
+void AssimpIO::convertMesh(const MeshInstance& instance, Vertex* vertices, int* indices, glm::vec2* uvs)
+{
+	const aiMesh* mesh = instance.m_mesh;
+
+	bool transformed = !instance.m_transform.IsIdentity();
+
+	//normals are transformed by the inverse transpose, so that non-uniform scaling keeps them perpendicular
+
+	aiMatrix3x3 normalTransform = aiMatrix3x3(instance.m_transform);
+	normalTransform.Inverse().Transpose();
+
+	for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
+	{
+		aiVector3D position = transformed ? instance.m_transform * mesh->mVertices[i] : mesh->mVertices[i];
+		vertices[i].m_position = glm::vec3(position.x, position.y, position.z);
+
+		if (mesh->HasNormals())
+		{
+			aiVector3D normal = transformed ? (normalTransform * mesh->mNormals[i]).Normalize() : mesh->mNormals[i];
+			vertices[i].m_normal = glm::vec3(normal.x, normal.y, normal.z);
+		}
+
+		if (uvs != nullptr)
+		{
+			uvs[i] = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+		}
 	}
 
-	Mesh mmesh = Mesh(vertices, indices, 1);
+	for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+	{
+		const aiFace& face = mesh->mFaces[i];
 
-	return mmesh;
+		if (face.mNumIndices == 3)
+		{
+			indices[0] = instance.m_firstVertex + static_cast<int>(face.mIndices[0]);
+			indices[1] = instance.m_firstVertex + static_cast<int>(face.mIndices[1]);
+			indices[2] = instance.m_firstVertex + static_cast<int>(face.mIndices[2]);
+			indices += 3;
+		}
+	}
 }
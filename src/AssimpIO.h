@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include <assimp/scene.h>
@@ -18,18 +19,42 @@ public:
 		std::string extension;
 	};
 
-	static std::vector<Mesh> loadModel(const std::string& filename);
+	/** \brief Imports the meshes of all nodes of a model file, placed by the node transformations.
+	*          Normals and texture coordinates of the file are kept, the meshes are converted in parallel.
+	*          MeshCache files are read without Assimp and always give one mesh.
+	*   \param mergeMeshes Returns one mesh containing all meshes of the file instead of one mesh per node mesh.
+	*/
+	static std::vector<Mesh> loadModel(const std::string& filename, bool mergeMeshes = false);
 
 	static bool saveMesh(const Mesh& mesh, const std::string& filename, const std::string& formatId);
 
 	static std::vector<std::string> getImportExtensions();
 
+	//!<the formats of Assimp followed by the MeshCache format
 	static std::vector<ExportFormat> getExportFormats();
 
 private:
 
-	static std::vector<Mesh> processNode(aiNode* node, const aiScene* scene);
+	//!<true if the file has the extension of MeshCache files
+	static bool isCacheFile(const std::string& filename);
 
-	static Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+	struct MeshInstance
+	{
+		const aiMesh* m_mesh = nullptr;
+		aiMatrix4x4 m_transform; //!<from the mesh to the root of the scene
+		int m_firstVertex = 0; //!<position of the instance in a merged mesh
+		int m_firstIndex = 0;
+	};
+
+	//!<walks the node tree without recursion, a mesh referenced by several nodes is returned once per node
+	static std::vector<MeshInstance> collectMeshInstances(const aiScene* scene);
+
+	//!<triangles of the mesh, points and lines are skipped
+	static int getTriangleCount(const aiMesh* mesh);
+
+	/** \brief Writes the transformed vertices and the triangles of one instance.
+	*   \param uvs Receives the first set of texture coordinates, can be null.
+	*/
+	static void convertMesh(const MeshInstance& instance, Vertex* vertices, int* indices, glm::vec2* uvs);
 
 };
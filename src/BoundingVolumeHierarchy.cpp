@@ -0,0 +1,154 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <algorithm>
+#include <numeric>
+
+void BoundingVolumeHierarchy::build(const std::vector<AABB>& leafBoxes)
+{
+	m_nodes.clear();
+	m_leafBoxes = leafBoxes;
+	m_leafOrder.resize(leafBoxes.size());
+	std::iota(m_leafOrder.begin(), m_leafOrder.end(), 0);
+
+	if (leafBoxes.empty())
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centers;
+	centers.reserve(leafBoxes.size());
+	for (const AABB& bbox : leafBoxes)
+	{
+		centers.push_back(bbox.getCenter());
+	}
+
+	m_nodes.reserve(2 * (leafBoxes.size() / MAX_LEAVES_PER_NODE + 1));
+	buildNode(0, leafBoxes.size(), centers);
+}
+
+void BoundingVolumeHierarchy::refit(const std::vector<AABB>& leafBoxes)
+{
+	if (leafBoxes.size() != m_leafBoxes.size())
+	{
+		build(leafBoxes);
+		return;
+	}
+
+	m_leafBoxes = leafBoxes;
+
+	for (auto it = m_nodes.rbegin(); it != m_nodes.rend(); ++it)
+	{
+		Node& node = *it;
+
+		if (node.m_left == -1)
+		{
+			node.m_bbox = AABB::getEmpty();
+			for (int i = node.m_first; i < node.m_first + node.m_count; ++i)
+			{
+				node.m_bbox.extend(m_leafBoxes[m_leafOrder[i]]);
+			}
+		}
+		else
+		{
+			node.m_bbox = m_nodes[node.m_left].m_bbox;
+			node.m_bbox.extend(m_nodes[node.m_right].m_bbox);
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::cull(const Frustum& frustum, std::vector<int>& visibleLeaves) const
+{
+	visibleLeaves.clear();
+
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+
+		Frustum::Containment containment = frustum.classify(node.m_bbox);
+
+		if (containment == Frustum::Containment::OUTSIDE)
+		{
+			continue;
+		}
+
+		if (containment == Frustum::Containment::INSIDE)
+		{
+			visibleLeaves.insert(visibleLeaves.end(), m_leafOrder.begin() + node.m_first, m_leafOrder.begin() + node.m_first + node.m_count);
+		}
+		else if (node.m_left == -1)
+		{
+			for (int i = node.m_first; i < node.m_first + node.m_count; ++i)
+			{
+				if (frustum.intersects(m_leafBoxes[m_leafOrder[i]]))
+				{
+					visibleLeaves.push_back(m_leafOrder[i]);
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.m_right;
+			stack[stackSize++] = node.m_left;
+		}
+	}
+
+	std::sort(visibleLeaves.begin(), visibleLeaves.end());
+}
+
+const std::vector<BoundingVolumeHierarchy::Node>& BoundingVolumeHierarchy::getNodes() const
+{
+	return m_nodes;
+}
+
+bool BoundingVolumeHierarchy::empty() const
+{
+	return m_nodes.empty();
+}
+
+int BoundingVolumeHierarchy::buildNode(int first, int count, std::vector<glm::vec3>& centers)
+{
+	int nodeIndex = m_nodes.size();
+	m_nodes.emplace_back();
+
+	Node node;
+	node.m_first = first;
+	node.m_count = count;
+	node.m_bbox = AABB::getEmpty();
+
+	AABB centerBounds = AABB::getEmpty();
+	for (int i = first; i < first + count; ++i)
+	{
+		node.m_bbox.extend(m_leafBoxes[m_leafOrder[i]]);
+		centerBounds.extend(centers[m_leafOrder[i]]);
+	}
+
+	if (count > MAX_LEAVES_PER_NODE)
+	{
+		int axis = 0;
+		if (centerBounds.m_size.y > centerBounds.m_size[axis]) axis = 1;
+		if (centerBounds.m_size.z > centerBounds.m_size[axis]) axis = 2;
+
+		int half = count / 2;
+		std::nth_element(
+			m_leafOrder.begin() + first,
+			m_leafOrder.begin() + first + half,
+			m_leafOrder.begin() + first + count,
+			[&centers, axis](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+
+		node.m_left = buildNode(first, half, centers);
+		node.m_right = buildNode(first + half, count - half, centers);
+	}
+
+	m_nodes[nodeIndex] = node;
+
+	return nodeIndex;
+}
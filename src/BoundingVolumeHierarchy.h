@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "AABB.h"
+#include "Frustum.h"
+
+/** \brief Binary tree of bounding boxes over the chunks of a mesh.
+*          Every node stores the box of all chunks below it, so its m_min.y and m_max.y
+*          are the minimum and maximum height of that part of the terrain.
+*/
+class BoundingVolumeHierarchy
+{
+
+public:
+
+	struct Node
+	{
+		AABB m_bbox;
+		int m_left = -1; //!<index of the left child, -1 for leaves
+		int m_right = -1; //!<index of the right child, -1 for leaves
+		int m_first = 0; //!<first position in the leaf order covered by this node
+		int m_count = 0; //!<number of leaves covered by this node
+	};
+
+	static constexpr int MAX_LEAVES_PER_NODE = 4;
+
+	BoundingVolumeHierarchy() = default;
+
+	BoundingVolumeHierarchy(const BoundingVolumeHierarchy& other) = default;
+
+	BoundingVolumeHierarchy(BoundingVolumeHierarchy&& other) = default;
+
+	BoundingVolumeHierarchy& operator=(const BoundingVolumeHierarchy& other) = default;
+
+	BoundingVolumeHierarchy& operator=(BoundingVolumeHierarchy&& other) = default;
+
+	~BoundingVolumeHierarchy() = default;
+
+	/** \brief Builds the tree top-down by median splits along the longest axis.
+	*   \param leafBoxes Bounding box of every leaf (mesh chunk).
+	*/
+	void build(const std::vector<AABB>& leafBoxes);
+
+	/** \brief Recomputes the node boxes bottom-up without changing the topology.
+	*   \param leafBoxes New bounding boxes, in the same order as passed to build().
+	*/
+	void refit(const std::vector<AABB>& leafBoxes);
+
+	/** \brief Collects all leaves whose boxes intersect the frustum.
+	*   \param frustum Frustum to test against.
+	*   \param visibleLeaves Receives the indices of visible leaves in ascending order.
+	*/
+	void cull(const Frustum& frustum, std::vector<int>& visibleLeaves) const;
+
+	const std::vector<Node>& getNodes() const;
+
+	bool empty() const;
+
+private:
+
+	std::vector<Node> m_nodes; //!<parents always precede their children
+	std::vector<int> m_leafOrder; //!<leaf indices, every node covers a contiguous range
+	std::vector<AABB> m_leafBoxes;
+
+	int buildNode(int first, int count, std::vector<glm::vec3>& centers);
+};
@@ -1,6 +1,13 @@
 
 #include "ConcurrencyHandler.h"
 
+#include <utility>
+#include <vector>
+
+#include "DEMImporter.h"
+#include "HeightmapFilter.h"
+#include "Utility.h"
+
 ConcurrencyHandler::ConcurrencyHandler(QObject* parent)
 	: QObject(parent)
 {
@@ -27,6 +34,11 @@ bool ConcurrencyHandler::isGeneratingHeightmap() const
 	return m_generateHeightmapFuture.isRunning();
 }
 
+bool ConcurrencyHandler::isImportingHeightmap() const
+{
+	return m_importHeightmapFuture.isRunning();
+}
+
 bool ConcurrencyHandler::isCreatingMesh() const
 {
 	return m_createMeshFuture.isRunning();
@@ -42,6 +54,16 @@ bool ConcurrencyHandler::isSavingMesh() const
 	return m_saveMeshFuture.isRunning();
 }
 
+bool ConcurrencyHandler::isLoadingTexture() const
+{
+	return m_loadTextureFuture.isRunning();
+}
+
+bool ConcurrencyHandler::isApplyingHeightExponent() const
+{
+	return m_heightExponentFuture.isRunning() || m_pendingExponentSource != nullptr;
+}
+
 void ConcurrencyHandler::onGenerateHeightmapCircles(int width, int height, int minRadius, int maxRadius, int minAmplitude, int maxAmplitude, int iterations)
 {
 	if (m_connected == false)
@@ -106,6 +128,68 @@ void ConcurrencyHandler::onGenerateHeightmapFault(int width, int height, int ite
 	m_generateHeightmapFutureWatcher.setFuture(m_generateHeightmapFuture);
 }
 
+void ConcurrencyHandler::onErodeHeightmapHydraulic(const Heightmap& heightmap, int dropletCount, int seed)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_generateHeightmapFuture = QtConcurrent::run([heightmap, dropletCount, seed]()
+	{
+		return HydraulicErosion::erode(heightmap, dropletCount, static_cast<uint32_t>(seed));
+	});
+
+	m_generateHeightmapFutureWatcher.setFuture(m_generateHeightmapFuture);
+}
+
+void ConcurrencyHandler::onErodeHeightmapThermal(const Heightmap& heightmap, int iterations, float talus)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_generateHeightmapFuture = QtConcurrent::run([heightmap, iterations, talus]()
+	{
+		return ThermalErosion::erode(heightmap, iterations, talus);
+	});
+
+	m_generateHeightmapFutureWatcher.setFuture(m_generateHeightmapFuture);
+}
+
+void ConcurrencyHandler::onFillDepressions(const Heightmap& heightmap)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_generateHeightmapFuture = QtConcurrent::run([heightmap]()
+	{
+		return FlowAnalysis::fillDepressions(heightmap);
+	});
+
+	m_generateHeightmapFutureWatcher.setFuture(m_generateHeightmapFuture);
+}
+
+void ConcurrencyHandler::onComputeFlowAccumulation(const Heightmap& heightmap)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_generateHeightmapFuture = QtConcurrent::run([heightmap]()
+	{
+		Heightmap accumulation = FlowAnalysis::computeFlowAccumulation(FlowAnalysis::fillDepressions(heightmap));
+		FlowAnalysis::scaleLogarithmic(accumulation);
+		return accumulation;
+	});
+
+	m_generateHeightmapFutureWatcher.setFuture(m_generateHeightmapFuture);
+}
+
 void ConcurrencyHandler::onCreateMesh(const Heightmap& heightmap)
 {
 	if (m_connected == false)
@@ -121,6 +205,30 @@ void ConcurrencyHandler::onCreateMesh(const Heightmap& heightmap)
 	m_createMeshFutureWatcher.setFuture(m_createMeshFuture);
 }
 
+void ConcurrencyHandler::onImportHeightmap(const std::string& filename)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_importHeightmapFuture = QtConcurrent::run([filename]()
+	{
+		Heightmap heightmap = DEMImporter::load(filename);
+
+		//elevations are scaled to 0..1 like the samples of an image, the mesh height sets the vertical scale
+
+		if (heightmap.getMax() > heightmap.getMin())
+		{
+			heightmap.normalize();
+		}
+
+		return heightmap;
+	});
+
+	m_importHeightmapFutureWatcher.setFuture(m_importHeightmapFuture);
+}
+
 void ConcurrencyHandler::onLoadMesh(const std::string& filename)
 {
 	if (m_connected == false)
@@ -130,7 +238,8 @@ void ConcurrencyHandler::onLoadMesh(const std::string& filename)
 
 	m_loadMeshFuture = QtConcurrent::run([filename]()
 	{
-		return AssimpIO::loadModel(filename);
+		//only one mesh is shown, so all meshes of the file are merged into it
+		return AssimpIO::loadModel(filename, true);
 	});
 
 	m_loadMeshFutureWatcher.setFuture(m_loadMeshFuture);
@@ -139,9 +248,12 @@ void ConcurrencyHandler::onLoadMesh(const std::string& filename)
 void ConcurrencyHandler::connect()
 {
 	QObject::connect(&m_generateHeightmapFutureWatcher, &QFutureWatcher<Heightmap>::finished, this, &ConcurrencyHandler::onHeightmapGenerated);
+	QObject::connect(&m_importHeightmapFutureWatcher, &QFutureWatcher<Heightmap>::finished, this, &ConcurrencyHandler::onHeightmapImported);
 	QObject::connect(&m_createMeshFutureWatcher, &QFutureWatcher<Mesh>::finished, this, &ConcurrencyHandler::onMeshCreated);
 	QObject::connect(&m_loadMeshFutureWatcher, &QFutureWatcher<bool>::finished, this, &ConcurrencyHandler::onMeshLoaded);
 	QObject::connect(&m_saveMeshFutureWatcher, &QFutureWatcher<bool>::finished, this, &ConcurrencyHandler::onMeshSaved);
+	QObject::connect(&m_loadTextureFutureWatcher, &QFutureWatcher<LoadedTexture>::finished, this, &ConcurrencyHandler::onTextureLoaded);
+	QObject::connect(&m_heightExponentFutureWatcher, &QFutureWatcher<RemappedHeightmap>::finished, this, &ConcurrencyHandler::onHeightExponentApplied);
 
 	m_connected = true;
 }
@@ -161,11 +273,82 @@ void ConcurrencyHandler::onSaveMesh(const Mesh& mesh, const std::string& filenam
 	m_saveMeshFutureWatcher.setFuture(m_saveMeshFuture);
 }
 
+void ConcurrencyHandler::onSaveMeshTiles(const Heightmap& heightmap, float heightOffset, float heightScale, int columns, int rows, const std::string& filename, const std::string& exportFormatId, const std::string& extension)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_saveMeshFuture = QtConcurrent::run([heightmap, heightOffset, heightScale, columns, rows, filename, exportFormatId, extension]()
+	{
+		return TileExporter::save(heightmap, heightOffset, heightScale, columns, rows, filename, exportFormatId, extension);
+	});
+
+	m_saveMeshFutureWatcher.setFuture(m_saveMeshFuture);
+}
+
+void ConcurrencyHandler::onLoadTexture(const QString& filename, int layerIndex, const QVector<QImage>& layerImages, const QSize& textureSize, GLenum textureFormat)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_loadTextureFuture = QtConcurrent::run([filename, layerIndex, layerImages, textureSize, textureFormat]()
+	{
+		return TextureLoader::load(filename, layerIndex, layerImages, textureSize, textureFormat);
+	});
+
+	m_loadTextureFutureWatcher.setFuture(m_loadTextureFuture);
+}
+
+void ConcurrencyHandler::onApplyHeightExponent(std::shared_ptr<const Heightmap> source, float exponent)
+{
+	if (m_connected == false)
+	{
+		connect();
+	}
+
+	m_pendingExponentSource = source;
+	m_pendingExponent = exponent;
+
+	if (!m_heightExponentFuture.isRunning())
+	{
+		startHeightExponent();
+	}
+}
+
+void ConcurrencyHandler::startHeightExponent()
+{
+	std::shared_ptr<const Heightmap> source = m_pendingExponentSource;
+	float exponent = m_pendingExponent;
+	m_pendingExponentSource = nullptr;
+
+	m_heightExponentFuture = QtConcurrent::run([source, exponent]()
+	{
+		RemappedHeightmap result;
+		result.m_source = source;
+		result.m_heightmap = HeightmapFilter::applyExponent(*source, exponent);
+		result.m_image = Utility::heightmapToQImage(result.m_heightmap);
+		result.m_min = result.m_heightmap.getMin();
+		result.m_max = result.m_heightmap.getMax();
+		return result;
+	});
+
+	m_heightExponentFutureWatcher.setFuture(m_heightExponentFuture);
+}
+
 void ConcurrencyHandler::onHeightmapGenerated()
 {
 	emit heightmapGenerated(m_generateHeightmapFuture.result());
 }
 
+void ConcurrencyHandler::onHeightmapImported()
+{
+	emit heightmapImported(m_importHeightmapFuture.result());
+}
+
 void ConcurrencyHandler::onMeshSaved()
 {
 	emit meshSaved(m_saveMeshFuture.result());
@@ -179,11 +362,30 @@ void ConcurrencyHandler::onMeshCreated()
 void ConcurrencyHandler::onMeshLoaded()
 {
 	Mesh mesh;
+	std::vector<Mesh> meshes = m_loadMeshFuture.result();
 	
-	if (!m_loadMeshFuture.result().empty())
+	if (!meshes.empty())
 	{
-		mesh = m_loadMeshFuture.result()[0];
+		mesh = std::move(meshes[0]);
 	}
 
 	emit meshLoaded(mesh);
 }
+
+void ConcurrencyHandler::onTextureLoaded()
+{
+	emit textureLoaded(m_loadTextureFuture.result());
+}
+
+void ConcurrencyHandler::onHeightExponentApplied()
+{
+	//a newer request makes this result obsolete, it is dropped and the newest one is started instead
+
+	if (m_pendingExponentSource != nullptr)
+	{
+		startHeightExponent();
+		return;
+	}
+
+	emit heightExponentApplied(m_heightExponentFuture.result());
+}
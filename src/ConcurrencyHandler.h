@@ -1,10 +1,28 @@
 #pragma once
 
+#include <QImage>
 #include <QObject>
 #include <QtConcurrent>
 
+#include <memory>
+
 #include "AssimpIO.h"
+#include "FlowAnalysis.h"
 #include "HeightmapGenerator.h"
+#include "HydraulicErosion.h"
+#include "TextureLoader.h"
+#include "ThermalErosion.h"
+#include "TileExporter.h"
+
+//!<result of a height exponent request, m_source tells which heightmap it was computed from
+struct RemappedHeightmap
+{
+	std::shared_ptr<const Heightmap> m_source;
+	Heightmap m_heightmap;
+	QImage m_image;
+	float m_min = 0.0f; //!<height drawn black in m_image
+	float m_max = 0.0f; //!<height drawn white in m_image
+};
 
 class ConcurrencyHandler : public QObject
 {
@@ -27,12 +45,18 @@ public:
 
 	bool isGeneratingHeightmap() const;
 
+	bool isImportingHeightmap() const;
+
 	bool isCreatingMesh() const;
 
 	bool isLoadingMesh() const;
 
 	bool isSavingMesh() const;
 
+	bool isLoadingTexture() const;
+
+	bool isApplyingHeightExponent() const;
+
 public slots:
 
 	void onGenerateHeightmapDiamond(int iterations, int startAmplitude, float amplitudeModifier);
@@ -43,44 +67,92 @@ public slots:
 
 	void onGenerateHeightmapFault(int width, int height, int iterations, int startAmplitude, int endAmplitude, int amplitudeChange, HeightmapGenerator::faultFunctions_t function, int transitionLength);
 
+	//!<the eroded heightmap arrives through heightmapGenerated
+	void onErodeHeightmapHydraulic(const Heightmap& heightmap, int dropletCount, int seed);
+
+	//!<the eroded heightmap arrives through heightmapGenerated
+	void onErodeHeightmapThermal(const Heightmap& heightmap, int iterations, float talus);
+
+	//!<the filled heightmap arrives through heightmapGenerated
+	void onFillDepressions(const Heightmap& heightmap);
+
+	//!<fills the depressions first, the log scaled accumulation arrives through heightmapGenerated
+	void onComputeFlowAccumulation(const Heightmap& heightmap);
+
+	//!<reads elevation data with DEMImporter and scales it to 0..1, the result arrives through heightmapImported, empty on errors
+	void onImportHeightmap(const std::string& filename);
+
 	void onCreateMesh(const Heightmap& heightmap);
 	
 	void onLoadMesh(const std::string& filename);
 
 	void onSaveMesh(const Mesh& mesh, const std::string& filename, const std::string& exportFormatId);
 
+	//!<writes the tiles with TileExporter, the result arrives through meshSaved
+	void onSaveMeshTiles(const Heightmap& heightmap, float heightOffset, float heightScale, int columns, int rows, const std::string& filename, const std::string& exportFormatId, const std::string& extension);
+
+	void onLoadTexture(const QString& filename, int layerIndex, const QVector<QImage>& layerImages, const QSize& textureSize, GLenum textureFormat);
+
+	/** \brief Raises the samples of the source to the given power and converts the result into an image.
+	*          Only one request runs at a time, requests arriving meanwhile replace each other and only the newest is run next.
+	*          Results that have been superseded by a newer request aren't emitted.
+	*/
+	void onApplyHeightExponent(std::shared_ptr<const Heightmap> source, float exponent);
+
 private slots:
 
 	void onHeightmapGenerated();
 
+	void onHeightmapImported();
+
 	void onMeshCreated();
 
 	void onMeshLoaded();
 
 	void onMeshSaved();
 
+	void onTextureLoaded();
+
+	void onHeightExponentApplied();
+
 signals:
 
 	void heightmapGenerated(const Heightmap& heightmap);
 
+	void heightmapImported(const Heightmap& heightmap);
+
 	void meshCreated(const Mesh& mesh);
 
 	void meshLoaded(const Mesh& mesh);
 
 	void meshSaved(bool success);
 
+	void textureLoaded(const LoadedTexture& texture);
+
+	void heightExponentApplied(const RemappedHeightmap& result);
+
 private:
 
 	void connect();
 
+	void startHeightExponent();
+
 	bool m_connected = false;
 
 	QFuture<Heightmap> m_generateHeightmapFuture;
 	QFutureWatcher<Heightmap> m_generateHeightmapFutureWatcher;
+	QFuture<Heightmap> m_importHeightmapFuture;
+	QFutureWatcher<Heightmap> m_importHeightmapFutureWatcher;
 	QFuture<Mesh> m_createMeshFuture;
 	QFutureWatcher<Mesh> m_createMeshFutureWatcher;
 	QFuture<std::vector<Mesh>> m_loadMeshFuture;
 	QFutureWatcher<std::vector<Mesh>> m_loadMeshFutureWatcher;
 	QFuture<bool> m_saveMeshFuture;
 	QFutureWatcher<bool> m_saveMeshFutureWatcher;
+	QFuture<LoadedTexture> m_loadTextureFuture;
+	QFutureWatcher<LoadedTexture> m_loadTextureFutureWatcher;
+	QFuture<RemappedHeightmap> m_heightExponentFuture;
+	QFutureWatcher<RemappedHeightmap> m_heightExponentFutureWatcher;
+	std::shared_ptr<const Heightmap> m_pendingExponentSource; //!<newest request that hasn't been started yet, null if there is none
+	float m_pendingExponent = 1.0f;
 };
@@ -0,0 +1,489 @@
+#include "DEMImporter.h"
+
+#include <QFile>
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DEMIMPORTER_USE_SSE2
+#endif
+
+#include "Parallel.h"
+
+bool DEMImporter::isSupported(const std::string& filename)
+{
+	return hasExtension(filename, ".asc") || hasExtension(filename, ".hgt");
+}
+
+Heightmap DEMImporter::load(const std::string& filename)
+{
+	if (hasExtension(filename, ".asc"))
+	{
+		return loadASCIIGrid(filename);
+	}
+
+	if (hasExtension(filename, ".hgt"))
+	{
+		return loadHGT(filename);
+	}
+
+	return Heightmap();
+}
+
+Heightmap DEMImporter::loadASCIIGrid(const std::string& filename)
+{
+	QFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+	{
+		return Heightmap();
+	}
+
+	qint64 fileSize = file.size();
+	const char* data = reinterpret_cast<const char*>(file.map(0, fileSize));
+	if (data == nullptr)
+	{
+		return Heightmap();
+	}
+
+	const char* cursor = data;
+	const char* end = data + fileSize;
+
+	ASCIIGridHeader header;
+	if (!parseASCIIGridHeader(cursor, end, header) ||
+		static_cast<int64_t>(header.m_columns) * header.m_rows > std::numeric_limits<int>::max())
+	{
+		return Heightmap();
+	}
+
+	//chunks end behind a line break, so no value is split between two of them
+
+	size_t dataSize = end - cursor;
+	int chunkCount = static_cast<int>(std::max<size_t>((dataSize + PARSE_CHUNK_SIZE - 1) / PARSE_CHUNK_SIZE, 1));
+	std::vector<const char*> boundaries(chunkCount + 1);
+	boundaries[0] = cursor;
+	boundaries[chunkCount] = end;
+
+	for (int i = 1; i < chunkCount; ++i)
+	{
+		const char* boundary = std::max(cursor + dataSize / chunkCount * i, boundaries[i - 1]);
+		boundary = std::find(boundary, end, '\n');
+		boundaries[i] = boundary == end ? end : boundary + 1;
+	}
+
+	//values are counted first, so that every chunk knows where its samples start and writes them in place
+
+	std::vector<size_t> offsets(chunkCount + 1, 0);
+
+	Parallel::forRange(chunkCount, [&boundaries, &offsets](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			offsets[i + 1] = countValues(boundaries[i], boundaries[i + 1]);
+		}
+	});
+
+	for (int i = 0; i < chunkCount; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	size_t sampleCount = static_cast<size_t>(header.m_columns) * header.m_rows;
+
+	if (offsets[chunkCount] != sampleCount)
+	{
+		return Heightmap();
+	}
+
+	Heightmap heightmap(header.m_columns, header.m_rows);
+	float* samples = heightmap.getRow(0);
+	std::atomic<bool> failed{ false };
+
+	Parallel::forRange(chunkCount, [&boundaries, &offsets, samples, &failed](int begin, int end)
+	{
+		for (int i = begin; i < end && failed == false; ++i)
+		{
+			if (!parseValues(boundaries[i], boundaries[i + 1], samples + offsets[i], offsets[i + 1] - offsets[i]))
+			{
+				failed = true;
+			}
+		}
+	});
+
+	if (failed)
+	{
+		return Heightmap();
+	}
+
+	if (header.m_hasNoData)
+	{
+		fillVoids(heightmap, header.m_noData);
+	}
+
+	return heightmap;
+}
+
+Heightmap DEMImporter::loadHGT(const std::string& filename)
+{
+	QFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return Heightmap();
+	}
+
+	qint64 fileSize = file.size();
+	int size = static_cast<int>(std::lround(std::sqrt(static_cast<double>(fileSize / 2))));
+
+	if (size < 2 || static_cast<qint64>(size) * size * 2 != fileSize)
+	{
+		return Heightmap();
+	}
+
+	const unsigned char* data = file.map(0, fileSize);
+	if (data == nullptr)
+	{
+		return Heightmap();
+	}
+
+	Heightmap heightmap(size, size);
+
+	Parallel::forRange(size, [&heightmap, data, size](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			unpackRowBigEndian16(data + static_cast<size_t>(row) * size * 2, heightmap.getRow(row), size);
+		}
+	}, MIN_ROWS_PER_CHUNK);
+
+	fillVoids(heightmap, static_cast<float>(HGT_VOID));
+
+	return heightmap;
+}
+
+bool DEMImporter::hasExtension(const std::string& filename, const std::string& extension)
+{
+	if (filename.size() < extension.size())
+	{
+		return false;
+	}
+
+	return std::equal(extension.begin(), extension.end(), filename.end() - extension.size(), [](char a, char b)
+	{
+		return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+	});
+}
+
+bool DEMImporter::parseASCIIGridHeader(const char*& cursor, const char* end, ASCIIGridHeader& header)
+{
+	while (true)
+	{
+		while (cursor != end && isSpace(*cursor))
+		{
+			++cursor;
+		}
+
+		if (cursor == end || !std::isalpha(static_cast<unsigned char>(*cursor)))
+		{
+			break;
+		}
+
+		std::string keyword;
+		while (cursor != end && !isSpace(*cursor))
+		{
+			keyword += static_cast<char>(std::tolower(static_cast<unsigned char>(*cursor)));
+			++cursor;
+		}
+
+		while (cursor != end && isSpace(*cursor))
+		{
+			++cursor;
+		}
+
+		double value = 0.0;
+		if (!parseDouble(cursor, end, value))
+		{
+			return false;
+		}
+
+		//the position and cell size (xllcorner, yllcorner, cellsize) don't matter for a heightmap
+
+		if (keyword == "ncols")
+		{
+			if (!toCount(value, header.m_columns))
+			{
+				return false;
+			}
+		}
+		else if (keyword == "nrows")
+		{
+			if (!toCount(value, header.m_rows))
+			{
+				return false;
+			}
+		}
+		else if (keyword == "nodata_value")
+		{
+			header.m_hasNoData = true;
+			header.m_noData = static_cast<float>(value);
+		}
+	}
+
+	return header.m_columns > 0 && header.m_rows > 0;
+}
+
+size_t DEMImporter::countValues(const char* begin, const char* end)
+{
+	size_t count = 0;
+	bool inValue = false;
+
+	for (const char* c = begin; c != end; ++c)
+	{
+		bool space = isSpace(*c);
+		count += !space && !inValue;
+		inValue = !space;
+	}
+
+	return count;
+}
+
+bool DEMImporter::parseValues(const char* begin, const char* end, float* samples, size_t sampleCount)
+{
+	const char* cursor = begin;
+	size_t count = 0;
+
+	while (true)
+	{
+		while (cursor != end && isSpace(*cursor))
+		{
+			++cursor;
+		}
+
+		if (cursor == end)
+		{
+			return true;
+		}
+
+		if (count == sampleCount || !parseFloat(cursor, end, samples[count]))
+		{
+			return false;
+		}
+
+		++count;
+	}
+}
+
+bool DEMImporter::toCount(double value, int& count)
+{
+	if (!std::isfinite(value) || value < 1.0 || value > std::numeric_limits<int>::max() || std::floor(value) != value)
+	{
+		return false;
+	}
+
+	count = static_cast<int>(value);
+
+	return true;
+}
+
+bool DEMImporter::parseFloat(const char*& cursor, const char* end, float& value)
+{
+	double result = 0.0;
+	if (!parseDouble(cursor, end, result))
+	{
+		return false;
+	}
+
+	value = static_cast<float>(result);
+
+	return true;
+}
+
+bool DEMImporter::parseDouble(const char*& cursor, const char* end, double& value)
+{
+	//exact powers of ten as doubles, a mantissa of up to 19 digits scaled by one of them is off by at most one rounding
+
+	static const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const int MAX_EXACT_EXPONENT = 22;
+	const int MAX_MANTISSA_DIGITS = 19;
+
+	const char* c = cursor;
+	bool negative = false;
+
+	if (c != end && (*c == '-' || *c == '+'))
+	{
+		negative = *c == '-';
+		++c;
+	}
+
+	uint64_t mantissa = 0;
+	int mantissaDigits = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+
+	for (; c != end && *c >= '0' && *c <= '9'; ++c)
+	{
+		hasDigits = true;
+
+		if (mantissaDigits < MAX_MANTISSA_DIGITS)
+		{
+			mantissa = mantissa * 10 + (*c - '0');
+			mantissaDigits += mantissa != 0;
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+
+	if (c != end && *c == '.')
+	{
+		for (++c; c != end && *c >= '0' && *c <= '9'; ++c)
+		{
+			hasDigits = true;
+
+			if (mantissaDigits < MAX_MANTISSA_DIGITS)
+			{
+				mantissa = mantissa * 10 + (*c - '0');
+				mantissaDigits += mantissa != 0;
+				--exponent;
+			}
+		}
+	}
+
+	if (!hasDigits)
+	{
+		return false;
+	}
+
+	if (c != end && (*c == 'e' || *c == 'E'))
+	{
+		++c;
+
+		bool negativeExponent = false;
+		if (c != end && (*c == '-' || *c == '+'))
+		{
+			negativeExponent = *c == '-';
+			++c;
+		}
+
+		if (c == end || *c < '0' || *c > '9')
+		{
+			return false;
+		}
+
+		int explicitExponent = 0;
+		for (; c != end && *c >= '0' && *c <= '9'; ++c)
+		{
+			explicitExponent = std::min(explicitExponent * 10 + (*c - '0'), 10000);
+		}
+
+		exponent += negativeExponent ? -explicitExponent : explicitExponent;
+	}
+
+	if (c != end && !isSpace(*c))
+	{
+		return false;
+	}
+
+	double result = static_cast<double>(mantissa);
+
+	if (exponent < 0 && exponent >= -MAX_EXACT_EXPONENT)
+	{
+		result /= POWERS_OF_TEN[-exponent];
+	}
+	else if (exponent > 0 && exponent <= MAX_EXACT_EXPONENT)
+	{
+		result *= POWERS_OF_TEN[exponent];
+	}
+	else if (exponent != 0 && mantissa != 0)
+	{
+		result *= std::pow(10.0, exponent);
+	}
+
+	value = negative ? -result : result;
+	cursor = c;
+
+	return true;
+}
+
+bool DEMImporter::isSpace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+void DEMImporter::unpackRowBigEndian16(const unsigned char* bytes, float* heights, int count)
+{
+	int i = 0;
+
+#ifdef DEMIMPORTER_USE_SSE2
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 2 * i));
+		words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+
+		//interleaving the words with themselves and shifting them back down extends their sign to 32 bits
+
+		__m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+		__m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+
+		_mm_storeu_ps(heights + i, _mm_cvtepi32_ps(low));
+		_mm_storeu_ps(heights + i + 4, _mm_cvtepi32_ps(high));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		int16_t value = static_cast<int16_t>((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+		heights[i] = static_cast<float>(value);
+	}
+}
+
+void DEMImporter::fillVoids(Heightmap& heightmap, float noData)
+{
+	int width = heightmap.getWidth();
+	int height = heightmap.getHeight();
+
+	float min = std::numeric_limits<float>::max();
+	std::mutex minMutex;
+
+	Parallel::forRange(height, [&heightmap, width, noData, &min, &minMutex](int begin, int end)
+	{
+		float chunkMin = std::numeric_limits<float>::max();
+
+		for (int row = begin; row < end; ++row)
+		{
+			const float* heights = heightmap.getRow(row);
+			for (int col = 0; col < width; ++col)
+			{
+				if (heights[col] != noData)
+				{
+					chunkMin = std::min(chunkMin, heights[col]);
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(minMutex);
+		min = std::min(min, chunkMin);
+	}, MIN_ROWS_PER_CHUNK);
+
+	if (min == std::numeric_limits<float>::max())
+	{
+		min = 0.0f;
+	}
+
+	Parallel::forRange(height, [&heightmap, width, noData, min](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			float* heights = heightmap.getRow(row);
+			std::replace(heights, heights + width, noData, min);
+		}
+	}, MIN_ROWS_PER_CHUNK);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Heightmap.h"
+
+/** \brief Reads digital elevation models straight into a Heightmap: ESRI ASCII grids (.asc) and SRTM tiles (.hgt).
+*          The files are memory mapped and converted in parallel, rows in the file order from north to south.
+*          Heights keep the units of the file, samples without data get the lowest valid height.
+*/
+class DEMImporter
+{
+
+public:
+
+	static constexpr size_t PARSE_CHUNK_SIZE = 4 * 1024 * 1024; //!<bytes of ASCII grid text parsed by one task
+	static constexpr int HGT_VOID = -32768; //!<height of SRTM samples without data
+
+	//!<true if the extension of the file is .asc or .hgt
+	static bool isSupported(const std::string& filename);
+
+	//!<reads the file with the importer matching its extension, an empty heightmap on errors
+	static Heightmap load(const std::string& filename);
+
+	/** \brief Reads an ESRI ASCII grid. The text after the header is split into chunks at line boundaries,
+	*          the values of every chunk are counted first and then parsed in parallel to their place in the heightmap.
+	*   \return An empty heightmap if the header is incomplete, a value can't be parsed or the count doesn't match.
+	*/
+	static Heightmap loadASCIIGrid(const std::string& filename);
+
+	/** \brief Reads an SRTM tile of big endian 16-bit samples, its size follows from the file size (1201 or 3601 samples square).
+	*   \return An empty heightmap if the file isn't square.
+	*/
+	static Heightmap loadHGT(const std::string& filename);
+
+private:
+
+	static constexpr int MIN_ROWS_PER_CHUNK = 16;
+
+	struct ASCIIGridHeader
+	{
+		int m_columns = 0;
+		int m_rows = 0;
+		bool m_hasNoData = false;
+		float m_noData = 0.0f;
+	};
+
+	static bool hasExtension(const std::string& filename, const std::string& extension);
+
+	//!<reads the keyword value lines and leaves the cursor at the first sample
+	static bool parseASCIIGridHeader(const char*& cursor, const char* end, ASCIIGridHeader& header);
+
+	//!<number of whitespace separated tokens
+	static size_t countValues(const char* begin, const char* end);
+
+	//!<parses the values of [begin, end) into samples, false if there are more values than sampleCount or one is malformed
+	static bool parseValues(const char* begin, const char* end, float* samples, size_t sampleCount);
+
+	//!<parses a sample with parseDouble()
+	static bool parseFloat(const char*& cursor, const char* end, float& value);
+
+	/** \brief Parses a decimal number without going through the locale, the cursor is left behind it.
+	*   \return False if the token isn't a number or is directly followed by something other than whitespace.
+	*/
+	static bool parseDouble(const char*& cursor, const char* end, double& value);
+
+	//!<converts a column or row count of the header, false unless it is a whole number in [1, INT_MAX]
+	static bool toCount(double value, int& count);
+
+	static bool isSpace(char c);
+
+	//!<converts big endian signed 16-bit samples to floats
+	static void unpackRowBigEndian16(const unsigned char* bytes, float* heights, int count);
+
+	//!<replaces the samples equal to noData by the lowest other sample, by 0 if there is none
+	static void fillVoids(Heightmap& heightmap, float noData);
+};
@@ -0,0 +1,376 @@
+#include "FlowAnalysis.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+#include "Parallel.h"
+
+const int FlowAnalysis::NEIGHBOR_OFFSETS_X[NEIGHBOR_COUNT] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+const int FlowAnalysis::NEIGHBOR_OFFSETS_Y[NEIGHBOR_COUNT] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+const float FlowAnalysis::NEIGHBOR_DISTANCES[NEIGHBOR_COUNT] = { 1.0f, 1.41421356f, 1.0f, 1.41421356f, 1.0f, 1.41421356f, 1.0f, 1.41421356f };
+
+Heightmap FlowAnalysis::fillDepressions(const Heightmap& heightmap)
+{
+	Heightmap result = heightmap;
+
+	int width = result.getWidth();
+	int height = result.getHeight();
+
+	if (result.isEmpty())
+	{
+		return result;
+	}
+
+	float* heights = result.getRow(0);
+	std::vector<bool> closed(static_cast<size_t>(width) * height, false);
+	RadixHeap open;
+	std::queue<uint32_t> pit;
+
+	//the border drains off the map, the flood starts there
+
+	for (int row = 0; row < height; ++row)
+	{
+		for (int col = 0; col < width; ++col)
+		{
+			if (row == 0 || col == 0 || row == height - 1 || col == width - 1)
+			{
+				uint32_t index = static_cast<uint32_t>(row) * width + col;
+				closed[index] = true;
+				open.push(heights[index], index);
+			}
+		}
+	}
+
+	while (!pit.empty() || !open.isEmpty())
+	{
+		uint32_t index;
+
+		if (!pit.empty())
+		{
+			index = pit.front();
+			pit.pop();
+		}
+		else
+		{
+			index = open.pop();
+		}
+
+		int row = static_cast<int>(index / width);
+		int col = static_cast<int>(index % width);
+		float spillHeight = std::nextafter(heights[index], std::numeric_limits<float>::infinity());
+
+		for (int direction = 0; direction < NEIGHBOR_COUNT; ++direction)
+		{
+			int neighborRow = row + NEIGHBOR_OFFSETS_Y[direction];
+			int neighborCol = col + NEIGHBOR_OFFSETS_X[direction];
+
+			if (neighborRow < 0 || neighborCol < 0 || neighborRow >= height || neighborCol >= width)
+			{
+				continue;
+			}
+
+			uint32_t neighbor = static_cast<uint32_t>(neighborRow) * width + neighborCol;
+
+			if (closed[neighbor])
+			{
+				continue;
+			}
+			closed[neighbor] = true;
+
+			//a sample below the spill height is part of a depression, it is raised and processed before anything higher
+
+			if (heights[neighbor] <= spillHeight)
+			{
+				heights[neighbor] = spillHeight;
+				pit.push(neighbor);
+			}
+			else
+			{
+				open.push(heights[neighbor], neighbor);
+			}
+		}
+	}
+
+	return result;
+}
+
+Heightmap FlowAnalysis::computeFlowAccumulation(const Heightmap& heightmap)
+{
+	int width = heightmap.getWidth();
+	int height = heightmap.getHeight();
+	Heightmap accumulation(width, height);
+
+	if (heightmap.isEmpty())
+	{
+		return accumulation;
+	}
+
+	size_t sampleCount = static_cast<size_t>(width) * height;
+	std::vector<uint8_t> receivers = computeReceivers(heightmap);
+	std::unique_ptr<std::atomic<uint8_t>[]> pendingDonors(new std::atomic<uint8_t>[sampleCount]);
+	float* flow = accumulation.getRow(0);
+
+	//a sample is ready once all of its donors are, the donor that finishes last hands it on
+
+	auto getReceiverIndex = [&receivers, width](uint32_t index)
+	{
+		uint8_t direction = receivers[index];
+		return index + NEIGHBOR_OFFSETS_Y[direction] * width + NEIGHBOR_OFFSETS_X[direction];
+	};
+
+	auto process = [&](uint32_t index, std::vector<uint32_t>& ready)
+	{
+		int row = static_cast<int>(index / width);
+		int col = static_cast<int>(index % width);
+		float sum = 1.0f;
+
+		for (int direction = 0; direction < NEIGHBOR_COUNT; ++direction)
+		{
+			int donorRow = row + NEIGHBOR_OFFSETS_Y[direction];
+			int donorCol = col + NEIGHBOR_OFFSETS_X[direction];
+
+			if (donorRow >= 0 && donorCol >= 0 && donorRow < height && donorCol < width)
+			{
+				size_t donor = static_cast<size_t>(donorRow) * width + donorCol;
+
+				if (receivers[donor] == getOpposite(direction))
+				{
+					sum += flow[donor];
+				}
+			}
+		}
+
+		flow[index] = sum;
+
+		if (receivers[index] != NO_RECEIVER)
+		{
+			uint32_t receiver = getReceiverIndex(index);
+
+			if (pendingDonors[receiver].fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				ready.push_back(receiver);
+			}
+		}
+	};
+
+	Parallel::forRange(height, [&](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			for (int col = 0; col < width; ++col)
+			{
+				pendingDonors[static_cast<size_t>(row) * width + col].store(countDonors(receivers, width, height, row, col), std::memory_order_relaxed);
+			}
+		}
+	}, MIN_ROWS_PER_CHUNK);
+
+	//samples without donors start the flow, they are found by a sweep instead of being listed,
+	//the counters can't tell them apart as they already drop to zero for samples handed on during the sweep
+
+	std::vector<uint32_t> front;
+	std::mutex frontMutex;
+
+	Parallel::forRange(height, [&](int begin, int end)
+	{
+		std::vector<uint32_t> ready;
+
+		for (int row = begin; row < end; ++row)
+		{
+			for (int col = 0; col < width; ++col)
+			{
+				uint32_t index = static_cast<uint32_t>(row) * width + col;
+
+				if (countDonors(receivers, width, height, row, col) == 0)
+				{
+					process(index, ready);
+				}
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(frontMutex);
+		front.insert(front.end(), ready.begin(), ready.end());
+	}, MIN_ROWS_PER_CHUNK);
+
+	//the front shrinks towards the outlets, once it is small the rest is cheaper to finish on one thread
+
+	while (front.size() >= MIN_PARALLEL_FRONT)
+	{
+		std::vector<uint32_t> nextFront;
+
+		Parallel::forRange(static_cast<int>(front.size()), [&](int begin, int end)
+		{
+			std::vector<uint32_t> ready;
+
+			for (int i = begin; i < end; ++i)
+			{
+				process(front[i], ready);
+			}
+
+			std::lock_guard<std::mutex> lock(frontMutex);
+			nextFront.insert(nextFront.end(), ready.begin(), ready.end());
+		}, static_cast<int>(MIN_PARALLEL_FRONT / 4));
+
+		front.swap(nextFront);
+	}
+
+	while (!front.empty())
+	{
+		uint32_t index = front.back();
+		front.pop_back();
+		process(index, front);
+	}
+
+	return accumulation;
+}
+
+void FlowAnalysis::scaleLogarithmic(Heightmap& accumulation)
+{
+	Parallel::forRange(accumulation.getHeight(), [&accumulation](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			float* values = accumulation.getRow(row);
+
+			for (int col = 0; col < accumulation.getWidth(); ++col)
+			{
+				values[col] = std::log1p(values[col]);
+			}
+		}
+	}, MIN_ROWS_PER_CHUNK);
+
+	accumulation.normalize();
+}
+
+std::vector<uint8_t> FlowAnalysis::computeReceivers(const Heightmap& heightmap)
+{
+	std::vector<uint8_t> receivers(static_cast<size_t>(heightmap.getWidth()) * heightmap.getHeight());
+
+	Parallel::forRange(heightmap.getHeight(), [&heightmap, &receivers](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			uint8_t* rowReceivers = receivers.data() + static_cast<size_t>(row) * heightmap.getWidth();
+
+			for (int col = 0; col < heightmap.getWidth(); ++col)
+			{
+				rowReceivers[col] = getReceiver(heightmap, row, col);
+			}
+		}
+	}, MIN_ROWS_PER_CHUNK);
+
+	return receivers;
+}
+
+uint8_t FlowAnalysis::countDonors(const std::vector<uint8_t>& receivers, int width, int height, int row, int col)
+{
+	uint8_t donors = 0;
+
+	for (int direction = 0; direction < NEIGHBOR_COUNT; ++direction)
+	{
+		int donorRow = row + NEIGHBOR_OFFSETS_Y[direction];
+		int donorCol = col + NEIGHBOR_OFFSETS_X[direction];
+
+		if (donorRow >= 0 && donorCol >= 0 && donorRow < height && donorCol < width
+			&& receivers[static_cast<size_t>(donorRow) * width + donorCol] == getOpposite(direction))
+		{
+			++donors;
+		}
+	}
+
+	return donors;
+}
+
+uint8_t FlowAnalysis::getReceiver(const Heightmap& heightmap, int row, int col)
+{
+	float sampleHeight = heightmap.at(row, col);
+	float steepestSlope = 0.0f;
+	uint8_t receiver = NO_RECEIVER;
+
+	for (int direction = 0; direction < NEIGHBOR_COUNT; ++direction)
+	{
+		int neighborRow = row + NEIGHBOR_OFFSETS_Y[direction];
+		int neighborCol = col + NEIGHBOR_OFFSETS_X[direction];
+
+		if (neighborRow < 0 || neighborCol < 0 || neighborRow >= heightmap.getHeight() || neighborCol >= heightmap.getWidth())
+		{
+			continue;
+		}
+
+		float slope = (sampleHeight - heightmap.at(neighborRow, neighborCol)) / NEIGHBOR_DISTANCES[direction];
+
+		if (slope > steepestSlope)
+		{
+			steepestSlope = slope;
+			receiver = static_cast<uint8_t>(direction);
+		}
+	}
+
+	return receiver;
+}
+
+int FlowAnalysis::getOpposite(int direction)
+{
+	return (direction + NEIGHBOR_COUNT / 2) % NEIGHBOR_COUNT;
+}
+
+void FlowAnalysis::RadixHeap::push(float height, uint32_t index)
+{
+	uint32_t key = toKey(height);
+	m_buckets[getBucket(key, m_lastKey)].emplace_back(key, index);
+	++m_size;
+}
+
+uint32_t FlowAnalysis::RadixHeap::pop()
+{
+	if (m_buckets[0].empty())
+	{
+		//the smallest key of the first non-empty bucket becomes the new reference, its other keys move to lower buckets
+
+		int bucket = 1;
+		while (m_buckets[bucket].empty())
+		{
+			++bucket;
+		}
+
+		std::vector<std::pair<uint32_t, uint32_t>>& entries = m_buckets[bucket];
+		m_lastKey = std::min_element(entries.begin(), entries.end())->first;
+
+		for (const std::pair<uint32_t, uint32_t>& entry : entries)
+		{
+			m_buckets[getBucket(entry.first, m_lastKey)].push_back(entry);
+		}
+		entries.clear();
+	}
+
+	uint32_t index = m_buckets[0].back().second;
+	m_buckets[0].pop_back();
+	--m_size;
+
+	return index;
+}
+
+bool FlowAnalysis::RadixHeap::isEmpty() const
+{
+	return m_size == 0;
+}
+
+uint32_t FlowAnalysis::RadixHeap::toKey(float height)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &height, sizeof(bits));
+
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+int FlowAnalysis::RadixHeap::getBucket(uint32_t key, uint32_t lastKey)
+{
+	return key == lastKey ? 0 : 32 - static_cast<int>(qCountLeadingZeroBits(key ^ lastKey));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Heightmap.h"
+
+/** \brief Hydrological analysis of heightmaps, filling of depressions and D8 flow accumulation.
+*/
+class FlowAnalysis
+{
+
+public:
+
+	static constexpr int NEIGHBOR_COUNT = 8;
+	static constexpr uint8_t NO_RECEIVER = NEIGHBOR_COUNT; //!<direction of samples without a lower neighbour
+
+	/** \brief Raises every sample that has no descending path to the map border to the lowest level that gives it one.
+	*          viz. Barnes, Lehman, Mulla: Priority-Flood: An Optimal Depression-Filling and Watershed-Labeling Algorithm, 2014
+	*
+	*          Filled areas get an epsilon gradient towards their outlet, so that every sample of the result has a lower neighbour
+	*          or lies on the border. The flood front is kept in a radix heap, samples filled by a depression are queued in
+	*          a plain queue instead, since they are already known to be processed in order.
+	*/
+	static Heightmap fillDepressions(const Heightmap& heightmap);
+
+	/** \brief Counts the samples that drain through each sample, the sample itself included.
+	*          Every sample drains into its steepest lower neighbour (D8), samples are processed in parallel in
+	*          topological order as soon as all samples draining into them are done.
+	*   \param heightmap Should have been filled by fillDepressions(), flow ends in depressions otherwise.
+	*/
+	static Heightmap computeFlowAccumulation(const Heightmap& heightmap);
+
+	//!<compresses the range of an accumulation map for display, log(1 + accumulation) normalized to 0-1
+	static void scaleLogarithmic(Heightmap& accumulation);
+
+private:
+
+	static constexpr int MIN_ROWS_PER_CHUNK = 16;
+	static constexpr size_t MIN_PARALLEL_FRONT = 4096; //!<smaller fronts of ready samples are processed on the calling thread
+
+	static const int NEIGHBOR_OFFSETS_X[NEIGHBOR_COUNT]; //!<clockwise from east
+	static const int NEIGHBOR_OFFSETS_Y[NEIGHBOR_COUNT];
+	static const float NEIGHBOR_DISTANCES[NEIGHBOR_COUNT];
+
+	/** \brief Monotone priority queue of samples keyed by height.
+	*          Keys are bucketed by the highest bit in which they differ from the last popped key, so pushes and pops
+	*          are amortized constant time as long as no key lower than the last popped one is pushed.
+	*/
+	class RadixHeap
+	{
+
+	public:
+
+		RadixHeap() = default;
+
+		RadixHeap(const RadixHeap& other) = delete;
+
+		RadixHeap(RadixHeap&& other) = delete;
+
+		RadixHeap& operator=(const RadixHeap& other) = delete;
+
+		RadixHeap& operator=(RadixHeap&& other) = delete;
+
+		~RadixHeap() = default;
+
+		void push(float height, uint32_t index);
+
+		//!<returns the index of a sample with the lowest height, the heap must not be empty
+		uint32_t pop();
+
+		bool isEmpty() const;
+
+	private:
+
+		static constexpr int BUCKET_COUNT = 33; //!<bucket 0 holds keys equal to the last popped one, bucket i keys differing in bit i - 1 first
+
+		std::vector<std::pair<uint32_t, uint32_t>> m_buckets[BUCKET_COUNT]; //!<pairs of key and sample index
+		uint32_t m_lastKey = 0;
+		size_t m_size = 0;
+
+		//!<maps floats to unsigned integers of the same order
+		static uint32_t toKey(float height);
+
+		static int getBucket(uint32_t key, uint32_t lastKey);
+	};
+
+	//!<D8 directions of all samples, computed in parallel
+	static std::vector<uint8_t> computeReceivers(const Heightmap& heightmap);
+
+	static uint8_t getReceiver(const Heightmap& heightmap, int row, int col);
+
+	//!<number of neighbours draining into the sample
+	static uint8_t countDonors(const std::vector<uint8_t>& receivers, int width, int height, int row, int col);
+
+	static int getOpposite(int direction);
+};
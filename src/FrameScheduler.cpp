@@ -0,0 +1,89 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+#include "RenderThread.h"
+
+FrameScheduler::FrameScheduler(RenderThread* renderThread, QObject* parent)
+	: QObject(parent)
+	, m_renderThread(renderThread)
+{
+	m_clock.start();
+}
+
+void FrameScheduler::requestFrame()
+{
+	m_pendingRequests++;
+
+	if (!m_frameInFlight)
+	{
+		startFrame();
+	}
+}
+
+const FrameStatistics& FrameScheduler::getStatistics() const
+{
+	return m_statistics;
+}
+
+void FrameScheduler::onFrameRendered()
+{
+	if (m_frameInFlight)
+	{
+		m_frameRendered = true;
+	}
+}
+
+void FrameScheduler::onFrameSwapped()
+{
+	//swaps without a new frame (e.g. exposing the window) don't complete anything
+
+	if (!m_frameInFlight || !m_frameRendered)
+	{
+		return;
+	}
+
+	m_frameInFlight = false;
+	m_frameRendered = false;
+
+	m_statistics.m_coalescedRequests = m_inFlightRequests;
+	addFrameTime((m_clock.nsecsElapsed() - m_frameStartTime) / 1000000.0f);
+
+	if (m_pendingRequests > 0)
+	{
+		startFrame();
+	}
+}
+
+void FrameScheduler::startFrame()
+{
+	emit frameStarted();
+
+	m_frameInFlight = true;
+	m_frameRendered = false;
+	m_inFlightRequests = m_pendingRequests;
+	m_pendingRequests = 0;
+	m_frameStartTime = m_clock.nsecsElapsed();
+
+	m_renderThread->requestFrame();
+}
+
+void FrameScheduler::addFrameTime(float frameTime)
+{
+	m_frameTimes[m_nextFrameTime] = frameTime;
+	m_nextFrameTime = (m_nextFrameTime + 1) % STATISTICS_FRAME_COUNT;
+	m_statistics.m_frameCount = std::min(m_statistics.m_frameCount + 1, STATISTICS_FRAME_COUNT);
+
+	auto first = m_frameTimes.begin();
+	auto last = m_frameTimes.begin() + m_statistics.m_frameCount;
+
+	float sum = 0.0f;
+	for (auto it = first; it != last; ++it)
+	{
+		sum += *it;
+	}
+
+	m_statistics.m_averageFrameTime = sum / m_statistics.m_frameCount;
+	m_statistics.m_minFrameTime = *std::min_element(first, last);
+	m_statistics.m_maxFrameTime = *std::max_element(first, last);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include <array>
+
+#include "FrameStatistics.h"
+
+class RenderThread;
+
+/** \brief Paces the render thread to the display: at most one frame is in flight,
+*          requests arriving meanwhile are merged into the next frame, which starts once
+*          the current one has been swapped to the screen.
+*/
+class FrameScheduler : public QObject
+{
+
+	Q_OBJECT
+
+public:
+
+	static constexpr int STATISTICS_FRAME_COUNT = 120; //!<number of recent frames the statistics are computed from
+
+	explicit FrameScheduler(RenderThread* renderThread, QObject* parent = nullptr);
+
+	FrameScheduler(const FrameScheduler& other) = delete;
+
+	FrameScheduler(FrameScheduler&& other) = delete;
+
+	FrameScheduler& operator=(const FrameScheduler& other) = delete;
+
+	FrameScheduler& operator=(FrameScheduler&& other) = delete;
+
+	~FrameScheduler() override = default;
+
+	//!<never blocks, the frame starts immediately or after the one in flight has been presented
+	void requestFrame();
+
+	const FrameStatistics& getStatistics() const;
+
+signals:
+
+	//!<emitted right before a frame is started, the last chance to submit coalesced state changes
+	void frameStarted();
+
+public slots:
+
+	//!<the render thread has finished a frame
+	void onFrameRendered();
+
+	//!<the widget has swapped a frame to the screen
+	void onFrameSwapped();
+
+private:
+
+	RenderThread* m_renderThread = nullptr;
+
+	bool m_frameInFlight = false;
+	bool m_frameRendered = false; //!<the frame in flight is ready and only waits for the next swap
+	int m_pendingRequests = 0; //!<requests waiting for the next frame
+	int m_inFlightRequests = 0; //!<requests served by the frame in flight
+
+	QElapsedTimer m_clock;
+	qint64 m_frameStartTime = 0; //!<nanoseconds
+
+	std::array<float, STATISTICS_FRAME_COUNT> m_frameTimes = {};
+	int m_nextFrameTime = 0;
+	FrameStatistics m_statistics;
+
+	void startFrame();
+
+	void addFrameTime(float frameTime);
+};
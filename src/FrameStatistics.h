@@ -0,0 +1,10 @@
+#pragma once
+
+struct FrameStatistics
+{
+	float m_averageFrameTime = 0.0f; //!<milliseconds from requesting a frame until it is on screen, averaged over recent frames
+	float m_minFrameTime = 0.0f;
+	float m_maxFrameTime = 0.0f;
+	int m_frameCount = 0; //!<number of frames the statistics are computed from
+	int m_coalescedRequests = 0; //!<frame requests merged into the latest frame
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+struct PassTimings
+{
+	float m_cpu = 0.0f; //!<milliseconds spent on the CPU issuing the pass
+	float m_gpu = 0.0f; //!<milliseconds spent on the GPU executing the pass, measured a few frames late
+};
+
+struct FrameTimings
+{
+	PassTimings m_upload; //!<shader compilation, buffer uploads and uniform updates
+	PassTimings m_depthMap;
+	PassTimings m_terrain;
+	float m_cpuTotal = 0.0f; //!<milliseconds spent in Renderer::render()
+};
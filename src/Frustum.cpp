@@ -0,0 +1,72 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	set(viewProjection);
+}
+
+void Frustum::set(const glm::mat4& viewProjection)
+{
+	//glm matrices are column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	m_planes[0] = rows[3] + rows[0]; //left
+	m_planes[1] = rows[3] - rows[0]; //right
+	m_planes[2] = rows[3] + rows[1]; //bottom
+	m_planes[3] = rows[3] - rows[1]; //top
+	m_planes[4] = rows[3] + rows[2]; //near
+	m_planes[5] = rows[3] - rows[2]; //far
+
+	for (glm::vec4& plane : m_planes)
+	{
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f)
+		{
+			plane /= length;
+		}
+	}
+}
+
+Frustum::Containment Frustum::classify(const AABB& bbox) const
+{
+	Containment result = Containment::INSIDE;
+
+	for (const glm::vec4& plane : m_planes)
+	{
+		//the corner furthest along the plane normal decides whether the box is completely outside,
+		//the opposite corner whether it is completely inside
+		glm::vec3 positive;
+		glm::vec3 negative;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			positive[axis] = plane[axis] >= 0.0f ? bbox.m_max[axis] : bbox.m_min[axis];
+			negative[axis] = plane[axis] >= 0.0f ? bbox.m_min[axis] : bbox.m_max[axis];
+		}
+
+		if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+		{
+			return Containment::OUTSIDE;
+		}
+
+		if (glm::dot(glm::vec3(plane), negative) + plane.w < 0.0f)
+		{
+			result = Containment::INTERSECTS;
+		}
+	}
+
+	return result;
+}
+
+bool Frustum::intersects(const AABB& bbox) const
+{
+	return classify(bbox) != Containment::OUTSIDE;
+}
+
+const glm::vec4& Frustum::getPlane(int index) const
+{
+	return m_planes[index];
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "AABB.h"
+
+class Frustum
+{
+
+public:
+
+	enum class Containment
+	{
+		OUTSIDE,
+		INTERSECTS,
+		INSIDE
+	};
+
+	static constexpr int PLANE_COUNT = 6;
+
+	Frustum() = default;
+
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	Frustum(const Frustum& other) = default;
+
+	Frustum(Frustum&& other) = default;
+
+	Frustum& operator=(const Frustum& other) = default;
+
+	Frustum& operator=(Frustum&& other) = default;
+
+	~Frustum() = default;
+
+	/** \brief Extracts the clip planes from a view-projection matrix (Gribb-Hartmann).
+	*          Works for both perspective and orthographic projections.
+	*   \param viewProjection Matrix transforming world space to clip space.
+	*/
+	void set(const glm::mat4& viewProjection);
+
+	Containment classify(const AABB& bbox) const;
+
+	bool intersects(const AABB& bbox) const;
+
+	const glm::vec4& getPlane(int index) const;
+
+private:
+
+	glm::vec4 m_planes[PLANE_COUNT]; //!<left, right, bottom, top, near, far; normals point inside
+};
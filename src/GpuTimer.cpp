@@ -0,0 +1,79 @@
+#include "GpuTimer.h"
+
+GpuTimer::~GpuTimer()
+{
+	if (m_queries[0] != 0)
+	{
+		glDeleteQueries(QUERY_COUNT, m_queries);
+	}
+}
+
+void GpuTimer::begin()
+{
+	if (m_queries[0] == 0)
+	{
+		glGenQueries(QUERY_COUNT, m_queries);
+	}
+
+	collect();
+
+	if (m_pending[m_next] == true)
+	{
+		//the GPU is more than QUERY_COUNT frames behind, skip this measurement instead of waiting
+		m_active = -1;
+		return;
+	}
+
+	m_active = m_next;
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_active]);
+}
+
+void GpuTimer::end()
+{
+	if (m_active == -1)
+	{
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+
+	m_pending[m_active] = true;
+	m_next = (m_active + 1) % QUERY_COUNT;
+	m_active = -1;
+}
+
+float GpuTimer::getElapsed()
+{
+	collect();
+
+	return m_elapsed;
+}
+
+void GpuTimer::collect()
+{
+	//read the results from the oldest to the newest query, stop at the first one that isn't ready
+
+	for (int i = 0; i < QUERY_COUNT; ++i)
+	{
+		int query = (m_next + i) % QUERY_COUNT;
+
+		if (m_pending[query] == false || query == m_active)
+		{
+			continue;
+		}
+
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (available == GL_FALSE)
+		{
+			return;
+		}
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &nanoseconds);
+
+		m_elapsed = nanoseconds / 1000000.0f;
+		m_pending[query] = false;
+	}
+}
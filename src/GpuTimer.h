@@ -0,0 +1,45 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/** \brief Measures the GPU time of a sequence of GL commands with GL_TIME_ELAPSED queries.
+*          The queries are kept in a ring, so results are read back a few frames later
+*          and reading them never stalls the pipeline.
+*/
+class GpuTimer
+{
+
+public:
+
+	static constexpr int QUERY_COUNT = 3; //!<number of frames that can be in flight
+
+	GpuTimer() = default;
+
+	GpuTimer(const GpuTimer& other) = delete;
+
+	GpuTimer(GpuTimer&& other) = delete;
+
+	GpuTimer& operator=(const GpuTimer& other) = delete;
+
+	GpuTimer& operator=(GpuTimer&& other) = delete;
+
+	~GpuTimer();
+
+	//!<starts timing, does nothing if all queries are still waiting for their results
+	void begin();
+
+	void end();
+
+	//!<latest available result in milliseconds
+	float getElapsed();
+
+private:
+
+	GLuint m_queries[QUERY_COUNT] = {};
+	bool m_pending[QUERY_COUNT] = {}; //!<query was issued and its result has not been read yet
+	int m_next = 0; //!<query used by the next begin()
+	int m_active = -1; //!<query between begin() and end(), -1 if none
+	float m_elapsed = 0.0f;
+
+	void collect();
+};
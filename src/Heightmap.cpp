@@ -1,4 +1,3 @@
-
 #include <algorithm>
 #include <limits>
 
@@ -11,7 +10,16 @@ Heightmap::Heightmap(int width, int height)
 
 void Heightmap::setSize(int width, int height)
 {
-	m_data = std::vector<std::vector<float>>(height, std::vector<float>(width, 0.0f));
+	if (width <= 0 || height <= 0)
+	{
+		width = 0;
+		height = 0;
+	}
+
+	m_data.assign(static_cast<size_t>(width) * height, 0.0f);
+	m_width = width;
+	m_height = height;
+	m_dirtyRects.clear();
 }
 
 void Heightmap::normalize()
@@ -21,54 +29,46 @@ void Heightmap::normalize()
 		return;
 	}
 
-	float min = std::numeric_limits<float>::max();
-	float max = std::numeric_limits<float>::min();
-
-	for (const std::vector<float>& row : m_data)
-	{
-		for (float value : row)
-		{
-			min = std::min(min, value);
-			max = std::max(max, value);
-		}
-	}
+	auto range = std::minmax_element(m_data.begin(), m_data.end());
+	float min = *range.first;
+	float max = *range.second;
 
 	float scale = 1.0f / (max - min);
 
-	for (std::vector<float>& row : m_data)
+	for (float& value : m_data)
 	{
-		for (float& value : row)
-		{
-			value = (value - min) * scale;
-		}
+		value = (value - min) * scale;
 	}
 }
 
 float& Heightmap::at(int row, int col)
 {
-	return m_data[row][col];
+	return m_data[static_cast<size_t>(row) * m_width + col];
 }
 
 const float& Heightmap::at(int row, int col) const
 {
-	return m_data[row][col];
+	return m_data[static_cast<size_t>(row) * m_width + col];
+}
+
+float* Heightmap::getRow(int row)
+{
+	return m_data.data() + static_cast<size_t>(row) * m_width;
+}
+
+const float* Heightmap::getRow(int row) const
+{
+	return m_data.data() + static_cast<size_t>(row) * m_width;
 }
 
 int Heightmap::getWidth() const
 {
-	if (m_data.empty())
-	{
-		return 0;
-	}
-	else
-	{
-		return m_data[0].size();
-	}
+	return m_width;
 }
 
 int Heightmap::getHeight() const
 {
-	return m_data.size();
+	return m_height;
 }
 
 float Heightmap::getMin() const
@@ -78,40 +78,97 @@ float Heightmap::getMin() const
 		return 0.0f;
 	}
 
-	float min = std::numeric_limits<float>::max();
+	return *std::min_element(m_data.begin(), m_data.end());
+}
 
-	for (const std::vector<float>& row : m_data)
+float Heightmap::getMax() const
+{
+	if (isEmpty())
 	{
-		for (float value : row)
-		{
-			min = std::min(min, value);
-		}
+		return 0.0f;
 	}
 
-	return min;
+	return *std::max_element(m_data.begin(), m_data.end());
 }
 
-float Heightmap::getMax() const
+bool Heightmap::isEmpty() const
 {
-	if (isEmpty())
+	return m_data.empty();
+}
+
+
+void Heightmap::markDirty(const HeightmapRect& rect)
+{
+	HeightmapRect merged;
+	merged.m_left = std::max(rect.m_left, 0);
+	merged.m_top = std::max(rect.m_top, 0);
+	merged.m_right = std::min(rect.m_right, m_width);
+	merged.m_bottom = std::min(rect.m_bottom, m_height);
+
+	if (merged.m_left >= merged.m_right || merged.m_top >= merged.m_bottom)
 	{
-		return 0.0f;
+		return;
 	}
 
-	float max = std::numeric_limits<float>::min();
+	//growing the rectangle can make it reach others, so merge until none is left that overlaps or touches it
 
-	for (const std::vector<float>& row : m_data)
+	bool grown = true;
+	while (grown)
 	{
-		for (float value : row)
+		grown = false;
+
+		for (size_t i = 0; i < m_dirtyRects.size(); ++i)
 		{
-			max = std::max(max, value);
+			const HeightmapRect& other = m_dirtyRects[i];
+
+			if (other.m_left <= merged.m_right && merged.m_left <= other.m_right &&
+				other.m_top <= merged.m_bottom && merged.m_top <= other.m_bottom)
+			{
+				merged.m_left = std::min(merged.m_left, other.m_left);
+				merged.m_top = std::min(merged.m_top, other.m_top);
+				merged.m_right = std::max(merged.m_right, other.m_right);
+				merged.m_bottom = std::max(merged.m_bottom, other.m_bottom);
+
+				m_dirtyRects[i] = m_dirtyRects.back();
+				m_dirtyRects.pop_back();
+				grown = true;
+				break;
+			}
 		}
 	}
 
-	return max;
+	if (m_dirtyRects.size() >= MAX_DIRTY_RECTS)
+	{
+		for (const HeightmapRect& other : m_dirtyRects)
+		{
+			merged.m_left = std::min(merged.m_left, other.m_left);
+			merged.m_top = std::min(merged.m_top, other.m_top);
+			merged.m_right = std::max(merged.m_right, other.m_right);
+			merged.m_bottom = std::max(merged.m_bottom, other.m_bottom);
+		}
+
+		m_dirtyRects.clear();
+	}
+
+	m_dirtyRects.push_back(merged);
 }
 
-bool Heightmap::isEmpty() const
+void Heightmap::markDirty()
 {
-	return m_data.empty();
+	HeightmapRect all;
+	all.m_right = m_width;
+	all.m_bottom = m_height;
+
+	m_dirtyRects.clear();
+	markDirty(all);
+}
+
+const std::vector<HeightmapRect>& Heightmap::getDirtyRects() const
+{
+	return m_dirtyRects;
+}
+
+void Heightmap::clearDirtyRects()
+{
+	m_dirtyRects.clear();
 }
@@ -2,15 +2,33 @@
 
 #include <vector>
 
+//!<rectangle of samples, m_right and m_bottom are exclusive
+struct HeightmapRect
+{
+	int m_left = 0;
+	int m_top = 0;
+	int m_right = 0;
+	int m_bottom = 0;
+};
+
+/** \brief Grid of height samples.
+*          Local edits are recorded as dirty rectangles, so that the pixmap, the mesh and the GPU buffers
+*          derived from the heightmap can be refreshed in time proportional to the size of the edit.
+*/
 class Heightmap
 {
 
 private:
 
-	std::vector<std::vector<float>> m_data;
+	std::vector<float> m_data; //!<rows stored one after another
+	int m_width = 0;
+	int m_height = 0;
+	std::vector<HeightmapRect> m_dirtyRects; //!<disjoint, clipped to the heightmap
 
 public:
 
+	static constexpr int MAX_DIRTY_RECTS = 16; //!<beyond this the dirty rectangles collapse into their bounding rectangle
+
 	Heightmap() = default;
 
 	Heightmap(int width, int height);
@@ -33,6 +51,11 @@ public:
 
 	const float& at(int row, int col) const;
 
+	//!<returns the samples of one row, they are contiguous
+	float* getRow(int row);
+
+	const float* getRow(int row) const;
+
 	int getWidth() const;
 
 	int getHeight() const;
@@ -42,4 +65,17 @@ public:
 	float getMax() const;
 
 	bool isEmpty() const;
+
+	/** \brief Records that the samples inside the rectangle have been modified.
+	*          The rectangle is clipped to the heightmap and merged with the dirty rectangles it overlaps or touches.
+	*/
+	void markDirty(const HeightmapRect& rect);
+
+	//!<marks the whole heightmap as modified
+	void markDirty();
+
+	const std::vector<HeightmapRect>& getDirtyRects() const;
+
+	//!<called once all views of the heightmap have caught up with the dirty rectangles
+	void clearDirtyRects();
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "HeightmapFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HEIGHTMAPFILTER_USE_SSE2
+#endif
+
+#include "Parallel.h"
+
+Heightmap HeightmapFilter::applyExponent(const Heightmap& heightmap, float exponent)
+{
+	Heightmap result(heightmap.getWidth(), heightmap.getHeight());
+
+	if (heightmap.isEmpty())
+	{
+		return result;
+	}
+
+	std::vector<float> table = buildExponentTable(exponent);
+	int width = heightmap.getWidth();
+
+	Parallel::forRange(heightmap.getHeight(), [&heightmap, &result, &table, width](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			remapRow(heightmap.getRow(row), result.getRow(row), width, table);
+		}
+	}, MIN_ROWS_PER_CHUNK);
+
+	return result;
+}
+
+std::vector<float> HeightmapFilter::buildExponentTable(float exponent)
+{
+	std::vector<float> table(LUT_SIZE + 1);
+
+	for (int i = 0; i < LUT_SIZE; ++i)
+	{
+		table[i] = std::pow(static_cast<float>(i) / (LUT_SIZE - 1), exponent);
+	}
+	table[LUT_SIZE] = table[LUT_SIZE - 1];
+
+	return table;
+}
+
+void HeightmapFilter::remapRow(const float* source, float* target, int count, const std::vector<float>& table)
+{
+	const float* entries = table.data();
+	const float steps = static_cast<float>(LUT_SIZE - 1);
+
+	int i = 0;
+
+#ifdef HEIGHTMAPFILTER_USE_SSE2
+	const __m128 zeros = _mm_setzero_ps();
+	const __m128 ones = _mm_set1_ps(1.0f);
+	const __m128 stepCounts = _mm_set1_ps(steps);
+
+	//SSE2 has no gather, the positions are computed four at a time and the table is read per sample
+
+	alignas(16) int indices[4];
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 positions = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i), zeros), ones), stepCounts);
+		__m128i truncated = _mm_cvttps_epi32(positions);
+		__m128 fractions = _mm_sub_ps(positions, _mm_cvtepi32_ps(truncated));
+		_mm_store_si128(reinterpret_cast<__m128i*>(indices), truncated);
+
+		__m128 lower = _mm_setr_ps(entries[indices[0]], entries[indices[1]], entries[indices[2]], entries[indices[3]]);
+		__m128 upper = _mm_setr_ps(entries[indices[0] + 1], entries[indices[1] + 1], entries[indices[2] + 1], entries[indices[3] + 1]);
+
+		_mm_storeu_ps(target + i, _mm_add_ps(lower, _mm_mul_ps(_mm_sub_ps(upper, lower), fractions)));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		float position = std::min(std::max(0.0f, source[i]), 1.0f) * steps;
+		int index = static_cast<int>(position);
+		float fraction = position - static_cast<float>(index);
+		target[i] = entries[index] + (entries[index + 1] - entries[index]) * fraction;
+	}
+}
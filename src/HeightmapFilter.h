@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "Heightmap.h"
+
+/** \brief Point operations that remap every sample of a heightmap.
+*/
+class HeightmapFilter
+{
+
+public:
+
+	static constexpr int LUT_SIZE = 65536; //!<number of quantization steps of the input range 0-1
+
+	/** \brief Raises every sample to the given power.
+	*          The curve is tabulated once and samples are interpolated from the table, rows are processed in parallel.
+	*          Samples are expected in the range 0-1, values outside of it are clamped.
+	*/
+	static Heightmap applyExponent(const Heightmap& heightmap, float exponent);
+
+private:
+
+	static constexpr int MIN_ROWS_PER_CHUNK = 16;
+
+	//!<returns the curve sampled at LUT_SIZE points, with a copy of the last one appended so that interpolation never reads past the end
+	static std::vector<float> buildExponentTable(float exponent);
+
+	static void remapRow(const float* source, float* target, int count, const std::vector<float>& table);
+};
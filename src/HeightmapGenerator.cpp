@@ -9,6 +9,11 @@
 std::default_random_engine HeightmapGenerator::m_randomEngine(std::chrono::system_clock::now().time_since_epoch().count());
 
 Heightmap HeightmapGenerator::generateDiamond(int iterations, int startAmplitude, float amplitudeModifier)
+{
+	return generateDiamond(iterations, startAmplitude, amplitudeModifier, m_randomEngine);
+}
+
+Heightmap HeightmapGenerator::generateDiamond(int iterations, int startAmplitude, float amplitudeModifier, std::default_random_engine& randomEngine)
 {
     /*
     * viz. https://code.google.com/p/fractalterraingeneration/wiki/Diamond_Square
@@ -54,7 +59,7 @@ Heightmap HeightmapGenerator::generateDiamond(int iterations, int startAmplitude
                 float average = sum / 4;
 
 				std::uniform_int_distribution<int> distribution(-amplitude, amplitude);
-                int displacement = distribution(m_randomEngine);
+                int displacement = distribution(randomEngine);
 
 				heightmap.at(row, col) = average + displacement;
             }
@@ -102,7 +107,7 @@ Heightmap HeightmapGenerator::generateDiamond(int iterations, int startAmplitude
                     float average = sum / 4.0f;
 
 					std::uniform_int_distribution<int> distribution(-amplitude, amplitude);
-					int displacement = distribution(m_randomEngine);
+					int displacement = distribution(randomEngine);
 
 					heightmap.at(row2, col2) = average + displacement;
                 }
@@ -123,6 +128,11 @@ Heightmap HeightmapGenerator::generateDiamond(int iterations, int startAmplitude
 }
 
 Heightmap HeightmapGenerator::generateCircles(int width, int height, int minRadius, int maxRadius, int minAmplitude, int maxAmplitude, int iterations)
+{
+	return generateCircles(width, height, minRadius, maxRadius, minAmplitude, maxAmplitude, iterations, m_randomEngine);
+}
+
+Heightmap HeightmapGenerator::generateCircles(int width, int height, int minRadius, int maxRadius, int minAmplitude, int maxAmplitude, int iterations, std::default_random_engine& randomEngine)
 {
     /*
     * viz. http://www.lighthouse3d.com/opengl/terrain/index.php3?circles
@@ -140,16 +150,16 @@ Heightmap HeightmapGenerator::generateCircles(int width, int height, int minRadi
     for (int it = 1; it <= iterations; ++it)
     {
 		std::uniform_int_distribution<int> distribution1(0, width - 1);
-		int centerX = distribution1(m_randomEngine);
+		int centerX = distribution1(randomEngine);
 
 		std::uniform_int_distribution<int> distribution2(0, height - 1);
-		int centerY = distribution2(m_randomEngine);
+		int centerY = distribution2(randomEngine);
 
 		std::uniform_int_distribution<int> distribution3(minRadius, maxRadius);
-		int radius = distribution3(m_randomEngine);
+		int radius = distribution3(randomEngine);
 
 		std::uniform_int_distribution<int> distribution4(minAmplitude, maxAmplitude);
-		int amplitude = distribution4(m_randomEngine);
+		int amplitude = distribution4(randomEngine);
 
         for (int x = centerX - radius; x <= centerX + radius; ++x)
         {
@@ -175,6 +185,11 @@ Heightmap HeightmapGenerator::generateCircles(int width, int height, int minRadi
 }
 
 Heightmap HeightmapGenerator::generatePerlin(int size, int octaves, float amplitudeModifier, float frequencyModifier)
+{
+	return generatePerlin(size, octaves, amplitudeModifier, frequencyModifier, m_randomEngine);
+}
+
+Heightmap HeightmapGenerator::generatePerlin(int size, int octaves, float amplitudeModifier, float frequencyModifier, std::default_random_engine& randomEngine)
 {
     /*
     * viz. http://flafla2.github.io/2014/08/09/perlinnoise.html
@@ -207,7 +222,7 @@ Heightmap HeightmapGenerator::generatePerlin(int size, int octaves, float amplit
         permutations.push_back(i);
     }
 
-    std::shuffle(permutations.begin(), permutations.end(), m_randomEngine);
+    std::shuffle(permutations.begin(), permutations.end(), randomEngine);
 
     float amplitude = 255.0f; //initial amplitude
     float frequency = 1.0f / size; //initial frequency
@@ -261,6 +276,11 @@ Heightmap HeightmapGenerator::generatePerlin(int size, int octaves, float amplit
 }
 
 Heightmap HeightmapGenerator::generateFault(int width, int height, int iterations, int startAmplitude, int endAmplitude, int amplitudeChange, faultFunctions_t function, int transitionLength)
+{
+	return generateFault(width, height, iterations, startAmplitude, endAmplitude, amplitudeChange, function, transitionLength, m_randomEngine);
+}
+
+Heightmap HeightmapGenerator::generateFault(int width, int height, int iterations, int startAmplitude, int endAmplitude, int amplitudeChange, faultFunctions_t function, int transitionLength, std::default_random_engine& randomEngine)
 {
     /*
     * viz. http://www.lighthouse3d.com/opengl/terrain/index.php3?fault
@@ -282,12 +302,12 @@ Heightmap HeightmapGenerator::generateFault(int width, int height, int iteration
     {
         //two random points which determine the dividing line
 		std::uniform_int_distribution<int> distribution1(0, width);
-		int x1 = distribution1(m_randomEngine);
-		int x2 = distribution1(m_randomEngine);
+		int x1 = distribution1(randomEngine);
+		int x2 = distribution1(randomEngine);
 
 		std::uniform_int_distribution<int> distribution2(0, height);
-		int y1 = distribution2(m_randomEngine);
-		int y2 = distribution2(m_randomEngine);
+		int y1 = distribution2(randomEngine);
+		int y2 = distribution2(randomEngine);
 
         int a = y2 - y1;
         int b = x1 - x2;
@@ -39,6 +39,9 @@ public:
     */
 	static Heightmap generateDiamond(int iterations, int startAmplitude, float amplitudeModifier);
 
+	//!<same as above, but draws from the given random engine, so that concurrent calls don't share one
+	static Heightmap generateDiamond(int iterations, int startAmplitude, float amplitudeModifier, std::default_random_engine& randomEngine);
+
     /** \brief Generates heightmap using the Circles algorithm.
     *          Emits generatingFinished() after generating is done.
     *          viz. http://www.lighthouse3d.com/opengl/terrain/index.php3?circles
@@ -53,6 +56,9 @@ public:
     */
 	static Heightmap generateCircles(int width, int height, int minRadius, int maxRadius, int minAmplitude, int maxAmplitude, int iterations);
 
+	//!<same as above, but draws from the given random engine, so that concurrent calls don't share one
+	static Heightmap generateCircles(int width, int height, int minRadius, int maxRadius, int minAmplitude, int maxAmplitude, int iterations, std::default_random_engine& randomEngine);
+
     /** \brief Generates heightmap using the Perlin Noise algorithm.
     *          Emits generatingFinished() after generating is done.
     *          viz. http://flafla2.github.io/2014/08/09/perlinnoise.html
@@ -65,6 +71,9 @@ public:
     */
 	static Heightmap generatePerlin(int size, int octaves, float amplitudeModifier, float frequencyModifier);
 
+	//!<same as above, but draws from the given random engine, so that concurrent calls don't share one
+	static Heightmap generatePerlin(int size, int octaves, float amplitudeModifier, float frequencyModifier, std::default_random_engine& randomEngine);
+
     /** \brief Generates heightmap using the Fault Formation algorithm.
     *          Emits generatingFinished() after generating is done.
     *          viz. http://www.lighthouse3d.com/opengl/terrain/index.php3?fault
@@ -80,6 +89,9 @@ public:
     */
 	static Heightmap generateFault(int width, int height, int iterations, int startAmplitude, int endAmplitude, int amplitudeChange, faultFunctions_t function, int transitionLength);
 
+	//!<same as above, but draws from the given random engine, so that concurrent calls don't share one
+	static Heightmap generateFault(int width, int height, int iterations, int startAmplitude, int endAmplitude, int amplitudeChange, faultFunctions_t function, int transitionLength, std::default_random_engine& randomEngine);
+
 };
 
 
@@ -0,0 +1,443 @@
+#include "HeightmapGraph.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+
+#include "FlowAnalysis.h"
+#include "HeightmapFilter.h"
+#include "HeightmapGenerator.h"
+#include "HydraulicErosion.h"
+#include "Parallel.h"
+#include "ThermalErosion.h"
+
+int HeightmapGraph::addNode(nodeTypes_t type, const std::vector<double>& parameters, const std::vector<int>& inputs)
+{
+	if (static_cast<int>(parameters.size()) != getParameterCount(type) || static_cast<int>(inputs.size()) != getInputCount(type))
+	{
+		return -1;
+	}
+
+	for (int input : inputs)
+	{
+		if (input < 0 || input >= getNodeCount())
+		{
+			return -1;
+		}
+	}
+
+	Node node;
+	node.m_type = type;
+	node.m_parameters = parameters;
+	node.m_inputs = inputs;
+	m_nodes.push_back(node);
+
+	return getNodeCount() - 1;
+}
+
+bool HeightmapGraph::setParameters(int node, const std::vector<double>& parameters)
+{
+	if (node < 0 || node >= getNodeCount() || static_cast<int>(parameters.size()) != getParameterCount(m_nodes[node].m_type))
+	{
+		return false;
+	}
+
+	m_nodes[node].m_parameters = parameters;
+
+	return true;
+}
+
+bool HeightmapGraph::setInputs(int node, const std::vector<int>& inputs)
+{
+	if (node < 0 || node >= getNodeCount() || static_cast<int>(inputs.size()) != getInputCount(m_nodes[node].m_type))
+	{
+		return false;
+	}
+
+	for (int input : inputs)
+	{
+		if (input < 0 || input >= getNodeCount() || input == node || dependsOn(input, node))
+		{
+			return false;
+		}
+	}
+
+	m_nodes[node].m_inputs = inputs;
+
+	return true;
+}
+
+const std::vector<double>& HeightmapGraph::getParameters(int node) const
+{
+	return m_nodes[node].m_parameters;
+}
+
+const std::vector<int>& HeightmapGraph::getInputs(int node) const
+{
+	return m_nodes[node].m_inputs;
+}
+
+HeightmapGraph::nodeTypes_t HeightmapGraph::getType(int node) const
+{
+	return m_nodes[node].m_type;
+}
+
+int HeightmapGraph::getNodeCount() const
+{
+	return static_cast<int>(m_nodes.size());
+}
+
+std::shared_ptr<const Heightmap> HeightmapGraph::evaluate(int node)
+{
+	if (node < 0 || node >= getNodeCount())
+	{
+		return std::make_shared<const Heightmap>();
+	}
+
+	//depth first search for the nodes upstream, each one is appended after all of its inputs
+
+	std::vector<int> order;
+	std::vector<bool> visited(m_nodes.size(), false);
+	std::vector<std::pair<int, size_t>> stack = { { node, 0 } };
+	visited[node] = true;
+
+	while (!stack.empty())
+	{
+		int current = stack.back().first;
+		size_t nextInput = stack.back().second;
+
+		if (nextInput < m_nodes[current].m_inputs.size())
+		{
+			++stack.back().second;
+			int input = m_nodes[current].m_inputs[nextInput];
+
+			if (!visited[input])
+			{
+				visited[input] = true;
+				stack.emplace_back(input, 0);
+			}
+		}
+		else
+		{
+			order.push_back(current);
+			stack.pop_back();
+		}
+	}
+
+	//a node has to be computed if its hash changed, the hash of its inputs is part of it, so changes propagate downstream.
+	//nodes are grouped by their distance from the sources, the nodes of one group don't depend on each other
+
+	std::vector<uint64_t> hashes(m_nodes.size(), 0);
+	std::vector<int> levels(m_nodes.size(), 0);
+	std::vector<std::vector<int>> outdatedLevels;
+
+	for (int current : order)
+	{
+		const Node& currentNode = m_nodes[current];
+		std::vector<uint64_t> inputHashes;
+		int level = 0;
+
+		for (int input : currentNode.m_inputs)
+		{
+			inputHashes.push_back(hashes[input]);
+			level = std::max(level, levels[input] + 1);
+		}
+
+		hashes[current] = hashNode(currentNode, inputHashes);
+		levels[current] = level;
+
+		if (currentNode.m_result == nullptr || currentNode.m_resultHash != hashes[current])
+		{
+			if (static_cast<int>(outdatedLevels.size()) <= level)
+			{
+				outdatedLevels.resize(level + 1);
+			}
+			outdatedLevels[level].push_back(current);
+		}
+	}
+
+	for (std::vector<int>& outdatedNodes : outdatedLevels)
+	{
+		QtConcurrent::blockingMap(outdatedNodes, [this, &hashes](int current)
+		{
+			Node& currentNode = m_nodes[current];
+			std::vector<const Heightmap*> inputs;
+
+			for (int input : currentNode.m_inputs)
+			{
+				inputs.push_back(m_nodes[input].m_result.get());
+			}
+
+			currentNode.m_result = std::make_shared<const Heightmap>(compute(currentNode, inputs, hashes[current]));
+			currentNode.m_resultHash = hashes[current];
+		});
+	}
+
+	return m_nodes[node].m_result;
+}
+
+int HeightmapGraph::getParameterCount(nodeTypes_t type)
+{
+	switch (type)
+	{
+	case nodeTypes_t::DIAMOND:
+		return 3;
+	case nodeTypes_t::CIRCLES:
+		return 7;
+	case nodeTypes_t::PERLIN:
+		return 4;
+	case nodeTypes_t::FAULT:
+		return 8;
+	case nodeTypes_t::EXPONENT:
+		return 1;
+	case nodeTypes_t::HYDRAULIC_EROSION:
+	case nodeTypes_t::THERMAL_EROSION:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+int HeightmapGraph::getInputCount(nodeTypes_t type)
+{
+	switch (type)
+	{
+	case nodeTypes_t::DIAMOND:
+	case nodeTypes_t::CIRCLES:
+	case nodeTypes_t::PERLIN:
+	case nodeTypes_t::FAULT:
+		return 0;
+	case nodeTypes_t::ADD:
+	case nodeTypes_t::MULTIPLY:
+	case nodeTypes_t::MAX:
+		return 2;
+	case nodeTypes_t::LERP:
+		return 3;
+	default:
+		return 1;
+	}
+}
+
+bool HeightmapGraph::dependsOn(int node, int other) const
+{
+	std::vector<bool> visited(m_nodes.size(), false);
+	std::vector<int> stack = { node };
+
+	while (!stack.empty())
+	{
+		int current = stack.back();
+		stack.pop_back();
+
+		for (int input : m_nodes[current].m_inputs)
+		{
+			if (input == other)
+			{
+				return true;
+			}
+
+			if (!visited[input])
+			{
+				visited[input] = true;
+				stack.push_back(input);
+			}
+		}
+	}
+
+	return false;
+}
+
+Heightmap HeightmapGraph::compute(const Node& node, const std::vector<const Heightmap*>& inputs, uint64_t hash)
+{
+	const std::vector<double>& parameters = node.m_parameters;
+
+	//every generator gets its own engine seeded from the node's hash, so they can run concurrently and give the same result every time
+
+	std::seed_seq seedSequence = { static_cast<uint32_t>(hash), static_cast<uint32_t>(hash >> 32) };
+	std::default_random_engine randomEngine(seedSequence);
+
+	switch (node.m_type)
+	{
+	case nodeTypes_t::DIAMOND:
+	{
+		return HeightmapGenerator::generateDiamond(static_cast<int>(parameters[0]), static_cast<int>(parameters[1]), static_cast<float>(parameters[2]), randomEngine);
+	}
+	case nodeTypes_t::CIRCLES:
+	{
+		return HeightmapGenerator::generateCircles(
+			static_cast<int>(parameters[0]),
+			static_cast<int>(parameters[1]),
+			static_cast<int>(parameters[2]),
+			static_cast<int>(parameters[3]),
+			static_cast<int>(parameters[4]),
+			static_cast<int>(parameters[5]),
+			static_cast<int>(parameters[6]),
+			randomEngine);
+	}
+	case nodeTypes_t::PERLIN:
+	{
+		return HeightmapGenerator::generatePerlin(
+			static_cast<int>(parameters[0]),
+			static_cast<int>(parameters[1]),
+			static_cast<float>(parameters[2]),
+			static_cast<float>(parameters[3]),
+			randomEngine);
+	}
+	case nodeTypes_t::FAULT:
+	{
+		return HeightmapGenerator::generateFault(
+			static_cast<int>(parameters[0]),
+			static_cast<int>(parameters[1]),
+			static_cast<int>(parameters[2]),
+			static_cast<int>(parameters[3]),
+			static_cast<int>(parameters[4]),
+			static_cast<int>(parameters[5]),
+			HeightmapGenerator::faultFunctions_t(static_cast<int>(parameters[6])),
+			static_cast<int>(parameters[7]),
+			randomEngine);
+	}
+	case nodeTypes_t::ADD:
+	case nodeTypes_t::MULTIPLY:
+	case nodeTypes_t::MAX:
+	case nodeTypes_t::LERP:
+	{
+		int width = inputs[0]->getWidth();
+		int height = inputs[0]->getHeight();
+
+		std::vector<Heightmap> resized(inputs.size());
+		std::vector<const Heightmap*> sources(inputs);
+
+		for (size_t i = 1; i < inputs.size(); ++i)
+		{
+			if (inputs[i]->getWidth() != width || inputs[i]->getHeight() != height)
+			{
+				resized[i] = resize(*inputs[i], width, height);
+				sources[i] = &resized[i];
+			}
+		}
+
+		Heightmap result(width, height);
+		nodeTypes_t type = node.m_type;
+
+		Parallel::forRange(height, [&result, &sources, type, width](int begin, int end)
+		{
+			for (int row = begin; row < end; ++row)
+			{
+				const float* first = sources[0]->getRow(row);
+				const float* second = sources[1]->getRow(row);
+				const float* mask = sources.size() > 2 ? sources[2]->getRow(row) : first;
+				float* values = result.getRow(row);
+
+				for (int col = 0; col < width; ++col)
+				{
+					values[col] = combine(type, first[col], second[col], mask[col]);
+				}
+			}
+		});
+
+		return result;
+	}
+	case nodeTypes_t::EXPONENT:
+		return HeightmapFilter::applyExponent(*inputs[0], static_cast<float>(parameters[0]));
+	case nodeTypes_t::HYDRAULIC_EROSION:
+		return HydraulicErosion::erode(*inputs[0], static_cast<int>(parameters[0]), static_cast<uint32_t>(parameters[1]));
+	case nodeTypes_t::THERMAL_EROSION:
+		return ThermalErosion::erode(*inputs[0], static_cast<int>(parameters[0]), static_cast<float>(parameters[1]));
+	case nodeTypes_t::FILL_DEPRESSIONS:
+		return FlowAnalysis::fillDepressions(*inputs[0]);
+	case nodeTypes_t::NORMALIZE:
+	{
+		Heightmap result = *inputs[0];
+		result.normalize();
+		return result;
+	}
+	default:
+		return Heightmap();
+	}
+}
+
+float HeightmapGraph::combine(nodeTypes_t type, float first, float second, float mask)
+{
+	switch (type)
+	{
+	case nodeTypes_t::ADD:
+		return first + second;
+	case nodeTypes_t::MULTIPLY:
+		return first * second;
+	case nodeTypes_t::MAX:
+		return std::max(first, second);
+	default:
+		return first + (second - first) * mask;
+	}
+}
+
+Heightmap HeightmapGraph::resize(const Heightmap& heightmap, int width, int height)
+{
+	Heightmap result(width, height);
+
+	if (heightmap.isEmpty() || result.isEmpty())
+	{
+		return result;
+	}
+
+	//corners map onto corners, samples in between are interpolated bilinearly
+
+	float scaleX = width > 1 ? static_cast<float>(heightmap.getWidth() - 1) / (width - 1) : 0.0f;
+	float scaleY = height > 1 ? static_cast<float>(heightmap.getHeight() - 1) / (height - 1) : 0.0f;
+
+	Parallel::forRange(height, [&heightmap, &result, width, scaleX, scaleY](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			float sourceY = row * scaleY;
+			int sourceRow = std::min(static_cast<int>(sourceY), heightmap.getHeight() - 1);
+			int nextRow = std::min(sourceRow + 1, heightmap.getHeight() - 1);
+			float offsetY = sourceY - sourceRow;
+
+			const float* top = heightmap.getRow(sourceRow);
+			const float* bottom = heightmap.getRow(nextRow);
+			float* values = result.getRow(row);
+
+			for (int col = 0; col < width; ++col)
+			{
+				float sourceX = col * scaleX;
+				int sourceCol = std::min(static_cast<int>(sourceX), heightmap.getWidth() - 1);
+				int nextCol = std::min(sourceCol + 1, heightmap.getWidth() - 1);
+				float offsetX = sourceX - sourceCol;
+
+				float upper = top[sourceCol] + (top[nextCol] - top[sourceCol]) * offsetX;
+				float lower = bottom[sourceCol] + (bottom[nextCol] - bottom[sourceCol]) * offsetX;
+				values[col] = upper + (lower - upper) * offsetY;
+			}
+		}
+	});
+
+	return result;
+}
+
+uint64_t HeightmapGraph::hashNode(const Node& node, const std::vector<uint64_t>& inputHashes)
+{
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+
+	auto hashBytes = [&hash, FNV_PRIME](const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+	};
+
+	int type = static_cast<int>(node.m_type);
+	hashBytes(&type, sizeof(type));
+	hashBytes(node.m_parameters.data(), node.m_parameters.size() * sizeof(double));
+	hashBytes(inputHashes.data(), inputHashes.size() * sizeof(uint64_t));
+
+	return hash;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Heightmap.h"
+
+/** \brief Directed acyclic graph of heightmap generators, combinations and filters.
+*          Every node keeps its last result together with a hash of its type, parameters and the hashes of its inputs.
+*          Evaluating a node only recomputes the upstream nodes whose hash changed, so changing one parameter
+*          re-evaluates that node and the nodes below it. Nodes that don't depend on each other are evaluated in parallel.
+*          Generators draw from a random engine seeded with the hash of their node, so equal parameters give equal heightmaps.
+*
+*          Parameters of the node types, in this order:
+*          - DIAMOND: iterations, start amplitude, amplitude modifier
+*          - CIRCLES: width, height, min radius, max radius, min amplitude, max amplitude, iterations
+*          - PERLIN: size, octaves, amplitude modifier, frequency modifier
+*          - FAULT: width, height, iterations, start amplitude, end amplitude, amplitude change, function, transition length
+*          - EXPONENT: exponent
+*          - HYDRAULIC_EROSION: droplet count, seed
+*          - THERMAL_EROSION: iterations, talus
+*          - the others have none.
+*/
+class HeightmapGraph
+{
+
+public:
+
+	enum class nodeTypes_t
+	{
+		DIAMOND,
+		CIRCLES,
+		PERLIN,
+		FAULT,
+		ADD, //!<sum of two inputs
+		MULTIPLY, //!<product of two inputs
+		MAX, //!<maximum of two inputs
+		LERP, //!<first input blended into the second by the third
+		EXPONENT,
+		HYDRAULIC_EROSION,
+		THERMAL_EROSION,
+		FILL_DEPRESSIONS,
+		NORMALIZE
+	};
+
+	HeightmapGraph() = default;
+
+	HeightmapGraph(const HeightmapGraph& other) = default;
+
+	HeightmapGraph(HeightmapGraph&& other) = default;
+
+	HeightmapGraph& operator=(const HeightmapGraph& other) = default;
+
+	HeightmapGraph& operator=(HeightmapGraph&& other) = default;
+
+	~HeightmapGraph() = default;
+
+	/** \brief Adds a node, inputs have to exist already so that no cycle can be formed.
+	*          Inputs of another size are resampled to the size of the first input.
+	*   \return Id of the node, -1 if the number of parameters or inputs doesn't match the type or an input doesn't exist.
+	*/
+	int addNode(nodeTypes_t type, const std::vector<double>& parameters, const std::vector<int>& inputs);
+
+	//!<returns false if the node doesn't exist or the number of parameters doesn't match its type
+	bool setParameters(int node, const std::vector<double>& parameters);
+
+	//!<returns false if the node doesn't exist, the number of inputs doesn't match its type or an input would close a cycle
+	bool setInputs(int node, const std::vector<int>& inputs);
+
+	const std::vector<double>& getParameters(int node) const;
+
+	const std::vector<int>& getInputs(int node) const;
+
+	nodeTypes_t getType(int node) const;
+
+	int getNodeCount() const;
+
+	/** \brief Returns the result of the node, computing whatever changed upstream since the last evaluation.
+	*          Has to be called from one thread at a time.
+	*   \return The result, an empty heightmap if the id is invalid.
+	*/
+	std::shared_ptr<const Heightmap> evaluate(int node);
+
+	static int getParameterCount(nodeTypes_t type);
+
+	static int getInputCount(nodeTypes_t type);
+
+private:
+
+	struct Node
+	{
+		nodeTypes_t m_type;
+		std::vector<double> m_parameters;
+		std::vector<int> m_inputs;
+		uint64_t m_resultHash = 0; //!<hash of the evaluation m_result comes from
+		std::shared_ptr<const Heightmap> m_result;
+	};
+
+	std::vector<Node> m_nodes;
+
+	bool dependsOn(int node, int other) const;
+
+	//!<computes the node from the results of its inputs, generators draw from an engine seeded with the hash of the node
+	static Heightmap compute(const Node& node, const std::vector<const Heightmap*>& inputs, uint64_t hash);
+
+	//!<combines two samples for the combination types
+	static float combine(nodeTypes_t type, float first, float second, float mask);
+
+	static Heightmap resize(const Heightmap& heightmap, int width, int height);
+
+	static uint64_t hashNode(const Node& node, const std::vector<uint64_t>& inputHashes);
+};
@@ -0,0 +1,286 @@
+#include "HeightmapHistory.h"
+
+#include <algorithm>
+#include <utility>
+
+void HeightmapHistory::push(const Heightmap& heightmap)
+{
+	Snapshot snapshot;
+	snapshot.m_width = heightmap.getWidth();
+	snapshot.m_height = heightmap.getHeight();
+
+	int tileCount = getTileCount(snapshot.m_width) * getTileCount(snapshot.m_height);
+	snapshot.m_tiles.resize(tileCount);
+
+	//a filter may leave large parts of the heightmap as they were, those tiles are shared with the current state
+
+	const Snapshot* current = m_current >= 0 ? &m_snapshots[m_current] : nullptr;
+	bool sameSize = current != nullptr && current->m_width == snapshot.m_width && current->m_height == snapshot.m_height;
+
+	for (int tile = 0; tile < tileCount; ++tile)
+	{
+		HeightmapRect rect = getTileRect(tile, snapshot.m_width, snapshot.m_height);
+		snapshot.m_tiles[tile] = captureTile(heightmap, rect, sameSize ? current->m_tiles[tile] : nullptr);
+	}
+
+	append(std::move(snapshot));
+}
+
+void HeightmapHistory::push(const Heightmap& heightmap, const std::vector<HeightmapRect>& changedRects)
+{
+	if (m_current < 0 || m_snapshots[m_current].m_width != heightmap.getWidth() || m_snapshots[m_current].m_height != heightmap.getHeight())
+	{
+		push(heightmap);
+		return;
+	}
+
+	Snapshot snapshot = m_snapshots[m_current];
+	snapshot.m_ownedBytes = 0;
+
+	int tileColumns = getTileCount(snapshot.m_width);
+
+	for (const HeightmapRect& changedRect : changedRects)
+	{
+		if (changedRect.m_left >= changedRect.m_right || changedRect.m_top >= changedRect.m_bottom)
+		{
+			continue;
+		}
+
+		int firstColumn = std::max(changedRect.m_left, 0) / TILE_SIZE;
+		int lastColumn = std::min((changedRect.m_right - 1) / TILE_SIZE, tileColumns - 1);
+		int firstRow = std::max(changedRect.m_top, 0) / TILE_SIZE;
+		int lastRow = std::min((changedRect.m_bottom - 1) / TILE_SIZE, getTileCount(snapshot.m_height) - 1);
+
+		for (int row = firstRow; row <= lastRow; ++row)
+		{
+			for (int column = firstColumn; column <= lastColumn; ++column)
+			{
+				int tile = row * tileColumns + column;
+
+				//a tile covered by several rectangles is only captured once
+
+				if (snapshot.m_tiles[tile] == m_snapshots[m_current].m_tiles[tile])
+				{
+					HeightmapRect rect = getTileRect(tile, snapshot.m_width, snapshot.m_height);
+					snapshot.m_tiles[tile] = captureTile(heightmap, rect, snapshot.m_tiles[tile]);
+				}
+			}
+		}
+	}
+
+	append(std::move(snapshot));
+}
+
+bool HeightmapHistory::canUndo() const
+{
+	return m_current > 0;
+}
+
+bool HeightmapHistory::canRedo() const
+{
+	return m_current >= 0 && m_current + 1 < static_cast<int>(m_snapshots.size());
+}
+
+bool HeightmapHistory::undo(Heightmap& heightmap)
+{
+	if (!canUndo())
+	{
+		return false;
+	}
+
+	restore(m_snapshots[m_current - 1], m_snapshots[m_current], heightmap);
+	m_current--;
+
+	return true;
+}
+
+bool HeightmapHistory::redo(Heightmap& heightmap)
+{
+	if (!canRedo())
+	{
+		return false;
+	}
+
+	restore(m_snapshots[m_current + 1], m_snapshots[m_current], heightmap);
+	m_current++;
+
+	return true;
+}
+
+void HeightmapHistory::setMemoryBudget(size_t bytes)
+{
+	m_memoryBudget = bytes;
+
+	enforceMemoryBudget();
+}
+
+size_t HeightmapHistory::getMemoryBudget() const
+{
+	return m_memoryBudget;
+}
+
+size_t HeightmapHistory::getMemoryUsage() const
+{
+	return m_memoryUsage;
+}
+
+void HeightmapHistory::clear()
+{
+	m_snapshots.clear();
+	m_current = -1;
+	m_memoryUsage = 0;
+}
+
+void HeightmapHistory::append(Snapshot snapshot)
+{
+	//a new state makes the states that could have been redone unreachable
+
+	while (static_cast<int>(m_snapshots.size()) > m_current + 1)
+	{
+		m_memoryUsage -= m_snapshots.back().m_ownedBytes;
+		m_snapshots.pop_back();
+	}
+
+	const Snapshot* previous = m_current >= 0 ? &m_snapshots[m_current] : nullptr;
+	bool sameSize = previous != nullptr && previous->m_width == snapshot.m_width && previous->m_height == snapshot.m_height;
+
+	snapshot.m_ownedBytes = 0;
+	for (size_t tile = 0; tile < snapshot.m_tiles.size(); ++tile)
+	{
+		if (!sameSize || snapshot.m_tiles[tile] != previous->m_tiles[tile])
+		{
+			snapshot.m_ownedBytes += snapshot.m_tiles[tile]->size() * sizeof(float);
+		}
+	}
+
+	m_memoryUsage += snapshot.m_ownedBytes;
+	m_snapshots.push_back(std::move(snapshot));
+	m_current++;
+
+	enforceMemoryBudget();
+}
+
+void HeightmapHistory::enforceMemoryBudget()
+{
+	//a tile is only ever shared by consecutive snapshots, so dropping a snapshot frees exactly the tiles
+	//it doesn't share with its neighbours, the oldest one goes first and the newest redo state last
+
+	while (m_memoryUsage > m_memoryBudget && m_snapshots.size() > 1)
+	{
+		if (m_current > 0)
+		{
+			m_memoryUsage -= m_snapshots.front().m_ownedBytes;
+			m_snapshots.pop_front();
+			m_current--;
+
+			Snapshot& oldest = m_snapshots.front();
+			size_t bytes = getBytes(oldest);
+			m_memoryUsage += bytes - oldest.m_ownedBytes;
+			oldest.m_ownedBytes = bytes;
+		}
+		else
+		{
+			m_memoryUsage -= m_snapshots.back().m_ownedBytes;
+			m_snapshots.pop_back();
+		}
+	}
+}
+
+void HeightmapHistory::restore(const Snapshot& target, const Snapshot& current, Heightmap& heightmap) const
+{
+	bool sameSize = target.m_width == current.m_width && target.m_height == current.m_height &&
+		heightmap.getWidth() == target.m_width && heightmap.getHeight() == target.m_height;
+
+	if (!sameSize)
+	{
+		heightmap.setSize(target.m_width, target.m_height);
+		heightmap.markDirty();
+	}
+
+	for (size_t tile = 0; tile < target.m_tiles.size(); ++tile)
+	{
+		if (sameSize && target.m_tiles[tile] == current.m_tiles[tile])
+		{
+			continue;
+		}
+
+		HeightmapRect rect = getTileRect(static_cast<int>(tile), target.m_width, target.m_height);
+		int width = rect.m_right - rect.m_left;
+		const float* samples = target.m_tiles[tile]->data();
+
+		for (int row = rect.m_top; row < rect.m_bottom; ++row)
+		{
+			std::copy(samples, samples + width, heightmap.getRow(row) + rect.m_left);
+			samples += width;
+		}
+
+		if (sameSize)
+		{
+			heightmap.markDirty(rect);
+		}
+	}
+}
+
+int HeightmapHistory::getTileCount(int size)
+{
+	return (size + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+HeightmapRect HeightmapHistory::getTileRect(int tile, int width, int height)
+{
+	int tileColumns = getTileCount(width);
+
+	HeightmapRect rect;
+	rect.m_left = (tile % tileColumns) * TILE_SIZE;
+	rect.m_top = (tile / tileColumns) * TILE_SIZE;
+	rect.m_right = std::min(rect.m_left + TILE_SIZE, width);
+	rect.m_bottom = std::min(rect.m_top + TILE_SIZE, height);
+
+	return rect;
+}
+
+std::shared_ptr<const HeightmapHistory::Tile> HeightmapHistory::captureTile(const Heightmap& heightmap, const HeightmapRect& rect, const std::shared_ptr<const Tile>& previous)
+{
+	int width = rect.m_right - rect.m_left;
+	int height = rect.m_bottom - rect.m_top;
+
+	if (previous != nullptr)
+	{
+		bool equal = true;
+		const float* samples = previous->data();
+
+		for (int row = rect.m_top; row < rect.m_bottom && equal; ++row)
+		{
+			const float* heights = heightmap.getRow(row) + rect.m_left;
+			equal = std::equal(heights, heights + width, samples);
+			samples += width;
+		}
+
+		if (equal)
+		{
+			return previous;
+		}
+	}
+
+	std::shared_ptr<Tile> tile = std::make_shared<Tile>();
+	tile->reserve(static_cast<size_t>(width) * height);
+
+	for (int row = rect.m_top; row < rect.m_bottom; ++row)
+	{
+		const float* heights = heightmap.getRow(row) + rect.m_left;
+		tile->insert(tile->end(), heights, heights + width);
+	}
+
+	return tile;
+}
+
+size_t HeightmapHistory::getBytes(const Snapshot& snapshot)
+{
+	size_t bytes = 0;
+	for (const std::shared_ptr<const Tile>& tile : snapshot.m_tiles)
+	{
+		bytes += tile->size() * sizeof(float);
+	}
+
+	return bytes;
+}
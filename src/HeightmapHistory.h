@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "Heightmap.h"
+
+/** \brief Undo and redo history of a heightmap.
+*          Every state is stored as a grid of reference counted tiles, a state shares all tiles that are
+*          unchanged with the state before it, so a step only costs memory and time for the tiles it modified.
+*          The oldest states are dropped when the tiles exceed the memory budget.
+*/
+class HeightmapHistory
+{
+
+public:
+
+	static constexpr int TILE_SIZE = 64; //!<samples along each side of a tile, tiles at the right and bottom border are cropped
+	static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024; //!<bytes
+
+	HeightmapHistory() = default;
+
+	HeightmapHistory(const HeightmapHistory& other) = delete;
+
+	HeightmapHistory(HeightmapHistory&& other) = delete;
+
+	HeightmapHistory& operator=(const HeightmapHistory& other) = delete;
+
+	HeightmapHistory& operator=(HeightmapHistory&& other) = delete;
+
+	~HeightmapHistory() = default;
+
+	/** \brief Records the heightmap as the newest state and drops the states that could have been redone.
+	*          Tiles equal to those of the current state are shared instead of copied.
+	*/
+	void push(const Heightmap& heightmap);
+
+	/** \brief Records a state that differs from the current one only inside the rectangles.
+	*          Only the tiles overlapping the rectangles are looked at, local edits should use this.
+	*/
+	void push(const Heightmap& heightmap, const std::vector<HeightmapRect>& changedRects);
+
+	bool canUndo() const;
+
+	bool canRedo() const;
+
+	/** \brief Steps back one state and writes the tiles that differ from the current state into the heightmap.
+	*   \param heightmap Has to hold the current state, the rectangles of the written tiles are marked dirty.
+	*   \return False if there is no older state.
+	*/
+	bool undo(Heightmap& heightmap);
+
+	//!<same as undo() in the other direction
+	bool redo(Heightmap& heightmap);
+
+	//!<drops the oldest states, or the newest redo states, until the tiles fit into the budget, the current state is always kept
+	void setMemoryBudget(size_t bytes);
+
+	size_t getMemoryBudget() const;
+
+	//!<bytes held by the tiles of all states
+	size_t getMemoryUsage() const;
+
+	void clear();
+
+private:
+
+	using Tile = std::vector<float>;
+
+	struct Snapshot
+	{
+		int m_width = 0;
+		int m_height = 0;
+		std::vector<std::shared_ptr<const Tile>> m_tiles; //!<rows of tiles one after another
+		size_t m_ownedBytes = 0; //!<bytes of the tiles that the previous snapshot doesn't share
+	};
+
+	std::deque<Snapshot> m_snapshots; //!<oldest first
+	int m_current = -1; //!<index of the state the heightmap is in, -1 if the history is empty
+	size_t m_memoryBudget = DEFAULT_MEMORY_BUDGET;
+	size_t m_memoryUsage = 0;
+
+	void append(Snapshot snapshot);
+
+	void enforceMemoryBudget();
+
+	void restore(const Snapshot& target, const Snapshot& current, Heightmap& heightmap) const;
+
+	static int getTileCount(int size);
+
+	static HeightmapRect getTileRect(int tile, int width, int height);
+
+	//!<copies the samples of the tile, or shares the previous tile if they are equal
+	static std::shared_ptr<const Tile> captureTile(const Heightmap& heightmap, const HeightmapRect& rect, const std::shared_ptr<const Tile>& previous);
+
+	static size_t getBytes(const Snapshot& snapshot);
+};
@@ -0,0 +1,260 @@
+#include "HydraulicErosion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "Parallel.h"
+
+Heightmap HydraulicErosion::erode(const Heightmap& heightmap, int dropletCount, uint32_t seed)
+{
+	Heightmap result = heightmap;
+
+	int width = result.getWidth();
+	int height = result.getHeight();
+
+	if (width < 2 || height < 2 || dropletCount <= 0)
+	{
+		return result;
+	}
+
+	std::vector<BrushSample> brush = createBrush();
+	float* heights = result.getRow(0);
+
+	//droplets start below the last row and column, so that their bilinear neighbours exist
+
+	int tileCountX = (width - 1 + TILE_SIZE - 1) / TILE_SIZE;
+	int tileCountY = (height - 1 + TILE_SIZE - 1) / TILE_SIZE;
+	int64_t startArea = static_cast<int64_t>(width - 1) * (height - 1);
+
+	std::vector<Tile> phases[4];
+
+	for (int tileY = 0; tileY < tileCountY; ++tileY)
+	{
+		for (int tileX = 0; tileX < tileCountX; ++tileX)
+		{
+			Tile tile;
+			tile.m_beginX = tileX * TILE_SIZE;
+			tile.m_beginY = tileY * TILE_SIZE;
+			tile.m_endX = std::min(tile.m_beginX + TILE_SIZE, width - 1);
+			tile.m_endY = std::min(tile.m_beginY + TILE_SIZE, height - 1);
+			tile.m_index = tileY * tileCountX + tileX;
+
+			phases[(tileX & 1) | ((tileY & 1) << 1)].push_back(tile);
+		}
+	}
+
+	int64_t batchSize = std::max<int64_t>(static_cast<int64_t>(width) * height / CELLS_PER_BATCH_DROPLET, 1);
+	int remainingDroplets = dropletCount;
+
+	for (int batch = 0; remainingDroplets > 0; ++batch)
+	{
+		int batchDroplets = static_cast<int>(std::min<int64_t>(remainingDroplets, batchSize));
+		remainingDroplets -= batchDroplets;
+
+		for (const std::vector<Tile>& phase : phases)
+		{
+			Parallel::forRange(static_cast<int>(phase.size()), [&](int begin, int end)
+			{
+				for (int i = begin; i < end; ++i)
+				{
+					const Tile& tile = phase[i];
+
+					//droplets are distributed by area, rounding at the cumulative start area keeps the total exact
+
+					int64_t areaBefore = static_cast<int64_t>(tile.m_beginY) * (width - 1)
+						+ static_cast<int64_t>(tile.m_endY - tile.m_beginY) * tile.m_beginX;
+					int64_t area = static_cast<int64_t>(tile.m_endX - tile.m_beginX) * (tile.m_endY - tile.m_beginY);
+
+					int64_t first = batchDroplets * areaBefore / startArea;
+					int64_t last = batchDroplets * (areaBefore + area) / startArea;
+
+					erodeTile(heights, width, height, tile, static_cast<int>(last - first), seed, batch, brush);
+				}
+			});
+		}
+	}
+
+	return result;
+}
+
+std::vector<HydraulicErosion::BrushSample> HydraulicErosion::createBrush()
+{
+	std::vector<BrushSample> brush;
+	float weightSum = 0.0f;
+
+	for (int offsetY = -EROSION_RADIUS; offsetY <= EROSION_RADIUS; ++offsetY)
+	{
+		for (int offsetX = -EROSION_RADIUS; offsetX <= EROSION_RADIUS; ++offsetX)
+		{
+			float weight = static_cast<float>(EROSION_RADIUS) - std::sqrt(static_cast<float>(offsetX * offsetX + offsetY * offsetY));
+
+			if (weight > 0.0f)
+			{
+				brush.push_back({ offsetX, offsetY, weight });
+				weightSum += weight;
+			}
+		}
+	}
+
+	for (BrushSample& sample : brush)
+	{
+		sample.m_weight /= weightSum;
+	}
+
+	return brush;
+}
+
+void HydraulicErosion::erodeTile(float* heights, int width, int height, const Tile& tile, int dropletCount,
+	uint32_t seed, int batch, const std::vector<BrushSample>& brush)
+{
+	//std::mt19937 is fully specified by the standard, unlike the distributions, so positions are derived from it directly
+
+	std::seed_seq seedSequence = { seed, static_cast<uint32_t>(batch), static_cast<uint32_t>(tile.m_index) };
+	std::mt19937 randomEngine(seedSequence);
+
+	const float positionScale = 1.0f / 16777216.0f;
+	float tileWidth = static_cast<float>(tile.m_endX - tile.m_beginX);
+	float tileHeight = static_cast<float>(tile.m_endY - tile.m_beginY);
+
+	//far from the origin the sum can round up to the end of the tile, which is the last grid node on the border of the heightmap
+
+	float maxX = std::nextafter(static_cast<float>(tile.m_endX), 0.0f);
+	float maxY = std::nextafter(static_cast<float>(tile.m_endY), 0.0f);
+
+	for (int droplet = 0; droplet < dropletCount; ++droplet)
+	{
+		float x = std::min(tile.m_beginX + static_cast<float>(randomEngine() >> 8) * positionScale * tileWidth, maxX);
+		float y = std::min(tile.m_beginY + static_cast<float>(randomEngine() >> 8) * positionScale * tileHeight, maxY);
+		float directionX = 0.0f;
+		float directionY = 0.0f;
+		float speed = INITIAL_SPEED;
+		float water = INITIAL_WATER;
+		float sediment = 0.0f;
+
+		for (int step = 0; step < MAX_LIFETIME; ++step)
+		{
+			int nodeX = static_cast<int>(x);
+			int nodeY = static_cast<int>(y);
+			float offsetX = x - nodeX;
+			float offsetY = y - nodeY;
+
+			float gradientX;
+			float gradientY;
+			float currentHeight = getHeightAndGradient(heights, width, x, y, gradientX, gradientY);
+
+			directionX = directionX * INERTIA - gradientX * (1.0f - INERTIA);
+			directionY = directionY * INERTIA - gradientY * (1.0f - INERTIA);
+
+			float length = std::sqrt(directionX * directionX + directionY * directionY);
+
+			if (length == 0.0f)
+			{
+				break;
+			}
+
+			directionX /= length;
+			directionY /= length;
+			x += directionX;
+			y += directionY;
+
+			if (x < 0.0f || y < 0.0f || x >= width - 1 || y >= height - 1)
+			{
+				break;
+			}
+
+			float newHeight = getHeightAndGradient(heights, width, x, y, gradientX, gradientY);
+			float deltaHeight = newHeight - currentHeight;
+
+			float capacity = -deltaHeight * speed * water * SEDIMENT_CAPACITY_FACTOR;
+
+			if (capacity < MIN_SEDIMENT_CAPACITY)
+			{
+				capacity = MIN_SEDIMENT_CAPACITY;
+			}
+
+			if (sediment > capacity || deltaHeight > 0.0f)
+			{
+				//uphill the droplet fills the pit it left behind, otherwise it drops part of the surplus
+
+				float deposit = deltaHeight > 0.0f ? std::min(deltaHeight, sediment) : (sediment - capacity) * DEPOSIT_SPEED;
+				sediment -= deposit;
+
+				float* node = heights + static_cast<size_t>(nodeY) * width + nodeX;
+				node[0] += deposit * (1.0f - offsetX) * (1.0f - offsetY);
+				node[1] += deposit * offsetX * (1.0f - offsetY);
+				node[width] += deposit * (1.0f - offsetX) * offsetY;
+				node[width + 1] += deposit * offsetX * offsetY;
+			}
+			else
+			{
+				//never erode more than the height difference, the droplet would dig a hole behind itself
+
+				float erosion = std::min((capacity - sediment) * ERODE_SPEED, -deltaHeight);
+
+				//near the border the part of the brush inside the map gets the whole amount
+
+				float weightScale = 1.0f;
+
+				if (nodeX < EROSION_RADIUS || nodeY < EROSION_RADIUS || nodeX >= width - EROSION_RADIUS || nodeY >= height - EROSION_RADIUS)
+				{
+					float weightSum = 0.0f;
+
+					for (const BrushSample& sample : brush)
+					{
+						int sampleX = nodeX + sample.m_offsetX;
+						int sampleY = nodeY + sample.m_offsetY;
+
+						if (sampleX >= 0 && sampleY >= 0 && sampleX < width && sampleY < height)
+						{
+							weightSum += sample.m_weight;
+						}
+					}
+
+					weightScale = 1.0f / weightSum;
+				}
+
+				for (const BrushSample& sample : brush)
+				{
+					int sampleX = nodeX + sample.m_offsetX;
+					int sampleY = nodeY + sample.m_offsetY;
+
+					if (sampleX < 0 || sampleY < 0 || sampleX >= width || sampleY >= height)
+					{
+						continue;
+					}
+
+					float& sampleHeight = heights[static_cast<size_t>(sampleY) * width + sampleX];
+					float removed = std::min(sampleHeight, erosion * sample.m_weight * weightScale);
+					sampleHeight -= removed;
+					sediment += removed;
+				}
+			}
+
+			speed = std::sqrt(std::max(speed * speed - deltaHeight * GRAVITY, 0.0f));
+			water *= 1.0f - EVAPORATE_SPEED;
+		}
+	}
+}
+
+float HydraulicErosion::getHeightAndGradient(const float* heights, int width, float x, float y, float& gradientX, float& gradientY)
+{
+	int nodeX = static_cast<int>(x);
+	int nodeY = static_cast<int>(y);
+	float offsetX = x - nodeX;
+	float offsetY = y - nodeY;
+
+	const float* node = heights + static_cast<size_t>(nodeY) * width + nodeX;
+	float heightNW = node[0];
+	float heightNE = node[1];
+	float heightSW = node[width];
+	float heightSE = node[width + 1];
+
+	gradientX = (heightNE - heightNW) * (1.0f - offsetY) + (heightSE - heightSW) * offsetY;
+	gradientY = (heightSW - heightNW) * (1.0f - offsetX) + (heightSE - heightNE) * offsetX;
+
+	return heightNW * (1.0f - offsetX) * (1.0f - offsetY)
+		+ heightNE * offsetX * (1.0f - offsetY)
+		+ heightSW * (1.0f - offsetX) * offsetY
+		+ heightSE * offsetX * offsetY;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Heightmap.h"
+
+/** \brief Particle based hydraulic erosion.
+*          Each droplet runs downhill, picks up sediment where it speeds up and deposits it where it slows down or evaporates.
+*          viz. Hans Theobald Beyer, Implementation of a method for hydraulic erosion, 2015
+*
+*          The map is split into tiles larger than twice the distance a droplet can reach, tiles are processed in four
+*          checkerboard phases so that the droplets of tiles processed at the same time never touch the same samples.
+*          The result only depends on the seed, not on the number of threads.
+*/
+class HydraulicErosion
+{
+
+public:
+
+	static constexpr int CELLS_PER_BATCH_DROPLET = 8; //!<a batch drops at most one droplet per this many samples, spreading the droplets evenly over time
+
+	/** \brief Erodes a copy of the heightmap. Heights are expected to be in the range 0-1.
+	*   \param dropletCount Number of simulated droplets.
+	*   \param seed Seed of the droplet start positions, the same seed always gives the same result.
+	*   \return The eroded heightmap, the input if it is too small or dropletCount isn't positive.
+	*/
+	static Heightmap erode(const Heightmap& heightmap, int dropletCount, uint32_t seed);
+
+private:
+
+	static constexpr int EROSION_RADIUS = 3; //!<radius of the area a droplet erodes from
+	static constexpr int MAX_LIFETIME = 30; //!<a droplet moves one sample per step, so this also limits its reach
+	static constexpr float INERTIA = 0.05f; //!<how much of the previous direction is kept, 0 follows the slope only
+	static constexpr float SEDIMENT_CAPACITY_FACTOR = 4.0f;
+	static constexpr float MIN_SEDIMENT_CAPACITY = 0.01f; //!<keeps droplets on flat ground carrying some sediment
+	static constexpr float ERODE_SPEED = 0.3f;
+	static constexpr float DEPOSIT_SPEED = 0.3f;
+	static constexpr float EVAPORATE_SPEED = 0.01f;
+	static constexpr float GRAVITY = 4.0f;
+	static constexpr float INITIAL_WATER = 1.0f;
+	static constexpr float INITIAL_SPEED = 1.0f;
+
+	//!<samples a droplet can read or write away from its start, the erosion brush and the bilinear neighbours included
+	static constexpr int DROPLET_REACH = MAX_LIFETIME + EROSION_RADIUS + 2;
+	static constexpr int TILE_SIZE = 2 * DROPLET_REACH + 1;
+
+	struct BrushSample
+	{
+		int m_offsetX;
+		int m_offsetY;
+		float m_weight; //!<weights of the whole brush sum up to 1
+	};
+
+	struct Tile
+	{
+		int m_beginX;
+		int m_beginY;
+		int m_endX;
+		int m_endY;
+		int m_index; //!<row-major index, feeds the random generator of the tile
+	};
+
+	static std::vector<BrushSample> createBrush();
+
+	/** \brief Simulates droplets starting inside the tile.
+	*   \param heights Samples of the whole map, modified in place.
+	*/
+	static void erodeTile(float* heights, int width, int height, const Tile& tile, int dropletCount,
+		uint32_t seed, int batch, const std::vector<BrushSample>& brush);
+
+	//!<bilinearly interpolated height at the position, gradient returned in gradientX and gradientY
+	static float getHeightAndGradient(const float* heights, int width, float x, float y, float& gradientX, float& gradientY);
+};
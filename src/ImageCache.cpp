@@ -0,0 +1,76 @@
+#include "ImageCache.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+ImageCache::ImageCache(int64_t capacity)
+	: m_capacity(capacity)
+{
+
+}
+
+QImage ImageCache::load(const QString& filename)
+{
+	QString key = getKey(filename);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto it = m_index.find(key);
+		if (it != m_index.end())
+		{
+			m_entries.splice(m_entries.begin(), m_entries, it.value());
+			return m_entries.front().m_image;
+		}
+	}
+
+	//decode without holding the lock, other jobs may read the cache meanwhile
+
+	QImage image(filename);
+	if (image.isNull())
+	{
+		return image;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_index.contains(key))
+	{
+		Entry entry;
+		entry.m_key = key;
+		entry.m_image = image;
+		entry.m_size = static_cast<int64_t>(image.bytesPerLine()) * image.height();
+
+		m_entries.push_front(entry);
+		m_index.insert(key, m_entries.begin());
+		m_size += entry.m_size;
+
+		//the newest entry stays even if it alone exceeds the capacity
+
+		while (m_size > m_capacity && m_entries.size() > 1)
+		{
+			const Entry& oldest = m_entries.back();
+			m_size -= oldest.m_size;
+			m_index.remove(oldest.m_key);
+			m_entries.pop_back();
+		}
+	}
+
+	return image;
+}
+
+void ImageCache::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_entries.clear();
+	m_index.clear();
+	m_size = 0;
+}
+
+QString ImageCache::getKey(const QString& filename)
+{
+	QFileInfo fileInfo(filename);
+
+	return fileInfo.absoluteFilePath() + "|" + QString::number(fileInfo.lastModified().toMSecsSinceEpoch());
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QString>
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+
+/** \brief Least recently used cache of decoded images, shared by the texture loading jobs.
+*          Entries are keyed by the file name and its modification time, so an edited file is decoded again.
+*/
+class ImageCache
+{
+
+public:
+
+	static constexpr int64_t DEFAULT_CAPACITY = 1024LL * 1024LL * 1024LL; //!<bytes of decoded texels
+
+	explicit ImageCache(int64_t capacity = DEFAULT_CAPACITY);
+
+	ImageCache(const ImageCache& other) = delete;
+
+	ImageCache(ImageCache&& other) = delete;
+
+	ImageCache& operator=(const ImageCache& other) = delete;
+
+	ImageCache& operator=(ImageCache&& other) = delete;
+
+	~ImageCache() = default;
+
+	/** \brief Returns the decoded image, reading the file only if it isn't cached yet. Can be called from any thread.
+	*   \return Null image if the file couldn't be read.
+	*/
+	QImage load(const QString& filename);
+
+	void clear();
+
+private:
+
+	struct Entry
+	{
+		QString m_key;
+		QImage m_image;
+		int64_t m_size = 0;
+	};
+
+	int64_t m_capacity = DEFAULT_CAPACITY;
+	int64_t m_size = 0;
+	std::list<Entry> m_entries; //!<most recently used first
+	QHash<QString, std::list<Entry>::iterator> m_index;
+	std::mutex m_mutex;
+
+	static QString getKey(const QString& filename);
+};
@@ -3,12 +3,23 @@
 #include "ui_mainwindow.h"
 #include "AssimpIO.h"
 #include "Application.h"
+#include "DEMImporter.h"
+#include "TextureCompressor.h"
+#include "TileExporter.h"
 #include "Utility.h"
 
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QScrollBar>
 #include <QColorDialog>
+#include <QInputDialog>
+#include <QSignalBlocker>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
 MainWindow::MainWindow(QWidget *parent) 
 	: QMainWindow(parent)
@@ -35,7 +46,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->myGLWidget->addAction(ui->actionOpenMesh);
     ui->myGLWidget->addAction(ui->actionSaveMesh);
 
-	const Renderer& renderer = ui->myGLWidget->getRenderer();
+	const RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	const Mesh& mesh = renderer.getMesh();
 	const DirectionalLight& light = renderer.getLight();
 
@@ -103,7 +114,14 @@ void MainWindow::lockHeightmap() const
     ui->generateFaultPushButton->setEnabled(false);
     ui->actionCreateMesh->setEnabled(false);
     ui->createMeshPushButton->setEnabled(false);
+	ui->actionSaveMeshTiles->setEnabled(false);
 	ui->heightExpSpinBox->setEnabled(false);
+	ui->actionHydraulicErosion->setEnabled(false);
+	ui->actionThermalErosion->setEnabled(false);
+	ui->actionFillDepressions->setEnabled(false);
+	ui->actionFlowAccumulation->setEnabled(false);
+	ui->actionUndo->setEnabled(false);
+	ui->actionRedo->setEnabled(false);
 }
 
 void MainWindow::unlockHeightmap() const
@@ -121,8 +139,16 @@ void MainWindow::unlockHeightmap() const
         ui->saveHeightmapPushButton->setEnabled(true);
         ui->actionCreateMesh->setEnabled(true);
         ui->createMeshPushButton->setEnabled(true);
+		ui->actionSaveMeshTiles->setEnabled(!Application::m_concurrencyHandler.isSavingMesh());
 		ui->heightExpSpinBox->setEnabled(true);
+		ui->actionHydraulicErosion->setEnabled(true);
+		ui->actionThermalErosion->setEnabled(true);
+		ui->actionFillDepressions->setEnabled(true);
+		ui->actionFlowAccumulation->setEnabled(true);
     }
+
+	ui->actionUndo->setEnabled(Application::m_heightmapHistory.canUndo());
+	ui->actionRedo->setEnabled(Application::m_heightmapHistory.canRedo());
 }
 
 void MainWindow::updateHeightmapGUI() const
@@ -131,6 +157,127 @@ void MainWindow::updateHeightmapGUI() const
 	m_heightmapScene->addPixmap(m_heightmapPixmap);
 }
 
+void MainWindow::updateDirtyRegions()
+{
+	Heightmap& heightmap = Application::m_heightmap;
+	const std::vector<HeightmapRect>& rects = heightmap.getDirtyRects();
+
+	if (rects.empty())
+	{
+		return;
+	}
+
+	//the scene shares the pixmap, painting on it while the scene holds it would copy all of it
+
+	m_heightmapScene->clear();
+
+	//the rectangles can only be painted with the range of the rest of the pixmap, a new range needs a new pixmap
+
+	float min = heightmap.getMin();
+	float max = heightmap.getMax();
+	bool rangeChanged = min != m_heightmapPixmapMin || max != m_heightmapPixmapMax;
+
+	if (rangeChanged)
+	{
+		m_heightmapPixmap = Utility::heightmapToQPixmap(heightmap);
+		m_heightmapPixmapMin = min;
+		m_heightmapPixmapMax = max;
+	}
+	else
+	{
+		Utility::updateQPixmap(heightmap, rects, m_heightmapPixmapMin, m_heightmapPixmapMax, m_heightmapPixmap);
+	}
+
+	updateHeightmapGUI();
+
+	//the mesh of a heightmap is scaled to its height range, patches keep the old scale, so the mesh is created anew like the pixmap
+
+	if (m_meshFromHeightmap && rangeChanged)
+	{
+		const ConcurrencyHandler& concurrencyHandler = Application::m_concurrencyHandler;
+
+		if (concurrencyHandler.isCreatingMesh() || concurrencyHandler.isLoadingMesh() || concurrencyHandler.isSavingMesh())
+		{
+			detachMeshFromHeightmap();
+		}
+		else
+		{
+			on_actionCreateMesh_triggered();
+		}
+	}
+	else if (m_meshFromHeightmap)
+	{
+		RendererProxy& renderer = ui->myGLWidget->getRenderer();
+		std::vector<MeshPatch> patches = renderer.getMesh().createPatches(heightmap, rects);
+
+		if (!patches.empty())
+		{
+			renderer.updateMesh(patches);
+			ui->myGLWidget->requestFrame();
+		}
+	}
+
+	heightmap.clearDirtyRects();
+}
+
+void MainWindow::stepHistory(bool forward)
+{
+	HeightmapHistory& history = Application::m_heightmapHistory;
+	Heightmap& heightmap = Application::m_heightmap;
+
+	if (forward ? !history.canRedo() : !history.canUndo())
+	{
+		return;
+	}
+
+	//the history doesn't contain the height exponent preview, the heightmap has to be in the current state first
+
+	if (Application::m_heightmapOrig != nullptr && ui->heightExpSpinBox->value() != 1.0)
+	{
+		heightmap = *Application::m_heightmapOrig;
+		heightmap.markDirty();
+	}
+
+	if (forward)
+	{
+		history.redo(heightmap);
+	}
+	else
+	{
+		history.undo(heightmap);
+	}
+
+	Application::m_heightmapOrig = nullptr;
+	m_meshRequestFromHeightmap = false;
+
+	{
+		const QSignalBlocker blocker(ui->heightExpSpinBox);
+		ui->heightExpSpinBox->setValue(1.0);
+	}
+
+	if (m_heightmapPixmap.width() == heightmap.getWidth() && m_heightmapPixmap.height() == heightmap.getHeight())
+	{
+		updateDirtyRegions();
+	}
+	else
+	{
+		m_heightmapPixmap = Utility::heightmapToQPixmap(heightmap);
+		m_heightmapPixmapMin = heightmap.getMin();
+		m_heightmapPixmapMax = heightmap.getMax();
+		heightmap.clearDirtyRects();
+		detachMeshFromHeightmap();
+		updateHeightmapGUI();
+	}
+
+	unlockHeightmap();
+}
+
+void MainWindow::detachMeshFromHeightmap()
+{
+	m_meshFromHeightmap = false;
+	m_meshRequestFromHeightmap = false;
+}
+
 void MainWindow::lockMesh() const
 {
     ui->geometryTab->setEnabled(false);
@@ -140,6 +287,7 @@ void MainWindow::lockMesh() const
     ui->actionOpenMesh->setEnabled(false);
     ui->saveMeshPushButton->setEnabled(false);
     ui->actionSaveMesh->setEnabled(false);
+    ui->actionSaveMeshTiles->setEnabled(false);
     ui->createMeshPushButton->setEnabled(false);
     ui->actionCreateMesh->setEnabled(false);
 }
@@ -164,12 +312,13 @@ void MainWindow::unlockMesh() const
 	{
 		ui->createMeshPushButton->setEnabled(true);
 		ui->actionCreateMesh->setEnabled(true);
+		ui->actionSaveMeshTiles->setEnabled(true);
 	}
 }
 
 void MainWindow::updateMeshGUI() const
 {
-    ui->myGLWidget->updateGL();
+    ui->myGLWidget->requestFrame();
 
 	const Mesh& mesh = ui->myGLWidget->getRenderer().getMesh();
 
@@ -186,10 +335,12 @@ void MainWindow::updateMaterialGUI() const
 	int index = ui->materialHeightBar->getSelectedSection();
 	int sectionCount = ui->materialHeightBar->getSectionCount();
 
-	ui->addMatPushButton->setEnabled(ui->materialHeightBar->isSectionDivisible(index));
-	ui->removeMatPushButton->setEnabled(sectionCount > 1);
-	ui->matUpPushButton->setEnabled(index < sectionCount - 1);
-	ui->matDownPushButton->setEnabled(index > 0);
+	ui->addMatPushButton->setEnabled(!m_loadingTexture && ui->materialHeightBar->isSectionDivisible(index));
+	ui->removeMatPushButton->setEnabled(!m_loadingTexture && sectionCount > 1);
+	ui->matUpPushButton->setEnabled(!m_loadingTexture && index < sectionCount - 1);
+	ui->matDownPushButton->setEnabled(!m_loadingTexture && index > 0);
+	ui->openTexturePushButton->setEnabled(!m_loadingTexture);
+	ui->actionOpenTexture->setEnabled(!m_loadingTexture);
 
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	const LayeredMaterial& layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
@@ -210,19 +361,45 @@ void MainWindow::updateMaterialGUI() const
 	ui->specularBlueSpinBox->setValue(material.m_specular.b * 255);
 	ui->specularPushButton->setStyleSheet("border: 1px solid black; background-color: " + Utility::vecToQColorName(material.m_specular));
 	ui->shininessSpinBox->setValue(material.m_shininess);
-	ui->textureCheckBox->setChecked(glIsTexture(layeredMaterial.getTextureID()) && layeredMaterial.hasTexture(materialIndex) && materialLayer.m_textureEnabled);
-	ui->textureCheckBox->setEnabled(glIsTexture(layeredMaterial.getTextureID()) && layeredMaterial.hasTexture(materialIndex));
+	ui->textureCheckBox->setChecked(layeredMaterial.getTextureID() != 0 && layeredMaterial.hasTexture(materialIndex) && materialLayer.m_textureEnabled);
+	ui->textureCheckBox->setEnabled(layeredMaterial.getTextureID() != 0 && layeredMaterial.hasTexture(materialIndex));
 	ui->textureScaleXSpinBox->setValue(material.m_textureScale.x);
 	ui->textureScaleYSpinBox->setValue(material.m_textureScale.y);
 	ui->textureScaleZSpinBox->setValue(material.m_textureScale.z);
-	ui->textureScaleXSpinBox->setEnabled(glIsTexture(layeredMaterial.getTextureID()) && layeredMaterial.hasTexture(materialIndex));
-	ui->textureScaleYSpinBox->setEnabled(glIsTexture(layeredMaterial.getTextureID()) && layeredMaterial.hasTexture(materialIndex));
-	ui->textureScaleZSpinBox->setEnabled(glIsTexture(layeredMaterial.getTextureID()) && layeredMaterial.hasTexture(materialIndex));
+	ui->textureScaleXSpinBox->setEnabled(layeredMaterial.getTextureID() != 0 && layeredMaterial.hasTexture(materialIndex));
+	ui->textureScaleYSpinBox->setEnabled(layeredMaterial.getTextureID() != 0 && layeredMaterial.hasTexture(materialIndex));
+	ui->textureScaleZSpinBox->setEnabled(layeredMaterial.getTextureID() != 0 && layeredMaterial.hasTexture(materialIndex));
+}
+
+void MainWindow::uploadMaterialTextures(LayeredMaterial& material, const QSize& textureSize) const
+{
+	GLenum textureFormat = TextureCompressor::getPreferredFormat();
+
+	std::vector<const TextureImage*> textureImages;
+	textureImages.reserve(Application::m_materialTextures.size());
+	for (Application::MaterialTexture& texture : Application::m_materialTextures)
+	{
+		if (texture.m_image.isNull())
+		{
+			texture.m_textureImage = TextureImage();
+			textureImages.push_back(nullptr);
+			continue;
+		}
+
+		TextureImage& textureImage = texture.m_textureImage;
+		if (textureImage.m_width != textureSize.width() || textureImage.m_height != textureSize.height() || textureImage.m_internalFormat != textureFormat)
+		{
+			textureImage = TextureCompressor::compress(Utility::toTextureFormat(texture.m_image, textureSize), textureFormat);
+		}
+		textureImages.push_back(&textureImage);
+	}
+
+	material.setTextures(textureImages);
 }
 
 void MainWindow::resetTransforms() const
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	Mesh mesh = renderer.getMesh();
 
 	ui->maxYSpinBox->setEnabled(true);
@@ -263,14 +440,28 @@ void MainWindow::on_actionOpenHeightmap_triggered()
                                                     "JPEG (*.jpg;*.jpeg);;"
                                                     "PNG (*.png);;"
                                                     "GIF (*.gif);;"
-                                                    "TIF (*.tif;*.tiff)",
+                                                    "TIF (*.tif;*.tiff);;"
+                                                    "Elevation data (*.asc;*.hgt)",
                                                     &selectedFilter);
 
-    if (!filename.isEmpty())
+    if (!filename.isEmpty() && DEMImporter::isSupported(filename.toStdString()))
+    {
+		//elevation grids can take a while to parse, the current heightmap stays until the import has succeeded
+		lockHeightmap();
+
+		ui->statusBar->showMessage("Importing heightmap...");
+
+		emit importHeightmap(filename.toStdString());
+    }
+    else if (!filename.isEmpty())
     {   
-		m_heightmapPixmap = QPixmap(filename);
-		Application::m_heightmapOrig = Utility::QPixmapToHeightmap(m_heightmapPixmap);
-		Application::m_heightmap = Application::m_heightmapOrig;
+		//read the file as an image, a pixmap may drop the precision of 16-bit heightmaps
+		QImage heightmapImage = QImage(filename);
+		m_heightmapPixmap = QPixmap::fromImage(heightmapImage);
+		m_heightmapPixmapMin = 0.0f;
+		m_heightmapPixmapMax = 1.0f;
+		Application::m_heightmapOrig = std::make_shared<const Heightmap>(Utility::QImageToHeightmap(heightmapImage));
+		Application::m_heightmap = *Application::m_heightmapOrig;
 
         if (m_heightmapPixmap.isNull())
         {
@@ -278,6 +469,8 @@ void MainWindow::on_actionOpenHeightmap_triggered()
         }
         else
         {
+			Application::m_heightmapHistory.push(Application::m_heightmap);
+			detachMeshFromHeightmap();
 			ui->heightExpSpinBox->setValue(1.0);
             unlockHeightmap();
 			updateHeightmapGUI();
@@ -398,22 +591,131 @@ void MainWindow::on_generateFaultPushButton_clicked()
 
 void MainWindow::on_heightExpSpinBox_valueChanged(double arg1)
 {
-	for (int row = 0; row < Application::m_heightmapOrig.getHeight(); ++row)
+	//undo and redo only patch the modified tiles of the heightmap, the copy the exponent is applied to is taken here
+
+	if (Application::m_heightmapOrig == nullptr)
 	{
-		for (int col = 0; col < Application::m_heightmapOrig.getWidth(); ++col)
-		{
-			Application::m_heightmap.at(row, col) = pow(Application::m_heightmapOrig.at(row, col), arg1);
-		}
+		Application::m_heightmapOrig = std::make_shared<const Heightmap>(Application::m_heightmap);
 	}
 
-	m_heightmapPixmap = Utility::heightmapToQPixmap(Application::m_heightmap);
+	if (Application::m_heightmapOrig->isEmpty())
+	{
+		return;
+	}
 
-	updateHeightmapGUI();
+	//the heightmap and the preview are replaced in onHeightExponentApplied, ticks arriving meanwhile only keep the newest value
+
+	emit applyHeightExponent(Application::m_heightmapOrig, static_cast<float>(arg1));
+}
+
+void MainWindow::on_actionHydraulicErosion_triggered()
+{
+	const Heightmap& heightmap = Application::m_heightmap;
+	int64_t sampleCount = static_cast<int64_t>(heightmap.getWidth()) * heightmap.getHeight();
+	int defaultDropletCount = static_cast<int>(std::min<int64_t>(std::max<int64_t>(sampleCount / SAMPLES_PER_DEFAULT_DROPLET, 1), std::numeric_limits<int>::max()));
+
+	bool accepted = false;
+	int dropletCount = QInputDialog::getInt(this, "Hydraulic erosion", "Droplets:", defaultDropletCount, 1, std::numeric_limits<int>::max(), 10000, &accepted);
+
+	if (!accepted)
+	{
+		return;
+	}
+
+	int seed = QInputDialog::getInt(this, "Hydraulic erosion", "Seed:", 0, 0, std::numeric_limits<int>::max(), 1, &accepted);
+
+	if (!accepted)
+	{
+		return;
+	}
+
+	lockHeightmap();
+
+	ui->statusBar->showMessage("Generating heightmap...");
+
+	emit erodeHeightmapHydraulic(heightmap, dropletCount, seed);
+}
+
+void MainWindow::on_actionThermalErosion_triggered()
+{
+	const Heightmap& heightmap = Application::m_heightmap;
+
+	bool accepted = false;
+	int iterations = QInputDialog::getInt(this, "Thermal erosion", "Iterations:", DEFAULT_THERMAL_ITERATIONS, 1, 100000, 10, &accepted);
+
+	if (!accepted)
+	{
+		return;
+	}
+
+	//heights are 0-1 while the map is many samples wide, so the stable difference is relative to the map size
+
+	double defaultTalus = DEFAULT_TALUS_SLOPE / std::max(heightmap.getWidth(), heightmap.getHeight());
+	double talus = QInputDialog::getDouble(this, "Thermal erosion", "Talus (height difference per sample):", defaultTalus, 0.0, 1.0, 6, &accepted);
+
+	if (!accepted)
+	{
+		return;
+	}
+
+	lockHeightmap();
+
+	ui->statusBar->showMessage("Generating heightmap...");
+
+	emit erodeHeightmapThermal(heightmap, iterations, static_cast<float>(talus));
+}
+
+void MainWindow::on_actionFillDepressions_triggered()
+{
+	lockHeightmap();
+
+	ui->statusBar->showMessage("Generating heightmap...");
+
+	emit fillDepressions(Application::m_heightmap);
+}
+
+void MainWindow::on_actionFlowAccumulation_triggered()
+{
+	lockHeightmap();
+
+	ui->statusBar->showMessage("Generating heightmap...");
+
+	emit computeFlowAccumulation(Application::m_heightmap);
+}
+
+void MainWindow::on_actionUndo_triggered()
+{
+	stepHistory(false);
+}
+
+void MainWindow::on_actionRedo_triggered()
+{
+	stepHistory(true);
+}
+
+void MainWindow::on_actionHistoryMemoryBudget_triggered()
+{
+	HeightmapHistory& history = Application::m_heightmapHistory;
+
+	bool accepted = false;
+	int budget = QInputDialog::getInt(this, "Undo history", "Memory budget in MB:",
+		static_cast<int>(history.getMemoryBudget() / BYTES_PER_MEGABYTE), 1, std::numeric_limits<int>::max() / BYTES_PER_MEGABYTE, 64, &accepted);
+
+	if (!accepted)
+	{
+		return;
+	}
+
+	history.setMemoryBudget(static_cast<size_t>(budget) * BYTES_PER_MEGABYTE);
+
+	ui->actionUndo->setEnabled(history.canUndo());
+	ui->actionRedo->setEnabled(history.canRedo());
 }
 
 void MainWindow::on_actionCreateMesh_triggered()
 {
 	emit createMesh(Application::m_heightmap);
+	m_meshRequestFromHeightmap = true;
     
     lockMesh();
 
@@ -447,6 +749,78 @@ void MainWindow::on_actionOpenMesh_triggered()
 }
 
 void MainWindow::on_actionSaveMesh_triggered()
+{
+	QString filename;
+	AssimpIO::ExportFormat exportFormat;
+
+	if (getExportTarget("Save mesh", filename, exportFormat))
+	{
+		lockMesh();
+
+		ui->statusBar->showMessage("Saving mesh...");
+
+		const Mesh& mesh = ui->myGLWidget->getRenderer().getMesh();
+
+		emit saveMesh(mesh, filename.toStdString(), exportFormat.id);		
+	}
+}
+
+void MainWindow::on_actionSaveMeshTiles_triggered()
+{
+	const Heightmap& heightmap = Application::m_heightmap;
+
+	bool accepted = false;
+	int columns = QInputDialog::getInt(this, "Save mesh tiles", "Columns:", DEFAULT_TILE_COUNT, 1, TileExporter::getMaxTileCount(heightmap.getWidth()), 1, &accepted);
+
+	if (!accepted)
+	{
+		return;
+	}
+
+	int rows = QInputDialog::getInt(this, "Save mesh tiles", "Rows:", columns, 1, TileExporter::getMaxTileCount(heightmap.getHeight()), 1, &accepted);
+
+	if (!accepted)
+	{
+		return;
+	}
+
+	QString filename;
+	AssimpIO::ExportFormat exportFormat;
+
+	if (!getExportTarget("Save mesh tiles", filename, exportFormat))
+	{
+		return;
+	}
+
+	//the tiles and the manifest are named after the chosen file without its extension
+
+	QFileInfo fileInfo(filename);
+	QString baseFilename = fileInfo.dir().filePath(fileInfo.completeBaseName());
+
+	//the tiles get the vertical scale of the displayed mesh if it shows this heightmap, like the whole mesh when it is saved
+
+	float heightOffset = 0.0f;
+	float heightScale = 1.0f;
+
+	if (m_meshFromHeightmap)
+	{
+		MeshGridMapping gridMapping = ui->myGLWidget->getRenderer().getMesh().getGridMapping();
+		heightOffset = gridMapping.m_heightOffset;
+		heightScale = gridMapping.m_heightScale;
+	}
+	else
+	{
+		Mesh::getDefaultHeightMapping(heightmap, heightOffset, heightScale);
+	}
+
+	lockMesh();
+
+	ui->statusBar->showMessage("Saving mesh tiles...");
+
+	emit saveMeshTiles(heightmap, heightOffset, heightScale, columns, rows, baseFilename.toStdString(), exportFormat.id, exportFormat.extension);
+}
+
+bool MainWindow::getExportTarget(const QString& title, QString& filename, AssimpIO::ExportFormat& exportFormat)
 {
 	std::vector<AssimpIO::ExportFormat> formats = AssimpIO::getExportFormats();
 	QString filters = "All files (*.*);;";
@@ -458,49 +832,44 @@ void MainWindow::on_actionSaveMesh_triggered()
 			+ ");;";
 	}
 
-	QFileDialog dialog(this, "Save mesh", QDir::currentPath(), filters);
+	QFileDialog dialog(this, title, QDir::currentPath(), filters);
 	dialog.setAcceptMode(QFileDialog::AcceptSave);
-	if (dialog.exec() == QDialog::Accepted)
+	if (dialog.exec() != QDialog::Accepted)
 	{
-		QString selectedFilter = dialog.selectedNameFilter();
-		QString filename = dialog.selectedFiles()[0];
-		QStringList filterList = filters.split(";;");
-		int filterIndex;
-		for (filterIndex = 0; filterIndex < filterList.count(); filterIndex++)
+		return false;
+	}
+
+	QString selectedFilter = dialog.selectedNameFilter();
+	filename = dialog.selectedFiles()[0];
+	QStringList filterList = filters.split(";;");
+	int filterIndex;
+	for (filterIndex = 0; filterIndex < filterList.count(); filterIndex++)
+	{
+		if (filterList[filterIndex] == selectedFilter)
 		{
-			if (filterList[filterIndex] == selectedFilter)
-			{
-				break;
-			}
+			break;
 		}
+	}
 
-		AssimpIO::ExportFormat exportFormat;
-		if (filterIndex == 0)
+	if (filterIndex == 0)
+	{
+		int start = filename.lastIndexOf('.') + 1;
+		QStringRef extension(&filename, start, filename.size() - start);
+		for (const AssimpIO::ExportFormat& format : formats)
 		{
-			int start = filename.lastIndexOf('.') + 1;
-			QStringRef extension(&filename, start, filename.size() - start);
-			for (const AssimpIO::ExportFormat& format : formats)
+			if (QString::fromStdString(format.extension) == extension)
 			{
-				if (QString::fromStdString(format.extension) == extension)
-				{
-					exportFormat = format;
-					break;
-				}
+				exportFormat = format;
+				break;
 			}
 		}
-		else
-		{
-			exportFormat = formats[filterIndex - 1];
-		}
-
-		lockMesh();
-
-		ui->statusBar->showMessage("Saving mesh...");
-
-		const Mesh& mesh = ui->myGLWidget->getRenderer().getMesh();
-
-		emit saveMesh(mesh, filename.toStdString(), exportFormat.id);		
 	}
+	else
+	{
+		exportFormat = formats[filterIndex - 1];
+	}
+
+	return true;
 }
 
 void MainWindow::on_ambientPushButton_clicked()
@@ -519,7 +888,7 @@ void MainWindow::on_ambientPushButton_clicked()
 		materialLayer.m_material.m_ambient = Utility::QColorToVec(newColor);
 		layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 		ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
-		ui->myGLWidget->updateGL();
+		ui->myGLWidget->requestFrame();
 	}
 }
 
@@ -539,7 +908,7 @@ void MainWindow::on_diffusePushButton_clicked()
 		materialLayer.m_material.m_diffuse = Utility::QColorToVec(newColor);
 		layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 		ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
-		ui->myGLWidget->updateGL();
+		ui->myGLWidget->requestFrame();
 	}
 }
 
@@ -559,15 +928,18 @@ void MainWindow::on_specularPushButton_clicked()
 		materialLayer.m_material.m_specular = Utility::QColorToVec(newColor);
 		layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 		ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
-		ui->myGLWidget->updateGL();
+		ui->myGLWidget->requestFrame();
 	}
 }
 
 void MainWindow::onHeightmapGenerated(const Heightmap& heightmap)
 {
-	Application::m_heightmapOrig = heightmap;
-	Application::m_heightmap = Application::m_heightmapOrig;
+	Application::m_heightmapOrig = std::make_shared<const Heightmap>(heightmap);
+	Application::m_heightmap = heightmap;
+	detachMeshFromHeightmap();
 	m_heightmapPixmap = Utility::heightmapToQPixmap(Application::m_heightmap);
+	m_heightmapPixmapMin = Application::m_heightmap.getMin();
+	m_heightmapPixmapMax = Application::m_heightmap.getMax();
 
     if (!Application::m_heightmap.isEmpty())
     {
@@ -576,6 +948,7 @@ void MainWindow::onHeightmapGenerated(const Heightmap& heightmap)
         vScrollBar->setValue(0);
         hScrollBar->setValue(0);
 		ui->heightExpSpinBox->setValue(1.0);
+		Application::m_heightmapHistory.push(Application::m_heightmap);
     }
     else
     {
@@ -601,6 +974,32 @@ void MainWindow::onHeightmapGenerated(const Heightmap& heightmap)
     }
 }
 
+void MainWindow::onHeightmapImported(const Heightmap& heightmap)
+{
+	if (!heightmap.isEmpty())
+	{
+		onHeightmapGenerated(heightmap);
+		return;
+	}
+
+	QMessageBox::information(this, "Terrain Generator", "Error while reading the elevation data\n");
+
+	unlockHeightmap();
+
+	if (Application::m_concurrencyHandler.isLoadingMesh())
+	{
+		ui->statusBar->showMessage("Loading mesh...");
+	}
+	else if (Application::m_concurrencyHandler.isSavingMesh())
+	{
+		ui->statusBar->showMessage("Saving mesh...");
+	}
+	else
+	{
+		ui->statusBar->showMessage("Ready!");
+	}
+}
+
 void MainWindow::onMeshLoaded(const Mesh& mesh)
 {
     if (mesh.empty())
@@ -612,6 +1011,7 @@ void MainWindow::onMeshLoaded(const Mesh& mesh)
     else
     {
 		ui->myGLWidget->getRenderer().setMesh(mesh);
+		m_meshFromHeightmap = false;
 
         resetTransforms();
     }
@@ -622,6 +1022,10 @@ void MainWindow::onMeshLoaded(const Mesh& mesh)
     {
         ui->statusBar->showMessage("Generating heightmap...");
     }
+    else if (Application::m_concurrencyHandler.isImportingHeightmap())
+    {
+        ui->statusBar->showMessage("Importing heightmap...");
+    }
     else
     {
         ui->statusBar->showMessage("Ready!");
@@ -639,6 +1043,7 @@ void MainWindow::onMeshCreated(const Mesh& mesh)
     else
     {
 		ui->myGLWidget->getRenderer().setMesh(mesh);
+		m_meshFromHeightmap = m_meshRequestFromHeightmap;
 
         resetTransforms();
     }
@@ -649,6 +1054,10 @@ void MainWindow::onMeshCreated(const Mesh& mesh)
     {
         ui->statusBar->showMessage("Generating heightmap...");
     }
+    else if (Application::m_concurrencyHandler.isImportingHeightmap())
+    {
+        ui->statusBar->showMessage("Importing heightmap...");
+    }
     else
     {
         ui->statusBar->showMessage("Ready!");
@@ -669,15 +1078,103 @@ void MainWindow::onMeshSaved(bool success)
     {
         ui->statusBar->showMessage("Generating heightmap...");
     }
+    else if (Application::m_concurrencyHandler.isImportingHeightmap())
+    {
+        ui->statusBar->showMessage("Importing heightmap...");
+    }
     else
     {
         ui->statusBar->showMessage("Ready!");
     }
 }
 
+void MainWindow::onHeightExponentApplied(const RemappedHeightmap& result)
+{
+	//the heightmap has been replaced since the request was made
+
+	if (result.m_source != Application::m_heightmapOrig)
+	{
+		return;
+	}
+
+	Application::m_heightmap = result.m_heightmap;
+	detachMeshFromHeightmap();
+	m_heightmapPixmap = QPixmap::fromImage(result.m_image);
+	m_heightmapPixmapMin = result.m_min;
+	m_heightmapPixmapMax = result.m_max;
+
+	updateHeightmapGUI();
+}
+
+void MainWindow::onTextureLoaded(const LoadedTexture& texture)
+{
+	m_loadingTexture = false;
+
+	if (texture.m_image.isNull())
+	{
+		QMessageBox::information(this,
+			"Terrain Generator",
+			"Error while reading from file\n" + texture.m_filename);
+	}
+	else
+	{
+		int materialIndex = texture.m_layerIndex;
+		Application::MaterialTexture& materialTexture = Application::m_materialTextures[materialIndex];
+		materialTexture.m_image = texture.m_image;
+		materialTexture.m_filename = texture.m_filename;
+		materialTexture.m_averageColor = texture.m_averageColor;
+		ui->materialHeightBar->setSectionColor(materialIndex, texture.m_averageColor);
+
+		LayeredMaterial material = ui->myGLWidget->getRenderer().getMaterial();
+
+		//the texture is uploaded through the widget's context, which shares its objects with the render thread
+		ui->myGLWidget->makeCurrent();
+
+		if (texture.m_reallocate)
+		{
+			for (int i = 0; i < texture.m_textureImages.size(); ++i)
+			{
+				Application::m_materialTextures[i].m_textureImage = texture.m_textureImages[i];
+			}
+
+			uploadMaterialTextures(material, texture.m_textureSize);
+		}
+		else
+		{
+			materialTexture.m_textureImage = texture.m_textureImages.front();
+
+			if (!material.setTextureLayer(materialIndex, &materialTexture.m_textureImage))
+			{
+				uploadMaterialTextures(material, texture.m_textureSize);
+			}
+		}
+
+		ui->myGLWidget->getRenderer().setMaterial(material);
+
+		ui->myGLWidget->doneCurrent();
+
+		ui->myGLWidget->requestFrame();
+	}
+
+	updateMaterialGUI();
+
+	if (Application::m_concurrencyHandler.isGeneratingHeightmap())
+	{
+		ui->statusBar->showMessage("Generating heightmap...");
+	}
+	else if (Application::m_concurrencyHandler.isImportingHeightmap())
+	{
+		ui->statusBar->showMessage("Importing heightmap...");
+	}
+	else
+	{
+		ui->statusBar->showMessage("Ready!");
+	}
+}
+
 void MainWindow::on_maxYSpinBox_valueChanged(double arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	Mesh mesh = renderer.getMesh();
 
 	mesh.setHeight(arg1);
@@ -689,7 +1186,7 @@ void MainWindow::on_maxYSpinBox_valueChanged(double arg1)
 
 void MainWindow::on_textureCheckBox_clicked(bool checked)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -700,7 +1197,7 @@ void MainWindow::on_textureCheckBox_clicked(bool checked)
 	QColor color = Utility::vecToQColor(materialLayer.m_material.m_diffuse);
 	if (checked)
 	{
-		ui->materialHeightBar->setSectionColor(materialIndex, Utility::getAverageColor(Application::m_materialTextures[materialIndex].m_image));
+		ui->materialHeightBar->setSectionColor(materialIndex, Application::m_materialTextures[materialIndex].m_averageColor);
 	}
 	else
 	{
@@ -791,66 +1288,24 @@ void MainWindow::on_actionOpenTexture_triggered()
 
     if (!filename.isEmpty())
     {
-		QImage newTextureImage = QImage(filename);
-
-        if (newTextureImage.isNull())
-        {
-            QMessageBox::information(this,
-                                     "Terrain Generator",
-                                     "Error while reading from file\n" + filename);
-
-			ui->textureLineEdit->setText("");
-
-            return;
-        }
+		//decoding, scaling and encoding run in the background, the texture is uploaded when they are done
 
-		int materialIndex = ui->materialHeightBar->getSelectedSection();
-		Application::m_materialTextures[materialIndex].m_image = newTextureImage;
-		Application::m_materialTextures[materialIndex].m_filename = filename;
-		ui->materialHeightBar->setSectionColor(materialIndex, Utility::getAverageColor(newTextureImage));
-		QSize largestSize = QSize(0, 0);
+		QVector<QImage> layerImages;
+		layerImages.reserve(Application::m_materialTextures.size());
 		for (const Application::MaterialTexture& texture : Application::m_materialTextures)
 		{
-			const QImage& textureImage = texture.m_image;
-			QSize size = textureImage.size();
-			if (size.width() * size.height() > largestSize.width() * largestSize.height())
-			{
-				largestSize = size;
-			}
-		}
-		std::vector<QImage> images;
-		images.reserve(Application::m_materialTextures.size());
-		std::vector<const void*> pixels;
-		pixels.reserve(Application::m_materialTextures.size());
-		for (Application::MaterialTexture& texture : Application::m_materialTextures)
-		{
-			QImage& textureImage = texture.m_image;
-			if (!textureImage.isNull())
-			{
-				textureImage = textureImage.scaled(largestSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-			}
-			images.push_back(QGLWidget::convertToGLFormat(textureImage));
-			pixels.push_back(images.back().bits());
+			layerImages.push_back(texture.m_image);
 		}
 
-		LayeredMaterial material = ui->myGLWidget->getRenderer().getMaterial();
+		const LayeredMaterial& material = ui->myGLWidget->getRenderer().getMaterial();
+		QSize textureSize = QSize(material.getTextureWidth(), material.getTextureHeight());
 
-		material.init(
-			material.getMaterialLayers(),
-			largestSize.width(),
-			largestSize.height(),
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			pixels);
+		m_loadingTexture = true;
+		updateMaterialGUI();
 
-		ui->myGLWidget->getRenderer().setMaterial(material);
+		ui->statusBar->showMessage("Loading texture...");
 
-		ui->textureLineEdit->setText(filename);
-		ui->textureLineEdit->setCursorPosition(0);
-		
-		updateMaterialGUI();
-		
-		ui->myGLWidget->updateGL();
+		emit loadTexture(filename, ui->materialHeightBar->getSelectedSection(), layerImages, textureSize, TextureCompressor::getPreferredFormat());
     }
 }
 
@@ -860,12 +1315,12 @@ void MainWindow::on_lightXSpinBox_valueChanged(double arg1)
 	double y = ui->lightYSpinBox->value();
 	double z = ui->lightZSpinBox->value();
 
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	DirectionalLight light = renderer.getLight();
 
 	light.m_direction = glm::normalize(glm::vec4(x, y, z, 0.0f));
 	renderer.setLight(light);
-    ui->myGLWidget->updateGL();
+    ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_lightYSpinBox_valueChanged(double arg1)
@@ -874,12 +1329,12 @@ void MainWindow::on_lightYSpinBox_valueChanged(double arg1)
 	double y = ui->lightYSpinBox->value();
 	double z = ui->lightZSpinBox->value();
 
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	DirectionalLight light = renderer.getLight();
 
 	light.m_direction = glm::normalize(glm::vec4(x, y, z, 0.0f));
 	renderer.setLight(light);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_lightZSpinBox_valueChanged(double arg1)
@@ -888,17 +1343,17 @@ void MainWindow::on_lightZSpinBox_valueChanged(double arg1)
 	double y = ui->lightYSpinBox->value();
 	double z = ui->lightZSpinBox->value();
 
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	DirectionalLight light = renderer.getLight();
 
 	light.m_direction = glm::normalize(glm::vec4(x, y, z, 0.0f));
 	renderer.setLight(light);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_lightColorPushButton_clicked()
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	DirectionalLight light = renderer.getLight();
 
 	QColor color = QColorDialog::getColor(Utility::vecToQColor(light.m_color), this, QString());
@@ -907,7 +1362,7 @@ void MainWindow::on_lightColorPushButton_clicked()
         ui->lightColorPushButton->setStyleSheet("border: 1px solid black; background-color: " + color.name());
 		light.m_color = Utility::QColorToVec(color);
 		renderer.setLight(light);
-		ui->myGLWidget->updateGL();
+		ui->myGLWidget->requestFrame();
     }
 }
 
@@ -933,42 +1388,16 @@ void MainWindow::on_addMatPushButton_clicked()
 		}
 
 		Application::m_materialTextures.insert(Application::m_materialTextures.begin() + index, Application::MaterialTexture());
-		QSize textureSize = QSize(0, 0);
-		std::vector<QImage> images;
-		images.reserve(Application::m_materialTextures.size());
-		std::vector<const void*> pixels;
-		pixels.reserve(Application::m_materialTextures.size());
-		for (Application::MaterialTexture& texture : Application::m_materialTextures)
-		{
-			QImage& textureImage = texture.m_image;
-			images.push_back(QGLWidget::convertToGLFormat(textureImage));
-			pixels.push_back(images.back().bits());
-			if (textureImage.width() != 0 && textureImage.height() != 0)
-			{
-				textureSize = textureImage.size();
-			}
-		}
 
-		if (textureSize.width() != 0 && textureSize.height() != 0)
-		{
-			layeredMaterial.init(
-				materialLayers,
-				textureSize.width(),
-				textureSize.height(),
-				GL_RGBA,
-				GL_UNSIGNED_BYTE,
-				pixels);
-		}
-		else
-		{
-			layeredMaterial.init(materialLayers);
-		}
+		//the new layer has no texture yet, so the array texture stays as it is
+		layeredMaterial.insertMaterialLayer(index, materialLayers[index]);
+		layeredMaterial.setMaterialLayers(materialLayers);
 
 		ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
 
 		updateMaterialGUI();
 
-		ui->myGLWidget->updateGL();
+		ui->myGLWidget->requestFrame();
 	}
 }
 
@@ -989,43 +1418,14 @@ void MainWindow::on_removeMatPushButton_clicked()
 
 	Application::m_materialTextures.erase(Application::m_materialTextures.begin() + index);
 
-	QSize textureSize = QSize(0, 0);
-	std::vector<QImage> images;
-	images.reserve(Application::m_materialTextures.size());
-	std::vector<const void*> pixels;
-	pixels.reserve(Application::m_materialTextures.size());
-	for (Application::MaterialTexture& texture : Application::m_materialTextures)
-	{
-		QImage& textureImage = texture.m_image;
-		images.push_back(QGLWidget::convertToGLFormat(textureImage));
-		pixels.push_back(images.back().bits());
-		if (textureImage.width() != 0 && textureImage.height() != 0)
-		{
-			textureSize = textureImage.size();
-		}
-	}
-
-	if (textureSize.width() != 0 && textureSize.height() != 0)
-	{
-		layeredMaterial.init(
-			materialLayers,
-			textureSize.width(),
-			textureSize.height(),
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			pixels);
-	}
-	else
-	{
-		layeredMaterial.init(materialLayers);
-	}
-
+	layeredMaterial.removeMaterialLayer(index);
+	layeredMaterial.setMaterialLayers(materialLayers);
 
 	ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
 
 	updateMaterialGUI();
 
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_matUpPushButton_clicked()
@@ -1055,42 +1455,15 @@ void MainWindow::on_matUpPushButton_clicked()
 
 	std::swap(lowerLayer, upperLayer);
 
-	QSize textureSize = QSize(0, 0);
-	std::vector<QImage> images;
-	images.reserve(Application::m_materialTextures.size());
-	std::vector<const void*> pixels;
-	pixels.reserve(Application::m_materialTextures.size());
-	for (Application::MaterialTexture& texture : Application::m_materialTextures)
-	{
-		QImage& textureImage = texture.m_image;
-		images.push_back(QGLWidget::convertToGLFormat(textureImage));
-		pixels.push_back(images.back().bits());
-		if (textureImage.width() != 0 && textureImage.height() != 0)
-		{
-			textureSize = textureImage.size();
-		}
-	}
-
-	if (textureSize.width() != 0 && textureSize.height() != 0)
-	{
-		layeredMaterial.init(
-			materialLayers,
-			textureSize.width(),
-			textureSize.height(),
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			pixels);
-	}
-	else
-	{
-		layeredMaterial.init(materialLayers);
-	}
+	//only the layer to slot mapping is permuted, the texels stay where they are
+	layeredMaterial.swapTextureLayers(index, index + 1);
+	layeredMaterial.setMaterialLayers(materialLayers);
 
 	ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
 
 	updateMaterialGUI();
 
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_matDownPushButton_clicked()
@@ -1120,42 +1493,15 @@ void MainWindow::on_matDownPushButton_clicked()
 
 	std::swap(lowerLayer, upperLayer);
 
-	QSize textureSize = QSize(0, 0);
-	std::vector<QImage> images;
-	images.reserve(Application::m_materialTextures.size());
-	std::vector<const void*> pixels;
-	pixels.reserve(Application::m_materialTextures.size());
-	for (Application::MaterialTexture& texture : Application::m_materialTextures)
-	{
-		QImage& textureImage = texture.m_image;
-		images.push_back(QGLWidget::convertToGLFormat(textureImage));
-		pixels.push_back(images.back().bits());
-		if (textureImage.width() != 0 && textureImage.height() != 0)
-		{
-			textureSize = textureImage.size();
-		}
-	}
-
-	if (textureSize.width() != 0 && textureSize.height() != 0)
-	{
-		layeredMaterial.init(
-			materialLayers,
-			textureSize.width(),
-			textureSize.height(),
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			pixels);
-	}
-	else
-	{
-		layeredMaterial.init(materialLayers);
-	}
+	//only the layer to slot mapping is permuted, the texels stay where they are
+	layeredMaterial.swapTextureLayers(index - 1, index);
+	layeredMaterial.setMaterialLayers(materialLayers);
 
 	ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
 
 	updateMaterialGUI();
 
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_materialHeightBar_selectedSectionChanged(int index)
@@ -1172,47 +1518,18 @@ void MainWindow::on_materialHeightBar_sectionHeightsChanged()
 		it->m_maxY = ui->materialHeightBar->getSectionUpperBound(it - materialLayers.begin());
 	}
 
-	QSize textureSize = QSize(0, 0);
-	std::vector<QImage> images;
-	images.reserve(Application::m_materialTextures.size());
-	std::vector<const void*> pixels;
-	pixels.reserve(Application::m_materialTextures.size());
-	for (Application::MaterialTexture& texture : Application::m_materialTextures)
-	{
-		QImage& textureImage = texture.m_image;
-		images.push_back(QGLWidget::convertToGLFormat(textureImage));
-		pixels.push_back(images.back().bits());
-		if (textureImage.width() != 0 && textureImage.height() != 0)
-		{
-			textureSize = textureImage.size();
-		}
-	}
-
-	if (textureSize.width() != 0 && textureSize.height() != 0)
-	{
-		layeredMaterial.init(
-			materialLayers,
-			textureSize.width(),
-			textureSize.height(),
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			pixels);
-	}
-	else
-	{
-		layeredMaterial.init(materialLayers);
-	}
+	layeredMaterial.setMaterialLayers(materialLayers);
 
 	ui->myGLWidget->getRenderer().setMaterial(layeredMaterial);
 
 	updateMaterialGUI();
 
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_ambientRedSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1221,12 +1538,12 @@ void MainWindow::on_ambientRedSpinBox_valueChanged(int arg1)
 	ui->ambientPushButton->setStyleSheet("border: 1px solid black; background-color: " + color.name());
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_ambientGreenSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1235,12 +1552,12 @@ void MainWindow::on_ambientGreenSpinBox_valueChanged(int arg1)
 	ui->ambientPushButton->setStyleSheet("border: 1px solid black; background-color: " + color.name());
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_ambientBlueSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1249,12 +1566,12 @@ void MainWindow::on_ambientBlueSpinBox_valueChanged(int arg1)
 	ui->ambientPushButton->setStyleSheet("border: 1px solid black; background-color: " + color.name());
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_diffuseRedSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1267,12 +1584,12 @@ void MainWindow::on_diffuseRedSpinBox_valueChanged(int arg1)
 	}
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_diffuseGreenSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1285,12 +1602,12 @@ void MainWindow::on_diffuseGreenSpinBox_valueChanged(int arg1)
 	}
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_diffuseBlueSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1303,12 +1620,12 @@ void MainWindow::on_diffuseBlueSpinBox_valueChanged(int arg1)
 	}
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_specularRedSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1317,12 +1634,12 @@ void MainWindow::on_specularRedSpinBox_valueChanged(int arg1)
 	ui->specularPushButton->setStyleSheet("border: 1px solid black; background-color: " + color.name());
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_specularGreenSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1331,12 +1648,12 @@ void MainWindow::on_specularGreenSpinBox_valueChanged(int arg1)
 	ui->specularPushButton->setStyleSheet("border: 1px solid black; background-color: " + color.name());
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_specularBlueSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
@@ -1345,40 +1662,57 @@ void MainWindow::on_specularBlueSpinBox_valueChanged(int arg1)
 	ui->specularPushButton->setStyleSheet("border: 1px solid black; background-color: " + color.name());
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_shininessSpinBox_valueChanged(int arg1)
 {
-	Renderer& renderer = ui->myGLWidget->getRenderer();
+	RendererProxy& renderer = ui->myGLWidget->getRenderer();
 	int materialIndex = ui->materialHeightBar->getSelectedSection();
 	LayeredMaterial layeredMaterial = ui->myGLWidget->getRenderer().getMaterial();
 	MaterialLayer materialLayer = layeredMaterial.getMaterialLayer(materialIndex);
 	materialLayer.m_material.m_shininess = arg1;
 	layeredMaterial.setMaterialLayer(materialIndex, materialLayer);
 	renderer.setMaterial(layeredMaterial);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_shadowsCheckBox_toggled(bool checked)
 {
     ui->myGLWidget->getRenderer().enableShadows(checked);
-    ui->myGLWidget->updateGL();
+    ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_poissonSpreadSpinBox_valueChanged(int arg1)
 {
     ui->myGLWidget->getRenderer().setPoissonSpread(arg1);
-    ui->myGLWidget->updateGL();
+    ui->myGLWidget->requestFrame();
 }
 
 void MainWindow::on_shadowBiasSpinBox_valueChanged(double arg1)
 {
 	ui->myGLWidget->getRenderer().setShadowBias(arg1);
-	ui->myGLWidget->updateGL();
+	ui->myGLWidget->requestFrame();
 }
 
-void MainWindow::on_myGLWidget_renderingFinished(float ms)
+void MainWindow::on_myGLWidget_renderingFinished(const FrameTimings& timings)
 {
-	ui->renderTimeLabel->setText(QString::number(ms) + " ms");
+	float gpuTotal = timings.m_upload.m_gpu + timings.m_depthMap.m_gpu + timings.m_terrain.m_gpu;
+
+	const FrameStatistics& statistics = ui->myGLWidget->getFrameScheduler().getStatistics();
+
+	ui->renderTimeLabel->setText(
+		"CPU " + QString::number(timings.m_cpuTotal, 'f', 2) + " ms, " +
+		"GPU " + QString::number(gpuTotal, 'f', 2) + " ms, " +
+		"frame " + QString::number(statistics.m_averageFrameTime, 'f', 2) + " ms");
+
+	ui->renderTimeLabel->setToolTip(
+		"Upload: CPU " + QString::number(timings.m_upload.m_cpu, 'f', 2) + " ms, GPU " + QString::number(timings.m_upload.m_gpu, 'f', 2) + " ms\n" +
+		"Shadow map: CPU " + QString::number(timings.m_depthMap.m_cpu, 'f', 2) + " ms, GPU " + QString::number(timings.m_depthMap.m_gpu, 'f', 2) + " ms\n" +
+		"Terrain: CPU " + QString::number(timings.m_terrain.m_cpu, 'f', 2) + " ms, GPU " + QString::number(timings.m_terrain.m_gpu, 'f', 2) + " ms\n" +
+		"Request to screen over the last " + QString::number(statistics.m_frameCount) + " frames: " +
+		"average " + QString::number(statistics.m_averageFrameTime, 'f', 2) + " ms, " +
+		"min " + QString::number(statistics.m_minFrameTime, 'f', 2) + " ms, " +
+		"max " + QString::number(statistics.m_maxFrameTime, 'f', 2) + " ms\n" +
+		"Requests merged into the last frame: " + QString::number(statistics.m_coalescedRequests));
 }
@@ -6,12 +6,15 @@
 #include <QImage>
 #include <QPixmap>
 
+#include <memory>
 #include <string>
 
+#include "ConcurrencyHandler.h"
 #include "MyGLWidget.h"
 #include "Heightmap.h"
 #include "HeightmapGenerator.h"
 #include "Mesh.h"
+#include "TextureLoader.h"
 
 namespace Ui {
 class MainWindow;
@@ -58,12 +61,28 @@ private slots:
 
 	void on_heightExpSpinBox_valueChanged(double arg1);
 
+	void on_actionHydraulicErosion_triggered();
+
+	void on_actionThermalErosion_triggered();
+
+	void on_actionFillDepressions_triggered();
+
+	void on_actionFlowAccumulation_triggered();
+
+	void on_actionUndo_triggered();
+
+	void on_actionRedo_triggered();
+
+	void on_actionHistoryMemoryBudget_triggered();
+
     void on_actionCreateMesh_triggered();
 
     void on_actionOpenMesh_triggered();
 
     void on_actionSaveMesh_triggered();
 
+	void on_actionSaveMeshTiles_triggered();
+
     void on_ambientPushButton_clicked();
 
 	void on_diffusePushButton_clicked();
@@ -134,18 +153,25 @@ private slots:
 
 	void on_shadowBiasSpinBox_valueChanged(double arg1);
 
-	void on_myGLWidget_renderingFinished(float ms);
+	void on_myGLWidget_renderingFinished(const FrameTimings& timings);
 
 public slots:
 
     void onHeightmapGenerated(const Heightmap& heightmap);
 
+	//!<replaces the heightmap if the import succeeded, otherwise the current one is kept
+	void onHeightmapImported(const Heightmap& heightmap);
+
     void onMeshLoaded(const Mesh& mesh);
 
     void onMeshCreated(const Mesh& mesh);
 
     void onMeshSaved(bool success);
 
+	void onHeightExponentApplied(const RemappedHeightmap& result);
+
+	void onTextureLoaded(const LoadedTexture& texture);
+
 
 signals:
 
@@ -157,24 +183,51 @@ signals:
 
 	void generateHeightmapFault(int width, int height, int iterations, int startAmplitude, int endAmplitude, int amplitudeChange, HeightmapGenerator::faultFunctions_t function, int transitionLength);
 
+	void erodeHeightmapHydraulic(const Heightmap& heightmap, int dropletCount, int seed);
+
+	void erodeHeightmapThermal(const Heightmap& heightmap, int iterations, float talus);
+
+	void fillDepressions(const Heightmap& heightmap);
+
+	void computeFlowAccumulation(const Heightmap& heightmap);
+
+	void importHeightmap(const std::string& filename);
+
 	void createMesh(const Heightmap& heightmap);
 	
 	void loadMesh(const std::string& filename);
 
 	void saveMesh(const Mesh& mesh, const std::string& filename, const std::string& exportFormatId);
 
+	void saveMeshTiles(const Heightmap& heightmap, float heightOffset, float heightScale, int columns, int rows, const std::string& filename, const std::string& exportFormatId, const std::string& extension);
+
+	void loadTexture(const QString& filename, int layerIndex, const QVector<QImage>& layerImages, const QSize& textureSize, GLenum textureFormat);
+
+	void applyHeightExponent(std::shared_ptr<const Heightmap> source, float exponent);
+
 protected:
 
 	void closeEvent(QCloseEvent* event) override;
 
 private:
 
+	static constexpr int SAMPLES_PER_DEFAULT_DROPLET = 4; //!<default droplet count of the hydraulic erosion relative to the heightmap size
+	static constexpr int DEFAULT_THERMAL_ITERATIONS = 100;
+	static constexpr double DEFAULT_TALUS_SLOPE = 4.0; //!<default talus of the thermal erosion, divided by the heightmap size
+	static constexpr int BYTES_PER_MEGABYTE = 1024 * 1024;
+	static constexpr int DEFAULT_TILE_COUNT = 4; //!<default number of mesh tiles along each axis
+
     Ui::MainWindow* ui;
     QGraphicsScene* m_heightmapScene = nullptr;
 	QPixmap m_heightmapPixmap;
+	float m_heightmapPixmapMin = 0.0f; //!<height drawn black in m_heightmapPixmap
+	float m_heightmapPixmapMax = 1.0f; //!<height drawn white in m_heightmapPixmap
 	bool m_loadingMesh = false;
 	bool m_savingMesh = false;
 	bool m_generatingHeightmap = false;
+	bool m_loadingTexture = false; //!<layers can't be added, removed or reordered until the texture has arrived
+	bool m_meshFromHeightmap = false; //!<the displayed mesh was created from Application::m_heightmap, undo and redo patch it
+	bool m_meshRequestFromHeightmap = false; //!<the mesh being created was requested from the current Application::m_heightmap
 
     void lockHeightmap() const;
 
@@ -182,6 +235,24 @@ private:
 
 	void updateHeightmapGUI()  const;
 
+	/** \brief Brings the pixmap and the mesh up to date with the dirty rectangles of Application::m_heightmap.
+	*          Local edits of the heightmap call this instead of recreating the pixmap and the mesh.
+	*          The pixmap is repainted completely if the height range changed, the mesh is only patched if it was created from the heightmap
+	*          and created anew if the range changed.
+	*/
+	void updateDirtyRegions();
+
+	//!<undoes or redoes one step of Application::m_heightmapHistory and refreshes the modified regions
+	void stepHistory(bool forward);
+
+	//!<called when Application::m_heightmap is replaced, the displayed mesh and the one being created no longer follow it
+	void detachMeshFromHeightmap();
+
+	/** \brief Asks for a file to export a mesh to, the format is taken from the selected filter or the extension.
+	*   \return False if the dialog was cancelled.
+	*/
+	bool getExportTarget(const QString& title, QString& filename, AssimpIO::ExportFormat& exportFormat);
+
     void lockMesh() const;
 
 	void unlockMesh() const;
@@ -190,6 +261,12 @@ private:
 
 	void updateMaterialGUI() const;
 
+	/** \brief Reallocates the array texture of the material and uploads the textures of all layers.
+	*          Layer textures are converted and scaled to the given size only if their cached copy doesn't match it.
+	*          Has to be called with the widget's context current.
+	*/
+	void uploadMaterialTextures(LayeredMaterial& material, const QSize& textureSize) const;
+
     void resetTransforms()  const;
 
 };
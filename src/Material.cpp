@@ -2,8 +2,11 @@
 #include "Material.h"
 
 #include <algorithm>
+#include <numeric>
 
 std::unordered_map<GLuint, int> LayeredMaterial::m_textureInstances;
+std::mutex LayeredMaterial::m_textureInstancesMutex;
+std::vector<GLuint> LayeredMaterial::m_releasedTextures;
 
 MaterialLayer::MaterialLayer(const Material& material, float maxY, bool textureEnabled)
 	: m_material(material)
@@ -19,40 +22,42 @@ bool operator<(const MaterialLayer& materialLayer1, const MaterialLayer& materia
 }
 
 LayeredMaterial::LayeredMaterial(const LayeredMaterial& other)
+	: m_materialLayers(other.m_materialLayers)
+	, m_textureLayers(other.m_textureLayers)
+	, m_hasTexture(other.m_hasTexture)
+	, m_textureID(other.m_textureID)
+	, m_textureWidth(other.m_textureWidth)
+	, m_textureHeight(other.m_textureHeight)
+	, m_textureDepth(other.m_textureDepth)
+	, m_textureLevels(other.m_textureLevels)
+	, m_textureFormat(other.m_textureFormat)
 {
-	m_materialLayers = other.m_materialLayers;
-    m_textureWidth = other.m_textureWidth;
-	m_textureHeight = other.m_textureHeight;
-	m_textureID = other.m_textureID;
-
-	for (int i = 0; i < m_materialLayers.size(); ++i)
-	{
-		const MaterialLayer& materialLayer = m_materialLayers[i];
-		m_textureLayers[&materialLayer] = other.m_textureLayers.at(&other.m_materialLayers[i]);
-		m_hasTexture[&materialLayer] = other.m_hasTexture.at(&other.m_materialLayers[i]);
-	}
-
-	if (glIsTexture(m_textureID))
+	if (m_textureID != 0)
 	{
+		std::lock_guard<std::mutex> lock(m_textureInstancesMutex);
 		m_textureInstances[m_textureID]++;
 	}
 }
 
 LayeredMaterial::LayeredMaterial(LayeredMaterial&& other)
+	: m_materialLayers(std::move(other.m_materialLayers))
+	, m_textureLayers(std::move(other.m_textureLayers))
+	, m_hasTexture(std::move(other.m_hasTexture))
+	, m_textureID(other.m_textureID)
+	, m_textureWidth(other.m_textureWidth)
+	, m_textureHeight(other.m_textureHeight)
+	, m_textureDepth(other.m_textureDepth)
+	, m_textureLevels(other.m_textureLevels)
+	, m_textureFormat(other.m_textureFormat)
 {
-	m_materialLayers = std::move(other.m_materialLayers);
-	m_textureLayers = std::move(other.m_textureLayers);
-	m_hasTexture = std::move(other.m_hasTexture);
-	m_textureWidth = other.m_textureWidth;
-	m_textureHeight = other.m_textureHeight;
-	m_textureID = other.m_textureID;
-
 	other.m_materialLayers.clear();
 	other.m_textureLayers.clear();
 	other.m_hasTexture.clear();
 	other.m_textureID = 0;
 	other.m_textureWidth = 0;
 	other.m_textureHeight = 0;
+	other.m_textureDepth = 0;
+	other.m_textureLevels = 0;
 }
 
 LayeredMaterial& LayeredMaterial::operator=(const LayeredMaterial& other)
@@ -62,24 +67,25 @@ LayeredMaterial& LayeredMaterial::operator=(const LayeredMaterial& other)
 		return *this;
 	}
 
+	//take the new instance first, both materials may share the array texture
+
+	if (other.m_textureID != 0)
+	{
+		std::lock_guard<std::mutex> lock(m_textureInstancesMutex);
+		m_textureInstances[other.m_textureID]++;
+	}
+
 	deleteTexture();
 
 	m_materialLayers = other.m_materialLayers;
+	m_textureLayers = other.m_textureLayers;
+	m_hasTexture = other.m_hasTexture;
+	m_textureID = other.m_textureID;
 	m_textureWidth = other.m_textureWidth;
 	m_textureHeight = other.m_textureHeight;
-	m_textureID = other.m_textureID;
-
-	for (int i = 0; i < m_materialLayers.size(); ++i)
-	{
-		const MaterialLayer& materialLayer = m_materialLayers[i];
-		m_textureLayers[&materialLayer] = other.m_textureLayers.at(&other.m_materialLayers[i]);
-		m_hasTexture[&materialLayer] = other.m_hasTexture.at(&other.m_materialLayers[i]);
-	}
-
-	if (glIsTexture(m_textureID))
-	{
-		m_textureInstances[m_textureID]++;
-	}
+	m_textureDepth = other.m_textureDepth;
+	m_textureLevels = other.m_textureLevels;
+	m_textureFormat = other.m_textureFormat;
 
 	return *this;
 }
@@ -96,9 +102,12 @@ LayeredMaterial& LayeredMaterial::operator=(LayeredMaterial&& other)
 	m_materialLayers = std::move(other.m_materialLayers);
 	m_textureLayers = std::move(other.m_textureLayers);
 	m_hasTexture = std::move(other.m_hasTexture);
+	m_textureID = other.m_textureID;
 	m_textureWidth = other.m_textureWidth;
 	m_textureHeight = other.m_textureHeight;
-	m_textureID = other.m_textureID;
+	m_textureDepth = other.m_textureDepth;
+	m_textureLevels = other.m_textureLevels;
+	m_textureFormat = other.m_textureFormat;
 
 	other.m_materialLayers.clear();
 	other.m_textureLayers.clear();
@@ -106,6 +115,8 @@ LayeredMaterial& LayeredMaterial::operator=(LayeredMaterial&& other)
 	other.m_textureID = 0;
 	other.m_textureWidth = 0;
 	other.m_textureHeight = 0;
+	other.m_textureDepth = 0;
+	other.m_textureLevels = 0;
 
 	return *this;
 }
@@ -117,57 +128,157 @@ LayeredMaterial::~LayeredMaterial()
 
 void LayeredMaterial::init(const std::vector<MaterialLayer>& materialLayers)
 {
+	deleteTexture();
+
 	m_materialLayers = materialLayers;
-	std::sort(m_materialLayers.begin(), m_materialLayers.end());
+	m_textureLayers.assign(m_materialLayers.size(), -1);
+	m_hasTexture.assign(m_materialLayers.size(), false);
 
-	deleteTexture();
-	m_textureLayers.clear();
-	m_hasTexture.clear();
-	for (int i = 0; i < m_materialLayers.size(); ++i)
+	sortLayers();
+}
+
+void LayeredMaterial::init(const std::vector<MaterialLayer>& materialLayers, const std::vector<const TextureImage*>& textureImages)
+{
+	init(materialLayers);
+
+	setTextures(textureImages);
+}
+
+void LayeredMaterial::setMaterialLayer(int layerIndex, const MaterialLayer& materialLayer)
+{
+	m_materialLayers[layerIndex] = materialLayer;
+
+	sortLayers();
+}
+
+void LayeredMaterial::setMaterialLayers(const std::vector<MaterialLayer>& materialLayers)
+{
+	if (materialLayers.size() != m_materialLayers.size())
 	{
-		const MaterialLayer& materialLayer = m_materialLayers[i];
-		m_textureLayers[&materialLayer] = i;
-		m_hasTexture[&materialLayer] = false;
+		return;
 	}
+
+	m_materialLayers = materialLayers;
+
+	sortLayers();
 }
 
-void LayeredMaterial::init(const std::vector<MaterialLayer>& materialLayers, GLsizei textureWidth, GLsizei textureHeight, GLenum textureFormat, GLenum textureType, const std::vector<const void*>& pixels)
+void LayeredMaterial::insertMaterialLayer(int layerIndex, const MaterialLayer& materialLayer)
 {
-	m_materialLayers = materialLayers;
-	std::sort(m_materialLayers.begin(), m_materialLayers.end());
+	m_materialLayers.insert(m_materialLayers.begin() + layerIndex, materialLayer);
+	m_textureLayers.insert(m_textureLayers.begin() + layerIndex, -1);
+	m_hasTexture.insert(m_hasTexture.begin() + layerIndex, false);
+
+	sortLayers();
+}
+
+void LayeredMaterial::removeMaterialLayer(int layerIndex)
+{
+	m_materialLayers.erase(m_materialLayers.begin() + layerIndex);
+	m_textureLayers.erase(m_textureLayers.begin() + layerIndex);
+	m_hasTexture.erase(m_hasTexture.begin() + layerIndex);
+}
+
+void LayeredMaterial::swapTextureLayers(int layerIndex1, int layerIndex2)
+{
+	std::swap(m_textureLayers[layerIndex1], m_textureLayers[layerIndex2]);
+	std::vector<bool>::swap(m_hasTexture[layerIndex1], m_hasTexture[layerIndex2]);
+}
 
-	createTexture(textureWidth, textureHeight);
+void LayeredMaterial::setTextures(const std::vector<const TextureImage*>& textureImages)
+{
+	int layerCount = m_materialLayers.size();
 
-	m_textureLayers.clear();
-	m_hasTexture.clear();
-	for (int i = 0; i < m_materialLayers.size(); ++i)
+	auto firstImage = std::find_if(textureImages.begin(), textureImages.end(), [](const TextureImage* textureImage)
 	{
-		const MaterialLayer& materialLayer = m_materialLayers[i];
-		m_textureLayers[&materialLayer] = i;
-		m_hasTexture[&materialLayer] = pixels[i];
-		if (pixels[i])
+		return textureImage != nullptr && !textureImage->m_levels.empty();
+	});
+
+	if (firstImage == textureImages.end())
+	{
+		deleteTexture();
+		m_textureLayers.assign(layerCount, -1);
+		m_hasTexture.assign(layerCount, false);
+		return;
+	}
+
+	const TextureImage& format = **firstImage;
+	createTexture(format.m_width, format.m_height, layerCount, format.m_levels.size(), format.m_internalFormat);
+
+	for (int i = 0; i < layerCount; ++i)
+	{
+		const TextureImage* textureImage = textureImages[i];
+
+		m_textureLayers[i] = i;
+		m_hasTexture[i] = textureImage != nullptr &&
+			textureImage->m_width == m_textureWidth &&
+			textureImage->m_height == m_textureHeight &&
+			textureImage->m_internalFormat == m_textureFormat &&
+			textureImage->m_levels.size() == m_textureLevels;
+
+		if (m_hasTexture[i])
 		{
-			glTextureSubImage3D(m_textureID, 0, 0, 0, i, textureWidth, textureHeight, 1, textureFormat, textureType, pixels[i]);
+			uploadTextureLayer(i, *textureImage);
 		}
-
 	}
 }
 
-void LayeredMaterial::setMaterialLayer(int layerIndex, const MaterialLayer& materialLayer)
+bool LayeredMaterial::setTextureLayer(int layerIndex, const TextureImage* textureImage)
 {
-	m_materialLayers[layerIndex] = materialLayer;
-	std::sort(m_materialLayers.begin(), m_materialLayers.end());
-}
+	if (textureImage == nullptr)
+	{
+		m_hasTexture[layerIndex] = false;
+		return true;
+	}
 
-void LayeredMaterial::setTextureLayer(int layerIndex, GLenum textureFormat, GLenum textureType, const void* pixels)
-{
-	const MaterialLayer& materialLayer = m_materialLayers[layerIndex];
-	m_hasTexture[&materialLayer] = pixels;
+	if (m_textureID == 0 ||
+		textureImage->m_width != m_textureWidth ||
+		textureImage->m_height != m_textureHeight ||
+		textureImage->m_internalFormat != m_textureFormat ||
+		textureImage->m_levels.size() != m_textureLevels)
+	{
+		return false;
+	}
+
+	GLsizei depth = m_textureDepth;
+
+	if (m_textureLayers[layerIndex] < 0)
+	{
+		//take the first slot that no layer refers to
 
-	if (pixels)
+		std::vector<bool> usedSlots(m_textureDepth, false);
+		for (int textureLayer : m_textureLayers)
+		{
+			if (textureLayer >= 0)
+			{
+				usedSlots[textureLayer] = true;
+			}
+		}
+
+		auto freeSlot = std::find(usedSlots.begin(), usedSlots.end(), false);
+		if (freeSlot == usedSlots.end())
+		{
+			m_textureLayers[layerIndex] = m_textureDepth;
+			depth = std::max(m_textureDepth * 2, m_textureDepth + 1);
+		}
+		else
+		{
+			m_textureLayers[layerIndex] = freeSlot - usedSlots.begin();
+		}
+	}
+
+	//other instances of the material, e.g. the renderer's, may be sampling the array texture right now,
+	//so the texels are written into a copy unless this instance is the only one using it
+
+	if (depth != m_textureDepth || isTextureShared())
 	{
-		glTextureSubImage3D(m_textureID, 0, 0, 0, m_textureLayers[&materialLayer], m_textureWidth, m_textureHeight, 1, textureFormat, textureType, pixels);
+		copyTexture(depth);
 	}
+
+	uploadTextureLayer(m_textureLayers[layerIndex], *textureImage);
+	m_hasTexture[layerIndex] = true;
+
+	return true;
 }
 
 const MaterialLayer& LayeredMaterial::getMaterialLayer(int index) const
@@ -177,7 +288,12 @@ const MaterialLayer& LayeredMaterial::getMaterialLayer(int index) const
 
 bool LayeredMaterial::hasTexture(int layerIndex) const
 {
-	return m_hasTexture.at(&m_materialLayers[layerIndex]);
+	return m_hasTexture[layerIndex];
+}
+
+int LayeredMaterial::getTextureLayer(int layerIndex) const
+{
+	return m_textureLayers[layerIndex];
 }
 
 const std::vector<MaterialLayer>& LayeredMaterial::getMaterialLayers() const
@@ -200,38 +316,168 @@ int LayeredMaterial::getTextureHeight() const
 	return m_textureHeight;
 }
 
+GLenum LayeredMaterial::getTextureFormat() const
+{
+	return m_textureFormat;
+}
+
 int LayeredMaterial::getLayerCount() const
 {
 	return m_materialLayers.size();
 }
 
-void LayeredMaterial::createTexture(GLsizei width, GLsizei height)
+void LayeredMaterial::createTexture(GLsizei width, GLsizei height, GLsizei depth, GLsizei levels, GLenum internalFormat)
 {
 	deleteTexture();
 
-	int layerCount = m_materialLayers.size();
+	depth = std::max(depth, 1);
 
 	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &m_textureID);
-	glTextureStorage3D(m_textureID, 1, GL_RGBA8, width, height, layerCount);
+	glTextureStorage3D(m_textureID, levels, internalFormat, width, height, depth);
+	glTextureParameteri(m_textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(m_textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	m_textureInstances[m_textureID] = 1;
+	{
+		std::lock_guard<std::mutex> lock(m_textureInstancesMutex);
+		m_textureInstances[m_textureID] = 1;
+	}
 
 	m_textureWidth = width;
 	m_textureHeight = height;
+	m_textureDepth = depth;
+	m_textureLevels = levels;
+	m_textureFormat = internalFormat;
 }
 
-void LayeredMaterial::deleteTexture()
+bool LayeredMaterial::isTextureShared() const
+{
+	std::lock_guard<std::mutex> lock(m_textureInstancesMutex);
+	auto instances = m_textureInstances.find(m_textureID);
+
+	return instances != m_textureInstances.end() && instances->second > 1;
+}
+
+void LayeredMaterial::copyTexture(GLsizei depth)
+{
+	GLuint oldTextureID = m_textureID;
+	GLsizei oldDepth = m_textureDepth;
+
+	//keep the old texture alive for the copy, other copies of the material may still use it
+
+	{
+		std::lock_guard<std::mutex> lock(m_textureInstancesMutex);
+		m_textureInstances[oldTextureID]++;
+	}
+
+	createTexture(m_textureWidth, m_textureHeight, depth, m_textureLevels, m_textureFormat);
+
+	for (GLsizei level = 0; level < m_textureLevels; ++level)
+	{
+		glCopyImageSubData(oldTextureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			m_textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			std::max(m_textureWidth >> level, 1), std::max(m_textureHeight >> level, 1), oldDepth);
+	}
+
+	releaseTexture(oldTextureID);
+}
+
+void LayeredMaterial::uploadTextureLayer(int textureLayer, const TextureImage& textureImage) const
 {
-	if (glIsTexture(m_textureID))
+	bool compressed = m_textureFormat != GL_RGBA8;
+
+	for (GLsizei level = 0; level < m_textureLevels; ++level)
 	{
-		m_textureInstances[m_textureID]--;
-		if (m_textureInstances[m_textureID] == 0)
+		const std::vector<unsigned char>& data = textureImage.m_levels[level];
+		GLsizei width = std::max(m_textureWidth >> level, 1);
+		GLsizei height = std::max(m_textureHeight >> level, 1);
+
+		if (compressed)
 		{
-			glDeleteTextures(1, &m_textureID);
+			glCompressedTextureSubImage3D(m_textureID, level, 0, 0, textureLayer, width, height, 1, m_textureFormat, data.size(), data.data());
 		}
+		else
+		{
+			glTextureSubImage3D(m_textureID, level, 0, 0, textureLayer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+		}
+	}
+}
+
+void LayeredMaterial::deleteTexture()
+{
+	//copies of the material are destroyed on both the GUI and the render thread
+
+	if (m_textureID != 0)
+	{
+		releaseTexture(m_textureID);
 		m_textureID = 0;
 	}
 
 	m_textureWidth = 0;
 	m_textureHeight = 0;
+	m_textureDepth = 0;
+	m_textureLevels = 0;
+}
+
+void LayeredMaterial::deleteReleasedTextures()
+{
+	std::vector<GLuint> textureIDs;
+
+	{
+		std::lock_guard<std::mutex> lock(m_textureInstancesMutex);
+		textureIDs.swap(m_releasedTextures);
+	}
+
+	if (!textureIDs.empty())
+	{
+		glDeleteTextures(static_cast<GLsizei>(textureIDs.size()), textureIDs.data());
+	}
+}
+
+void LayeredMaterial::releaseTexture(GLuint textureID)
+{
+	//the last instance can be dropped on a thread without a current context, the render thread deletes the texture later
+
+	std::lock_guard<std::mutex> lock(m_textureInstancesMutex);
+
+	if (--m_textureInstances[textureID] == 0)
+	{
+		m_textureInstances.erase(textureID);
+		m_releasedTextures.push_back(textureID);
+	}
+}
+
+void LayeredMaterial::sortLayers()
+{
+	if (std::is_sorted(m_materialLayers.begin(), m_materialLayers.end()))
+	{
+		return;
+	}
+
+	//sort an index permutation, so the texture slots and flags follow their layers
+
+	std::vector<int> order(m_materialLayers.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	std::stable_sort(order.begin(), order.end(), [this](int index1, int index2)
+	{
+		return m_materialLayers[index1] < m_materialLayers[index2];
+	});
+
+	std::vector<MaterialLayer> materialLayers;
+	std::vector<int> textureLayers;
+	std::vector<bool> hasTexture;
+	materialLayers.reserve(order.size());
+	textureLayers.reserve(order.size());
+	hasTexture.reserve(order.size());
+
+	for (int index : order)
+	{
+		materialLayers.push_back(std::move(m_materialLayers[index]));
+		textureLayers.push_back(m_textureLayers[index]);
+		hasTexture.push_back(m_hasTexture[index]);
+	}
+
+	m_materialLayers = std::move(materialLayers);
+	m_textureLayers = std::move(textureLayers);
+	m_hasTexture = std::move(hasTexture);
 }
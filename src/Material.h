@@ -6,7 +6,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <mutex>
 #include <unordered_map>
+#include <vector>
+
+#include "TextureImage.h"
 
 class Material
 {
@@ -65,11 +69,36 @@ public:
 
 	void init(const std::vector<MaterialLayer>& materialLayers);
 
-	void init(const std::vector<MaterialLayer>& materialLayers, GLsizei textureWidth, GLsizei textureHeight, GLenum textureFormat, GLenum textureType, const std::vector<const void*>& pixels);
+	void init(const std::vector<MaterialLayer>& materialLayers, const std::vector<const TextureImage*>& textureImages);
 
+	//!<replaces the parameters of one layer, its texture moves with it when the layers are sorted again
 	void setMaterialLayer(int layerIndex, const MaterialLayer& materialLayer);
 
-	void setTextureLayer(int layerIndex, GLenum textureFormat, GLenum textureType, const void* pixels);
+	//!<replaces the parameters of all layers without touching the textures, the layer count has to stay the same
+	void setMaterialLayers(const std::vector<MaterialLayer>& materialLayers);
+
+	//!<inserts a layer without a texture
+	void insertMaterialLayer(int layerIndex, const MaterialLayer& materialLayer);
+
+	//!<removes a layer, its slot in the array texture is reused by the next uploaded texture
+	void removeMaterialLayer(int layerIndex);
+
+	//!<exchanges the textures of two layers by permuting the layer to slot mapping, no texel is copied
+	void swapTextureLayers(int layerIndex1, int layerIndex2);
+
+	/** \brief Reallocates the array texture with one slot for each layer and uploads the given textures with all their mip levels.
+	*          The size and format of the array texture are taken from the first texture.
+	*   \param textureImages Texture for each layer, nullptr for layers without a texture.
+	*/
+	void setTextures(const std::vector<const TextureImage*>& textureImages);
+
+	/** \brief Uploads the texture of a single layer into the array texture.
+	*          A layer without a slot gets a free one, the array texture grows if there is none left.
+	*          An array texture shared with other instances is copied first, so they never see it change.
+	*   \param textureImage Texture with the size and format of the array texture, nullptr removes the texture of the layer.
+	*   \return False if the texture doesn't match the array texture.
+	*/
+	bool setTextureLayer(int layerIndex, const TextureImage* textureImage);
 
 	const MaterialLayer& getMaterialLayer(int layerIndex) const;
 
@@ -77,26 +106,55 @@ public:
 
 	bool hasTexture(int layerIndex) const;
 
+	//!<returns the slot of the layer in the array texture or -1 if it has none
+	int getTextureLayer(int layerIndex) const;
+
 	GLuint getTextureID() const;
 
 	int getTextureWidth() const;
 
 	int getTextureHeight() const;
 
+	GLenum getTextureFormat() const;
+
 	int getLayerCount() const;
 
+	/** \brief Deletes the array textures whose last instance has been destroyed since the previous call.
+	*          Has to be called regularly on the render thread, with its context current.
+	*/
+	static void deleteReleasedTextures();
+
 private:
 
 	std::vector<MaterialLayer> m_materialLayers;
-	std::unordered_map<const MaterialLayer*, int> m_textureLayers; //!<indices into the array texture for each layer
-	std::unordered_map<const MaterialLayer*, bool> m_hasTexture;
+	std::vector<int> m_textureLayers; //!<slot in the array texture for each layer, -1 if it has none
+	std::vector<bool> m_hasTexture; //!<for each layer
 	GLuint m_textureID = 0;
 	GLsizei m_textureWidth = 0;
 	GLsizei m_textureHeight = 0;
+	GLsizei m_textureDepth = 0; //!<number of slots in the array texture
+	GLsizei m_textureLevels = 0;
+	GLenum m_textureFormat = GL_RGBA8;
 
 	static std::unordered_map<GLuint, int> m_textureInstances; //!<number of array texture instances for each array texture ID
+	static std::mutex m_textureInstancesMutex;
+	static std::vector<GLuint> m_releasedTextures; //!<array textures without instances that still have to be deleted, guarded by m_textureInstancesMutex
+
+	void createTexture(GLsizei width, GLsizei height, GLsizei depth, GLsizei levels, GLenum internalFormat);
+
+	void uploadTextureLayer(int textureLayer, const TextureImage& textureImage) const;
 
-	void createTexture(GLsizei width, GLsizei height);
+	//!<true if other instances of the material use the same array texture
+	bool isTextureShared() const;
+
+	//!<replaces the array texture of this instance by one with at least as many slots and copies the existing ones over on the GPU
+	void copyTexture(GLsizei depth);
 
 	void deleteTexture();
+
+	//!<drops one instance of the array texture and queues it for deleteReleasedTextures() with the last one
+	static void releaseTexture(GLuint textureID);
+
+	//!<sorts the layers by height, their texture slots and flags are permuted along
+	void sortLayers();
 };
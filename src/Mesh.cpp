@@ -1,5 +1,7 @@
 
 #include <algorithm>
+#include <cmath>
+#include <utility>
 
 #include "Mesh.h"
 
@@ -44,6 +46,220 @@ void Mesh::computeNormals()
     }
 }
 
+void Mesh::buildChunks()
+{
+	sortIntoChunks(m_vertices, m_bbox, m_indices, m_chunks);
+
+	computeChunkBoundingBoxes(m_vertices, m_indices, m_chunks);
+
+	m_bvh.build(getChunkBoundingBoxes(m_chunks));
+}
+
+void Mesh::getGridPlacement(int width, int height, float minHeight, float maxHeight, glm::vec3& start, float& heightScale)
+{
+	float sizeY = width * 0.25f;
+
+	heightScale = sizeY / (maxHeight - minHeight);
+
+	start.x = -(width - 1) / 2.0f;
+	start.y = -sizeY / 2.0f;
+	start.z = -(height - 1) / 2.0f;
+}
+
+void Mesh::createGridIndices(int width, int height, std::vector<int>& indices)
+{
+	//create 2 triangles for every vertex except for vertices in the last row and the last column
+
+	indices.clear();
+	indices.reserve(6 * (width - 1) * (height - 1));
+	for (int row = 0; row < height - 1; ++row)
+	{
+		for (int col = 0; col < width - 1; ++col)
+		{
+			//first triangle
+			indices.push_back((row * width) + col);
+			indices.push_back(((row + 1) * width) + col);
+			indices.push_back(((row + 1) * width) + (col + 1));
+
+			//second triangle
+			indices.push_back((row * width) + col);
+			indices.push_back(((row + 1) * width) + (col + 1));
+			indices.push_back((row * width) + (col + 1));
+		}
+	}
+}
+
+void Mesh::createGridVertices(const Heightmap& heightmap, const HeightmapRect& rect, const glm::vec3& start, float heightScale, std::vector<Vertex>& vertices)
+{
+	int gridWidth = heightmap.getWidth();
+	int gridHeight = heightmap.getHeight();
+	int rectWidth = rect.m_right - rect.m_left;
+
+	auto getPosition = [&heightmap, &start, heightScale](int row, int col)
+	{
+		return glm::vec3(start.x + col, start.y + heightmap.at(row, col) * heightScale, start.z + row);
+	};
+
+	vertices.resize(rectWidth * (rect.m_bottom - rect.m_top));
+
+	for (int row = rect.m_top; row < rect.m_bottom; ++row)
+	{
+		for (int col = rect.m_left; col < rect.m_right; ++col)
+		{
+			Vertex& vertex = vertices[(row - rect.m_top) * rectWidth + col - rect.m_left];
+			vertex.m_position = getPosition(row, col);
+			vertex.m_texCoords = glm::vec3(0.0f, 0.0f, 0.0f);
+			vertex.m_normal = glm::vec3(0.0f, 0.0f, 0.0f);
+		}
+	}
+
+	//same triangles as createGridIndices(), every cell that has a corner inside the rectangle adds its face normals to those corners
+
+	int firstCellRow = std::max(rect.m_top - 1, 0);
+	int lastCellRow = std::min(rect.m_bottom, gridHeight - 1);
+	int firstCellCol = std::max(rect.m_left - 1, 0);
+	int lastCellCol = std::min(rect.m_right, gridWidth - 1);
+
+	auto addNormal = [&vertices, &rect, rectWidth](int row, int col, const glm::vec3& normal)
+	{
+		if (row >= rect.m_top && row < rect.m_bottom && col >= rect.m_left && col < rect.m_right)
+		{
+			vertices[(row - rect.m_top) * rectWidth + col - rect.m_left].m_normal += normal;
+		}
+	};
+
+	for (int row = firstCellRow; row < lastCellRow; ++row)
+	{
+		for (int col = firstCellCol; col < lastCellCol; ++col)
+		{
+			glm::vec3 topLeft = getPosition(row, col);
+			glm::vec3 topRight = getPosition(row, col + 1);
+			glm::vec3 bottomLeft = getPosition(row + 1, col);
+			glm::vec3 bottomRight = getPosition(row + 1, col + 1);
+
+			glm::vec3 firstNormal = glm::cross(bottomLeft - topLeft, bottomRight - topLeft);
+			glm::vec3 secondNormal = glm::cross(bottomRight - topLeft, topRight - topLeft);
+
+			addNormal(row, col, firstNormal + secondNormal);
+			addNormal(row + 1, col, firstNormal);
+			addNormal(row + 1, col + 1, firstNormal + secondNormal);
+			addNormal(row, col + 1, secondNormal);
+		}
+	}
+
+	for (Vertex& vertex : vertices)
+	{
+		vertex.m_normal = glm::normalize(vertex.m_normal);
+	}
+}
+
+void Mesh::sortIntoChunks(const std::vector<Vertex>& vertices, const AABB& bbox, std::vector<int>& indices, std::vector<MeshChunk>& chunks)
+{
+	chunks.clear();
+
+	int triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//bin the triangles by their centroid into a regular grid over the xz-plane, 
+	//so that each cell holds about TRIANGLES_PER_CHUNK triangles
+
+	float area = std::max(bbox.m_size.x, 1.0f) * std::max(bbox.m_size.z, 1.0f);
+	float cellSize = std::sqrt(area * TRIANGLES_PER_CHUNK / triangleCount);
+	int cellsX = std::max(1, static_cast<int>(std::ceil(bbox.m_size.x / cellSize)));
+	int cellsZ = std::max(1, static_cast<int>(std::ceil(bbox.m_size.z / cellSize)));
+
+	std::vector<int> triangleCells(triangleCount);
+	std::vector<int> cellOffsets(cellsX * cellsZ + 1, 0);
+
+	for (int i = 0; i < triangleCount; ++i)
+	{
+		glm::vec3 centroid = (
+			vertices[indices[3 * i]].m_position + 
+			vertices[indices[3 * i + 1]].m_position + 
+			vertices[indices[3 * i + 2]].m_position) / 3.0f;
+
+		int cellX = std::min(cellsX - 1, std::max(0, static_cast<int>((centroid.x - bbox.m_min.x) / cellSize)));
+		int cellZ = std::min(cellsZ - 1, std::max(0, static_cast<int>((centroid.z - bbox.m_min.z) / cellSize)));
+
+		triangleCells[i] = cellZ * cellsX + cellX;
+		cellOffsets[triangleCells[i] + 1]++;
+	}
+
+	for (int cell = 0; cell < cellsX * cellsZ; ++cell)
+	{
+		cellOffsets[cell + 1] += cellOffsets[cell];
+	}
+
+	//counting sort of the triangles by cell, which keeps their original order within each cell
+
+	std::vector<int> sortedIndices(indices.size());
+	std::vector<int> cellFill(cellOffsets.begin(), cellOffsets.end() - 1);
+
+	for (int i = 0; i < triangleCount; ++i)
+	{
+		int target = 3 * cellFill[triangleCells[i]]++;
+		sortedIndices[target] = indices[3 * i];
+		sortedIndices[target + 1] = indices[3 * i + 1];
+		sortedIndices[target + 2] = indices[3 * i + 2];
+	}
+
+	indices = std::move(sortedIndices);
+
+	for (int cell = 0; cell < cellsX * cellsZ; ++cell)
+	{
+		if (cellOffsets[cell + 1] > cellOffsets[cell])
+		{
+			MeshChunk chunk;
+			chunk.m_firstIndex = 3 * cellOffsets[cell];
+			chunk.m_indexCount = 3 * (cellOffsets[cell + 1] - cellOffsets[cell]);
+			chunks.push_back(chunk);
+		}
+	}
+}
+
+void Mesh::computeChunkBoundingBoxes(const std::vector<Vertex>& vertices, const std::vector<int>& indices, std::vector<MeshChunk>& chunks)
+{
+	for (MeshChunk& chunk : chunks)
+	{
+		chunk.m_bbox = AABB::getEmpty();
+
+		for (int i = chunk.m_firstIndex; i < chunk.m_firstIndex + chunk.m_indexCount; ++i)
+		{
+			chunk.m_bbox.extend(vertices[indices[i]].m_position);
+		}
+	}
+}
+
+std::vector<AABB> Mesh::getChunkBoundingBoxes(const std::vector<MeshChunk>& chunks)
+{
+	std::vector<AABB> chunkBoxes;
+	chunkBoxes.reserve(chunks.size());
+	for (const MeshChunk& chunk : chunks)
+	{
+		chunkBoxes.push_back(chunk.m_bbox);
+	}
+
+	return chunkBoxes;
+}
+
+std::vector<int> Mesh::getLodSamples(int size, int stride)
+{
+	//every stride-th row or column, the last one is always kept so the coarse grid covers the whole mesh
+
+	std::vector<int> samples;
+	for (int i = 0; i < size - 1; i += stride)
+	{
+		samples.push_back(i);
+	}
+	samples.push_back(size - 1);
+
+	return samples;
+}
+
 void Mesh::setHeight(float height)
 {
 	if (m_vertices.empty() || height <= 0.0f || height == m_bbox.m_size.y)
@@ -58,8 +274,15 @@ void Mesh::setHeight(float height)
 		vertex.m_position.y *= scale;
 	}
 
+	m_heightOffset *= scale;
+	m_heightScale *= scale;
+
 	m_bbox.compute(*this);
 
+	computeChunkBoundingBoxes(m_vertices, m_indices, m_chunks);
+
+	m_bvh.refit(getChunkBoundingBoxes(m_chunks));
+
 	computeNormals();
 }
 
@@ -73,6 +296,11 @@ void Mesh::setTexCoords(float texAspectRatio, int texRepeats)
     float texLengthX = (m_bbox.m_size.x / texRepeats);
 	float texLengthZ = (1 / texAspectRatio) * texLengthX;
 
+	//setHeight() leaves the texture coordinates alone, patches have to map heights the same way
+
+	m_texHeightOffset = (m_heightOffset - m_bbox.m_min.y) / texLengthX;
+	m_texHeightScale = m_heightScale / texLengthX;
+
     for (Vertex& vertex : m_vertices)
     {
 		vertex.m_texCoords.x = (vertex.m_position.x - m_bbox.m_min.x) / texLengthX;
@@ -90,18 +318,16 @@ bool Mesh::set(const Heightmap& heightmap, float texAspectRatio, int texRepeats)
 
 	int heightmapWidth = heightmap.getWidth();
     int heightmapHeight = heightmap.getHeight();
-	
-	m_bbox.m_size.x = heightmapWidth - 1;
-	m_bbox.m_size.y = heightmapWidth * 0.25f;
-	m_bbox.m_size.z = heightmapHeight - 1;
 
-	float scale = m_bbox.m_size.y / (heightmap.getMax() - heightmap.getMin());
-	
 	glm::vec3 start;
-	start.x = -(heightmapWidth - 1) / 2.0f;
-	start.y = -m_bbox.m_size.y / 2.0f;
-	start.z = -(heightmapHeight - 1) / 2.0f;
+	float scale = 0.0f;
+	getGridPlacement(heightmapWidth, heightmapHeight, heightmap.getMin(), heightmap.getMax(), start, scale);
     
+	m_heightOffset = start.y;
+	m_heightScale = scale;
+
+	m_uvs.clear();
+
 	m_vertices.clear();
 	m_vertices.reserve(heightmapWidth * heightmapHeight);
 	for (int row = 0; row < heightmapHeight; ++row)
@@ -120,29 +346,74 @@ bool Mesh::set(const Heightmap& heightmap, float texAspectRatio, int texRepeats)
 
     setTexCoords(texAspectRatio, texRepeats);
 
-	//create 2 triangles for every point in the heightmap except for points in the last row and the last column
+	createGridIndices(heightmapWidth, heightmapHeight, m_indices);
 
-	m_indices.clear();
-	m_indices.reserve(6 * (heightmapWidth - 1) * (heightmapHeight - 1));
-	for (int row = 0; row < heightmapHeight - 1; ++row)
+    computeNormals();
+
+	buildChunks();
+
+	m_gridWidth = heightmapWidth;
+	m_gridHeight = heightmapHeight;
+
+    return true;
+}
+
+bool Mesh::set(const Heightmap& heightmap, const HeightmapRect& rect, float heightOffset, float heightScale, float texAspectRatio, int texRepeats)
+{
+	int tileWidth = rect.m_right - rect.m_left;
+	int tileHeight = rect.m_bottom - rect.m_top;
+
+	if (heightmap.isEmpty() || rect.m_left < 0 || rect.m_top < 0 || rect.m_right > heightmap.getWidth() || rect.m_bottom > heightmap.getHeight() ||
+		tileWidth < 2 || tileHeight < 2 || texAspectRatio <= 0.0f || texRepeats < 1)
 	{
-		for (int col = 0; col < heightmapWidth - 1; ++col)
-		{
-			//first triangle
-			m_indices.push_back((row * heightmapWidth) + col);
-			m_indices.push_back(((row + 1) * heightmapWidth) + col);
-			m_indices.push_back(((row + 1) * heightmapWidth) + (col + 1));
+		return false;
+	}
 
-			//second triangle
-			m_indices.push_back((row * heightmapWidth) + col);
-			m_indices.push_back(((row + 1) * heightmapWidth) + (col + 1));
-			m_indices.push_back((row * heightmapWidth) + (col + 1));
+	//x and z only depend on the size of the heightmap, the vertical placement is the one of the whole mesh
+
+	glm::vec3 start;
+	float scale = 0.0f;
+	getGridPlacement(heightmap.getWidth(), heightmap.getHeight(), 0.0f, 1.0f, start, scale);
+	start.y = heightOffset;
+
+	m_heightOffset = heightOffset;
+	m_heightScale = heightScale;
+
+	createGridVertices(heightmap, rect, start, heightScale, m_vertices);
+
+	//u runs along x and v against z like the texture coordinates of the renderer, across the whole heightmap
+
+	float uScale = 1.0f / (heightmap.getWidth() - 1);
+	float vScale = 1.0f / (heightmap.getHeight() - 1);
+
+	m_uvs.resize(m_vertices.size());
+	for (int row = 0; row < tileHeight; ++row)
+	{
+		for (int col = 0; col < tileWidth; ++col)
+		{
+			m_uvs[row * tileWidth + col] = glm::vec2((rect.m_left + col) * uScale, (heightmap.getHeight() - 1 - rect.m_top - row) * vScale);
 		}
 	}
 
-    computeNormals();
+	m_bbox.compute(*this);
 
-    return true;
+	setTexCoords(texAspectRatio, texRepeats);
+
+	createGridIndices(tileWidth, tileHeight, m_indices);
+
+	buildChunks();
+
+	m_gridWidth = tileWidth;
+	m_gridHeight = tileHeight;
+
+	return true;
+}
+
+void Mesh::getDefaultHeightMapping(const Heightmap& heightmap, float& heightOffset, float& heightScale)
+{
+	glm::vec3 start;
+	getGridPlacement(heightmap.getWidth(), heightmap.getHeight(), heightmap.getMin(), heightmap.getMax(), start, heightScale);
+	heightOffset = start.y;
 }
 
 bool Mesh::set(const std::vector<Vertex>& vertices, const std::vector<int>& indices, float texAspectRatio, int texRepeats)
@@ -154,6 +425,7 @@ bool Mesh::set(const std::vector<Vertex>& vertices, const std::vector<int>& indi
 
 	m_vertices = vertices;
 	m_indices = indices;
+	m_uvs.clear();
 
 	m_bbox.compute(*this);
 
@@ -161,6 +433,68 @@ bool Mesh::set(const std::vector<Vertex>& vertices, const std::vector<int>& indi
 
 	setTexCoords(texAspectRatio, texRepeats);
 
+	buildChunks();
+
+	m_gridWidth = 0;
+	m_gridHeight = 0;
+
+	return true;
+}
+
+bool Mesh::set(std::vector<Vertex>&& vertices, std::vector<int>&& indices, std::vector<glm::vec2>&& uvs, bool hasNormals, float texAspectRatio, int texRepeats)
+{
+	if (vertices.empty() || indices.empty() || texAspectRatio <= 0.0f || texRepeats < 1 || (!uvs.empty() && uvs.size() != vertices.size()))
+	{
+		return false;
+	}
+
+	m_vertices = std::move(vertices);
+	m_indices = std::move(indices);
+	m_uvs = std::move(uvs);
+
+	m_bbox.compute(*this);
+
+	if (!hasNormals)
+	{
+		computeNormals();
+	}
+
+	setTexCoords(texAspectRatio, texRepeats);
+
+	buildChunks();
+
+	m_gridWidth = 0;
+	m_gridHeight = 0;
+
+	return true;
+}
+
+bool Mesh::set(std::vector<Vertex>&& vertices, std::vector<int>&& indices, std::vector<glm::vec2>&& uvs, std::vector<MeshChunk>&& chunks, 
+	const AABB& bbox, const MeshGridMapping& gridMapping)
+{
+	bool isGrid = gridMapping.m_width > 0 && gridMapping.m_height > 0;
+
+	if (vertices.empty() || indices.empty() || chunks.empty() || (!uvs.empty() && uvs.size() != vertices.size()) ||
+		(isGrid && static_cast<size_t>(gridMapping.m_width) * gridMapping.m_height != vertices.size()))
+	{
+		return false;
+	}
+
+	m_vertices = std::move(vertices);
+	m_indices = std::move(indices);
+	m_uvs = std::move(uvs);
+	m_chunks = std::move(chunks);
+	m_bbox = bbox;
+
+	m_gridWidth = isGrid ? gridMapping.m_width : 0;
+	m_gridHeight = isGrid ? gridMapping.m_height : 0;
+	m_heightOffset = gridMapping.m_heightOffset;
+	m_heightScale = gridMapping.m_heightScale;
+	m_texHeightOffset = gridMapping.m_texHeightOffset;
+	m_texHeightScale = gridMapping.m_texHeightScale;
+
+	m_bvh.build(getChunkBoundingBoxes(m_chunks));
+
 	return true;
 }
 
@@ -184,11 +518,249 @@ const std::vector<int>& Mesh::getIndices() const
 	return m_indices;
 }
 
+const std::vector<glm::vec2>& Mesh::getUVs() const
+{
+	return m_uvs;
+}
+
 const AABB& Mesh::getBoundingBox() const
 {
 	return m_bbox;
 }
 
+const std::vector<MeshChunk>& Mesh::getChunks() const
+{
+	return m_chunks;
+}
+
+const BoundingVolumeHierarchy& Mesh::getBoundingVolumeHierarchy() const
+{
+	return m_bvh;
+}
+
+bool Mesh::isGrid() const
+{
+	return m_gridWidth > 1 && m_gridHeight > 1;
+}
+
+int Mesh::getGridWidth() const
+{
+	return m_gridWidth;
+}
+
+int Mesh::getGridHeight() const
+{
+	return m_gridHeight;
+}
+
+MeshGridMapping Mesh::getGridMapping() const
+{
+	MeshGridMapping gridMapping;
+	gridMapping.m_width = m_gridWidth;
+	gridMapping.m_height = m_gridHeight;
+	gridMapping.m_heightOffset = m_heightOffset;
+	gridMapping.m_heightScale = m_heightScale;
+	gridMapping.m_texHeightOffset = m_texHeightOffset;
+	gridMapping.m_texHeightScale = m_texHeightScale;
+
+	return gridMapping;
+}
+
+float Mesh::getGridSpacing() const
+{
+	if (!isGrid())
+	{
+		return 0.0f;
+	}
+
+	return m_bbox.m_size.x / (m_gridWidth - 1);
+}
+
+int Mesh::getLodIndexCount(int stride) const
+{
+	if (!isGrid() || stride < 2)
+	{
+		return 0;
+	}
+
+	int columns = static_cast<int>(getLodSamples(m_gridWidth, stride).size());
+	int rows = static_cast<int>(getLodSamples(m_gridHeight, stride).size());
+
+	return 6 * (columns - 1) * (rows - 1);
+}
+
+bool Mesh::getLod(int stride, MeshLod& lod) const
+{
+	if (!isGrid() || stride < 2)
+	{
+		return false;
+	}
+
+	std::vector<int> columns = getLodSamples(m_gridWidth, stride);
+	std::vector<int> rows = getLodSamples(m_gridHeight, stride);
+
+	lod.m_stride = stride;
+	lod.m_indices.clear();
+	lod.m_indices.reserve(getLodIndexCount(stride));
+
+	//same triangulation and winding as the full resolution grid
+
+	for (int row = 0; row < rows.size() - 1; ++row)
+	{
+		for (int col = 0; col < columns.size() - 1; ++col)
+		{
+			int topLeft = rows[row] * m_gridWidth + columns[col];
+			int topRight = rows[row] * m_gridWidth + columns[col + 1];
+			int bottomLeft = rows[row + 1] * m_gridWidth + columns[col];
+			int bottomRight = rows[row + 1] * m_gridWidth + columns[col + 1];
+
+			//first triangle
+			lod.m_indices.push_back(topLeft);
+			lod.m_indices.push_back(bottomLeft);
+			lod.m_indices.push_back(bottomRight);
+
+			//second triangle
+			lod.m_indices.push_back(topLeft);
+			lod.m_indices.push_back(bottomRight);
+			lod.m_indices.push_back(topRight);
+		}
+	}
+
+	sortIntoChunks(m_vertices, m_bbox, lod.m_indices, lod.m_chunks);
+
+	computeChunkBoundingBoxes(m_vertices, lod.m_indices, lod.m_chunks);
+
+	lod.m_bvh.build(getChunkBoundingBoxes(lod.m_chunks));
+
+	return true;
+}
+
+std::vector<MeshPatch> Mesh::createPatches(const Heightmap& heightmap, const std::vector<HeightmapRect>& rects) const
+{
+	std::vector<MeshPatch> patches;
+
+	if (!isGrid() || heightmap.getWidth() != m_gridWidth || heightmap.getHeight() != m_gridHeight)
+	{
+		return patches;
+	}
+
+	//positions follow from the heightmap alone, so the new neighbours of the halo don't have to be patched first
+
+	glm::vec3 start(m_vertices[0].m_position.x, m_heightOffset, m_vertices[0].m_position.z);
+
+	for (const HeightmapRect& rect : rects)
+	{
+		MeshPatch patch;
+		patch.m_rect.m_left = std::max(rect.m_left - 1, 0);
+		patch.m_rect.m_top = std::max(rect.m_top - 1, 0);
+		patch.m_rect.m_right = std::min(rect.m_right + 1, m_gridWidth);
+		patch.m_rect.m_bottom = std::min(rect.m_bottom + 1, m_gridHeight);
+
+		int patchWidth = patch.m_rect.m_right - patch.m_rect.m_left;
+		int patchHeight = patch.m_rect.m_bottom - patch.m_rect.m_top;
+
+		if (patchWidth <= 0 || patchHeight <= 0)
+		{
+			continue;
+		}
+
+		createGridVertices(heightmap, patch.m_rect, start, m_heightScale, patch.m_vertices);
+
+		for (int row = patch.m_rect.m_top; row < patch.m_rect.m_bottom; ++row)
+		{
+			for (int col = patch.m_rect.m_left; col < patch.m_rect.m_right; ++col)
+			{
+				Vertex& vertex = patch.m_vertices[(row - patch.m_rect.m_top) * patchWidth + col - patch.m_rect.m_left];
+				vertex.m_texCoords = m_vertices[row * m_gridWidth + col].m_texCoords;
+				vertex.m_texCoords.y = m_texHeightOffset + heightmap.at(row, col) * m_texHeightScale;
+			}
+		}
+
+		patches.push_back(std::move(patch));
+	}
+
+	return patches;
+}
+
+void Mesh::applyPatches(const std::vector<MeshPatch>& patches)
+{
+	if (!isGrid() || patches.empty())
+	{
+		return;
+	}
+
+	for (const MeshPatch& patch : patches)
+	{
+		int patchWidth = patch.m_rect.m_right - patch.m_rect.m_left;
+
+		for (int row = patch.m_rect.m_top; row < patch.m_rect.m_bottom; ++row)
+		{
+			const Vertex* source = patch.m_vertices.data() + (row - patch.m_rect.m_top) * patchWidth;
+			Vertex* target = m_vertices.data() + row * m_gridWidth + patch.m_rect.m_left;
+
+			std::copy(source, source + patchWidth, target);
+		}
+	}
+
+	refitChunks(patches, m_indices, m_chunks);
+
+	m_bvh.refit(getChunkBoundingBoxes(m_chunks));
+
+	//the chunks cover every vertex of the grid, so their boxes give the box of the mesh, which shrinks again after lowering an edit
+
+	AABB bbox = AABB::getEmpty();
+	for (const MeshChunk& chunk : m_chunks)
+	{
+		bbox.extend(chunk.m_bbox);
+	}
+	m_bbox = bbox;
+}
+
+void Mesh::refitLod(const std::vector<MeshPatch>& patches, MeshLod& lod) const
+{
+	if (!isGrid() || patches.empty())
+	{
+		return;
+	}
+
+	refitChunks(patches, lod.m_indices, lod.m_chunks);
+
+	lod.m_bvh.refit(getChunkBoundingBoxes(lod.m_chunks));
+}
+
+void Mesh::refitChunks(const std::vector<MeshPatch>& patches, const std::vector<int>& indices, std::vector<MeshChunk>& chunks) const
+{
+	//edits only move vertices along y, so the xz-extent of the chunks is still the one they were built with
+
+	for (MeshChunk& chunk : chunks)
+	{
+		bool touched = false;
+
+		for (const MeshPatch& patch : patches)
+		{
+			const glm::vec3& first = m_vertices[patch.m_rect.m_top * m_gridWidth + patch.m_rect.m_left].m_position;
+			const glm::vec3& last = m_vertices[(patch.m_rect.m_bottom - 1) * m_gridWidth + patch.m_rect.m_right - 1].m_position;
+
+			if (first.x <= chunk.m_bbox.m_max.x && last.x >= chunk.m_bbox.m_min.x &&
+				first.z <= chunk.m_bbox.m_max.z && last.z >= chunk.m_bbox.m_min.z)
+			{
+				touched = true;
+				break;
+			}
+		}
+
+		if (touched)
+		{
+			chunk.m_bbox = AABB::getEmpty();
+
+			for (int i = chunk.m_firstIndex; i < chunk.m_firstIndex + chunk.m_indexCount; ++i)
+			{
+				chunk.m_bbox.extend(m_vertices[indices[i]].m_position);
+			}
+		}
+	}
+}
+
 bool Mesh::empty() const
 {
 	return m_vertices.empty();
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 
 #include "AABB.h"
+#include "BoundingVolumeHierarchy.h"
 #include "Heightmap.h"
 
 struct Vertex
@@ -16,11 +17,50 @@ struct Vertex
 
 bool operator==(const Vertex& v1, const Vertex& v2);
 
+struct MeshChunk
+{
+	int m_firstIndex = 0; //!<offset of the chunk's first index in the index buffer
+	int m_indexCount = 0;
+	AABB m_bbox;
+};
+
+/** \brief Vertices of a rectangle of a heightmap mesh that have to be replaced after the heightmap was edited.
+*/
+struct MeshPatch
+{
+	HeightmapRect m_rect; //!<rectangle of grid vertices
+	std::vector<Vertex> m_vertices; //!<rows of the rectangle one after another
+};
+
+/** \brief Coarser triangulation of a heightmap mesh that shares its vertex buffer.
+*/
+struct MeshLod
+{
+	int m_stride = 1; //!<number of heightmap cells covered by one cell of the coarse grid
+	std::vector<int> m_indices;
+	std::vector<MeshChunk> m_chunks; //!<spatially coherent ranges of m_indices
+	BoundingVolumeHierarchy m_bvh; //!<hierarchy over m_chunks
+};
+
+/** \brief Relation between a grid mesh and the heightmap it was created from, needed to patch the mesh after edits.
+*/
+struct MeshGridMapping
+{
+	int m_width = 0; //!<vertices per grid row, 0 if the mesh is not a grid
+	int m_height = 0; //!<vertices per grid column, 0 if the mesh is not a grid
+	float m_heightOffset = 0.0f; //!<y of a grid vertex with height 0
+	float m_heightScale = 1.0f; //!<y units per unit of height of a grid vertex
+	float m_texHeightOffset = 0.0f; //!<texture y of a grid vertex with height 0
+	float m_texHeightScale = 0.0f; //!<texture y per unit of height of a grid vertex
+};
+
 class Mesh 
 {
 
 public:
 
+	static constexpr int TRIANGLES_PER_CHUNK = 8192; //!<target chunk size used for culling, 64x64 heightmap cells
+
 	Mesh() = default;
 
 	explicit Mesh(const Heightmap& heightmap, float texAspectRatio = 1.0f, int texRepeats = 1);
@@ -39,12 +79,37 @@ public:
 	
 	bool set(const Heightmap& heightmap, float texAspectRatio = 1.0f, int texRepeats = 1);
 
+	/** \brief Creates the part of the heightmap's mesh inside a rectangle of grid vertices, placed and lit exactly
+	*          like in the mesh of the whole heightmap. Tiles whose rectangles share an edge of vertices fit without seams.
+	*          The texture coordinates of the whole heightmap are kept as uvs for export.
+	*   \param heightOffset y of a vertex with height 0, from the grid mapping of the whole heightmap's mesh or getDefaultHeightMapping().
+	*   \param heightScale y units per unit of height, from the same source as heightOffset.
+	*/
+	bool set(const Heightmap& heightmap, const HeightmapRect& rect, float heightOffset, float heightScale, float texAspectRatio = 1.0f, int texRepeats = 1);
+
 	bool set(const std::vector<Vertex>& vertices, const std::vector<int>& indices, float texAspectRatio = 1.0f, int texRepeats = 1);
 
+	/** \brief Takes over imported geometry without copying it.
+	*   \param hasNormals True if the vertices carry the normals of the file, otherwise they are computed.
+	*   \param uvs Texture coordinates of the file, one per vertex or none. They are only kept for export,
+	*              rendering projects the material along the axes with the texture coordinates of the vertices.
+	*/
+	bool set(std::vector<Vertex>&& vertices, std::vector<int>&& indices, std::vector<glm::vec2>&& uvs, bool hasNormals, float texAspectRatio = 1.0f, int texRepeats = 1);
+
+	/** \brief Takes over geometry that was prepared before, e.g. read from a MeshCache file.
+	*          Normals, texture coordinates, chunks and the bounding box are used as they are,
+	*          only the bounding volume hierarchy is rebuilt from the chunk boxes.
+	*/
+	bool set(std::vector<Vertex>&& vertices, std::vector<int>&& indices, std::vector<glm::vec2>&& uvs, std::vector<MeshChunk>&& chunks, 
+		const AABB& bbox, const MeshGridMapping& gridMapping);
+
 	static Mesh get(const Heightmap& heightmap, float texAspectRatio = 1.0f, int texRepeats = 1);
 
 	static Mesh get(const std::vector<Vertex>& vertices, const std::vector<int>& indices, float texAspectRatio = 1.0f, int texRepeats = 1);
 
+	//!<y of height 0 and y units per unit of height that set(const Heightmap&) gives the mesh of the heightmap
+	static void getDefaultHeightMapping(const Heightmap& heightmap, float& heightOffset, float& heightScale);
+
 	void setHeight(float height);
 
     void setTexCoords(float texAspectRatio, int texRepeats);
@@ -53,16 +118,98 @@ public:
 
 	const std::vector<int>& getIndices() const;
 
+	//!<texture coordinates read from a model file, empty if the mesh wasn't imported or the file had none
+	const std::vector<glm::vec2>& getUVs() const;
+
 	const AABB& getBoundingBox() const;
 
+	const std::vector<MeshChunk>& getChunks() const;
+
+	const BoundingVolumeHierarchy& getBoundingVolumeHierarchy() const;
+
+	//!<true if the mesh was created from a heightmap and its vertices form a regular grid
+	bool isGrid() const;
+
+	//!<vertices per grid row, 0 if the mesh is not a grid
+	int getGridWidth() const;
+
+	//!<vertices per grid column, 0 if the mesh is not a grid
+	int getGridHeight() const;
+
+	MeshGridMapping getGridMapping() const;
+
+	//!<distance between neighbouring grid vertices in the xz-plane, 0 if the mesh is not a grid
+	float getGridSpacing() const;
+
+	/** \brief Returns the number of indices getLod() produces for the given stride.
+	*/
+	int getLodIndexCount(int stride) const;
+
+	/** \brief Triangulates only every stride-th row and column of the grid (plus the last ones).
+	*   \param stride Number of grid cells merged along each axis, has to be at least 2.
+	*   \param lod Receives the indices, chunks and bounding volume hierarchy of the coarse grid.
+	*   \return False if the mesh is not a grid or the stride is invalid.
+	*/
+	bool getLod(int stride, MeshLod& lod) const;
+
+	/** \brief Recomputes the vertices of a grid mesh inside the modified rectangles of its heightmap.
+	*          Normals depend on the neighbouring heights, so every patch covers its rectangle plus a one vertex halo.
+	*   \param heightmap The heightmap the mesh was created from, after the edit.
+	*   \param rects Modified rectangles of the heightmap.
+	*   \return One patch per rectangle, none if the mesh is not a grid of the heightmap's size.
+	*/
+	std::vector<MeshPatch> createPatches(const Heightmap& heightmap, const std::vector<HeightmapRect>& rects) const;
+
+	/** \brief Replaces the vertices covered by the patches and refits the bounding volumes of the chunks they touch.
+	*          The bounding box of the mesh is recomputed from the chunks, the texture coordinates keep the height mapping they were created with.
+	*/
+	void applyPatches(const std::vector<MeshPatch>& patches);
+
+	//!<refits the chunks of a lod of this mesh that are touched by the patches, after applyPatches()
+	void refitLod(const std::vector<MeshPatch>& patches, MeshLod& lod) const;
+
 	bool empty() const;
 
 private:
 
 	std::vector<Vertex> m_vertices;
 	std::vector<int> m_indices; 
+	std::vector<glm::vec2> m_uvs; //!<one per vertex or none
 	AABB m_bbox;
+	std::vector<MeshChunk> m_chunks; //!<spatially coherent ranges of m_indices
+	BoundingVolumeHierarchy m_bvh; //!<hierarchy over m_chunks
+	int m_gridWidth = 0; //!<vertices per grid row, 0 if the mesh is not a grid
+	int m_gridHeight = 0; //!<vertices per grid column, 0 if the mesh is not a grid
+	float m_heightOffset = 0.0f; //!<y of a grid vertex with height 0
+	float m_heightScale = 1.0f; //!<y units per unit of height of a grid vertex
+	float m_texHeightOffset = 0.0f; //!<texture y of a grid vertex with height 0
+	float m_texHeightScale = 0.0f; //!<texture y per unit of height of a grid vertex
 
 	void computeNormals();
 
+	void buildChunks();
+
+	//!<position of grid vertex (0, 0) at height 0 and y units per unit of height of the mesh of a whole heightmap
+	static void getGridPlacement(int width, int height, float minHeight, float maxHeight, glm::vec3& start, float& heightScale);
+
+	//!<two triangles per cell of a grid of width x height vertices
+	static void createGridIndices(int width, int height, std::vector<int>& indices);
+
+	/** \brief Creates the vertices of a rectangle of a heightmap's grid mesh row by row, without texture coordinates.
+	*          Normals are summed from all cells touching a vertex, also from those outside the rectangle,
+	*          so a vertex on the border of two rectangles gets the same normal from both.
+	*/
+	static void createGridVertices(const Heightmap& heightmap, const HeightmapRect& rect, const glm::vec3& start, float heightScale, std::vector<Vertex>& vertices);
+
+	static void sortIntoChunks(const std::vector<Vertex>& vertices, const AABB& bbox, std::vector<int>& indices, std::vector<MeshChunk>& chunks);
+
+	static void computeChunkBoundingBoxes(const std::vector<Vertex>& vertices, const std::vector<int>& indices, std::vector<MeshChunk>& chunks);
+
+	static std::vector<AABB> getChunkBoundingBoxes(const std::vector<MeshChunk>& chunks);
+
+	static std::vector<int> getLodSamples(int size, int stride);
+
+	//!<recomputes the boxes of the chunks whose xz-extent overlaps one of the patches
+	void refitChunks(const std::vector<MeshPatch>& patches, const std::vector<int>& indices, std::vector<MeshChunk>& chunks) const;
+
 };
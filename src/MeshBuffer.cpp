@@ -0,0 +1,333 @@
+#include "MeshBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+MeshBuffer::~MeshBuffer()
+{
+	cancel();
+
+	if (m_upload.valid())
+	{
+		m_upload.wait();
+	}
+
+	if (m_uploadFence != nullptr)
+	{
+		glDeleteSync(m_uploadFence);
+	}
+
+	if (m_retireFence != nullptr)
+	{
+		glDeleteSync(m_retireFence);
+	}
+
+	if (glIsVertexArray(m_vao))
+	{
+		glDeleteVertexArrays(1, &m_vao);
+	}
+
+	if (glIsVertexArray(m_depthMapVao))
+	{
+		glDeleteVertexArrays(1, &m_depthMapVao);
+	}
+
+	//deleting a buffer also unmaps it
+
+	if (glIsBuffer(m_vbo))
+	{
+		glDeleteBuffers(1, &m_vbo);
+	}
+
+	if (glIsBuffer(m_ebo))
+	{
+		glDeleteBuffers(1, &m_ebo);
+	}
+
+	if (glIsBuffer(m_depthMapEbo))
+	{
+		glDeleteBuffers(1, &m_depthMapEbo);
+	}
+}
+
+bool MeshBuffer::create(std::shared_ptr<const Mesh> mesh, int depthMapStride, const ShaderProgram& terrainProgram, const ShaderProgram& depthMapProgram)
+{
+	if (mesh == nullptr || mesh->empty() || !terrainProgram.isLinked() || !depthMapProgram.isLinked())
+	{
+		return false;
+	}
+
+	m_mesh = std::move(mesh);
+
+	//the size of the coarse index buffer is known up front, the indices themselves are generated by the worker
+
+	int depthMapIndexCount = m_mesh->getLodIndexCount(depthMapStride);
+	bool hasDepthMapLod = depthMapIndexCount > 0;
+
+	GLsizeiptr verticesSize = m_mesh->getVertices().size() * sizeof(Vertex);
+	GLsizeiptr indicesSize = m_mesh->getIndices().size() * sizeof(int);
+	GLsizeiptr depthMapIndicesSize = depthMapIndexCount * sizeof(int);
+
+	glCreateBuffers(1, &m_vbo);
+	glCreateBuffers(1, &m_ebo);
+
+	if (hasDepthMapLod)
+	{
+		glCreateBuffers(1, &m_depthMapEbo);
+	}
+
+	if (GLEW_ARB_buffer_storage)
+	{
+		GLbitfield storageFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_DYNAMIC_STORAGE_BIT;
+		GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glNamedBufferStorage(m_vbo, verticesSize, nullptr, storageFlags);
+		glNamedBufferStorage(m_ebo, indicesSize, nullptr, storageFlags);
+		m_mappedVertices = glMapNamedBufferRange(m_vbo, 0, verticesSize, mapFlags);
+		m_mappedIndices = glMapNamedBufferRange(m_ebo, 0, indicesSize, mapFlags);
+
+		if (hasDepthMapLod)
+		{
+			glNamedBufferStorage(m_depthMapEbo, depthMapIndicesSize, nullptr, storageFlags);
+			m_mappedDepthMapIndices = glMapNamedBufferRange(m_depthMapEbo, 0, depthMapIndicesSize, mapFlags);
+		}
+	}
+
+	if (m_mappedVertices != nullptr && m_mappedIndices != nullptr && (!hasDepthMapLod || m_mappedDepthMapIndices != nullptr))
+	{
+		std::shared_ptr<const Mesh> uploadedMesh = m_mesh;
+		void* mappedVertices = m_mappedVertices;
+		void* mappedIndices = m_mappedIndices;
+		void* mappedDepthMapIndices = m_mappedDepthMapIndices;
+		MeshLod* depthMapLod = &m_depthMapLod;
+		const std::atomic<bool>& cancelled = m_cancelled;
+
+		m_upload = std::async(std::launch::async, [uploadedMesh, depthMapStride, mappedVertices, mappedIndices, mappedDepthMapIndices, depthMapLod, &cancelled]()
+		{
+			copyBlocks(mappedVertices, uploadedMesh->getVertices().data(), uploadedMesh->getVertices().size() * sizeof(Vertex), cancelled);
+			copyBlocks(mappedIndices, uploadedMesh->getIndices().data(), uploadedMesh->getIndices().size() * sizeof(int), cancelled);
+
+			if (mappedDepthMapIndices != nullptr && cancelled == false && uploadedMesh->getLod(depthMapStride, *depthMapLod))
+			{
+				copyBlocks(mappedDepthMapIndices, depthMapLod->m_indices.data(), depthMapLod->m_indices.size() * sizeof(int), cancelled);
+			}
+		});
+	}
+	else
+	{
+		//no persistent mapping, upload synchronously
+
+		if (glIsBuffer(m_vbo))
+		{
+			glDeleteBuffers(1, &m_vbo);
+		}
+
+		if (glIsBuffer(m_ebo))
+		{
+			glDeleteBuffers(1, &m_ebo);
+		}
+
+		if (glIsBuffer(m_depthMapEbo))
+		{
+			glDeleteBuffers(1, &m_depthMapEbo);
+		}
+
+		m_mappedVertices = nullptr;
+		m_mappedIndices = nullptr;
+		m_mappedDepthMapIndices = nullptr;
+
+		glCreateBuffers(1, &m_vbo);
+		glCreateBuffers(1, &m_ebo);
+		glNamedBufferData(m_vbo, verticesSize, m_mesh->getVertices().data(), GL_STATIC_DRAW);
+		glNamedBufferData(m_ebo, indicesSize, m_mesh->getIndices().data(), GL_STATIC_DRAW);
+
+		if (hasDepthMapLod && m_mesh->getLod(depthMapStride, m_depthMapLod))
+		{
+			glCreateBuffers(1, &m_depthMapEbo);
+			glNamedBufferData(m_depthMapEbo, depthMapIndicesSize, m_depthMapLod.m_indices.data(), GL_STATIC_DRAW);
+		}
+		else
+		{
+			m_depthMapEbo = 0;
+		}
+	}
+
+	glGenVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+	terrainProgram.setVertexAttribPointer("position", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_position)));
+	terrainProgram.setVertexAttribPointer("texCoords", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_texCoords)));
+	terrainProgram.setVertexAttribPointer("normal", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_normal)));
+
+	depthMapProgram.setVertexAttribPointer("position", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_position)));
+	depthMapProgram.setVertexAttribPointer("normal", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_normal)));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+
+	if (m_depthMapEbo != 0)
+	{
+		//shares the vertex buffer, only the index buffer differs
+
+		glGenVertexArrays(1, &m_depthMapVao);
+		glBindVertexArray(m_depthMapVao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+		depthMapProgram.setVertexAttribPointer("position", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_position)));
+		depthMapProgram.setVertexAttribPointer("normal", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_normal)));
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_depthMapEbo);
+	}
+
+	glBindVertexArray(0);
+
+	return true;
+}
+
+bool MeshBuffer::isResident()
+{
+	if (m_resident == true)
+	{
+		return true;
+	}
+
+	if (m_cancelled == true || !glIsVertexArray(m_vao))
+	{
+		return false;
+	}
+
+	if (m_upload.valid())
+	{
+		if (m_upload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return false;
+		}
+
+		m_upload.get();
+
+		//writes through a coherent mapping are visible to the GPU once a fence is issued after them
+		m_uploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+
+	if (m_uploadFence != nullptr)
+	{
+		if (!isSignaled(m_uploadFence))
+		{
+			return false;
+		}
+
+		glDeleteSync(m_uploadFence);
+		m_uploadFence = nullptr;
+	}
+
+	m_resident = true;
+
+	return true;
+}
+
+bool MeshBuffer::updateVertices(std::shared_ptr<const Mesh> mesh, const std::vector<MeshPatch>& patches)
+{
+	if (mesh == nullptr || !m_resident || !mesh->isGrid() ||
+		mesh->getGridWidth() != m_mesh->getGridWidth() || mesh->getGridHeight() != m_mesh->getGridHeight())
+	{
+		return false;
+	}
+
+	m_mesh = std::move(mesh);
+
+	//each row of a patch is contiguous in the vertex buffer, the GL orders the writes after the draws already issued
+
+	int gridWidth = m_mesh->getGridWidth();
+
+	for (const MeshPatch& patch : patches)
+	{
+		int patchWidth = patch.m_rect.m_right - patch.m_rect.m_left;
+
+		for (int row = patch.m_rect.m_top; row < patch.m_rect.m_bottom; ++row)
+		{
+			GLintptr offset = (static_cast<GLintptr>(row) * gridWidth + patch.m_rect.m_left) * sizeof(Vertex);
+			const Vertex* vertices = patch.m_vertices.data() + (row - patch.m_rect.m_top) * patchWidth;
+
+			glNamedBufferSubData(m_vbo, offset, patchWidth * sizeof(Vertex), vertices);
+		}
+	}
+
+	if (m_depthMapVao != 0)
+	{
+		m_mesh->refitLod(patches, m_depthMapLod);
+	}
+
+	return true;
+}
+
+void MeshBuffer::cancel()
+{
+	m_cancelled = true;
+}
+
+void MeshBuffer::retire()
+{
+	cancel();
+
+	if (m_retireFence == nullptr)
+	{
+		m_retireFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+bool MeshBuffer::isReleasable()
+{
+	if (m_upload.valid() && m_upload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	return m_retireFence == nullptr || isSignaled(m_retireFence);
+}
+
+GLuint MeshBuffer::getVAO() const
+{
+	return m_vao;
+}
+
+GLuint MeshBuffer::getDepthMapVAO() const
+{
+	return m_depthMapVao != 0 ? m_depthMapVao : m_vao;
+}
+
+const Mesh& MeshBuffer::getMesh() const
+{
+	return *m_mesh;
+}
+
+const std::vector<MeshChunk>& MeshBuffer::getDepthMapChunks() const
+{
+	return m_depthMapVao != 0 ? m_depthMapLod.m_chunks : m_mesh->getChunks();
+}
+
+const BoundingVolumeHierarchy& MeshBuffer::getDepthMapBoundingVolumeHierarchy() const
+{
+	return m_depthMapVao != 0 ? m_depthMapLod.m_bvh : m_mesh->getBoundingVolumeHierarchy();
+}
+
+void MeshBuffer::copyBlocks(void* destination, const void* source, size_t size, const std::atomic<bool>& cancelled)
+{
+	char* dst = static_cast<char*>(destination);
+	const char* src = static_cast<const char*>(source);
+
+	for (size_t offset = 0; offset < size && cancelled == false; offset += UPLOAD_BLOCK_SIZE)
+	{
+		std::memcpy(dst + offset, src + offset, std::min(UPLOAD_BLOCK_SIZE, size - offset));
+	}
+}
+
+bool MeshBuffer::isSignaled(GLsync fence)
+{
+	GLenum status = glClientWaitSync(fence, 0, 0);
+
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "Mesh.h"
+#include "ShaderProgram.h"
+
+/** \brief GPU copy of a mesh (VAO, vertex and index buffer).
+*          When ARB_buffer_storage is available the buffers are persistently mapped and filled
+*          chunk by chunk on a worker thread, so the GL thread never blocks on the upload.
+*          Otherwise the data is uploaded synchronously with glNamedBufferData.
+*          Heightmap meshes can get a second, coarser index buffer for the depth map pass.
+*/
+class MeshBuffer
+{
+
+public:
+
+	static constexpr size_t UPLOAD_BLOCK_SIZE = 4 * 1024 * 1024; //!<bytes copied by the worker between cancellation checks
+
+	MeshBuffer() = default;
+
+	MeshBuffer(const MeshBuffer& other) = delete;
+
+	MeshBuffer(MeshBuffer&& other) = delete;
+
+	MeshBuffer& operator=(const MeshBuffer& other) = delete;
+
+	MeshBuffer& operator=(MeshBuffer&& other) = delete;
+
+	~MeshBuffer();
+
+	/** \brief Creates the GL objects and starts filling them. Has to be called on the GL thread.
+	*   \param mesh Mesh to upload, kept alive until the buffer is destroyed.
+	*   \param depthMapStride Grid cells merged by the depth map geometry, values below 2 or non-grid meshes use the full mesh.
+	*   \param terrainProgram Program whose vertex attributes are bound to the VAO.
+	*   \param depthMapProgram Program whose vertex attributes are bound to the VAO.
+	*   \return False if the mesh is empty or the programs are not linked.
+	*/
+	bool create(std::shared_ptr<const Mesh> mesh, int depthMapStride, const ShaderProgram& terrainProgram, const ShaderProgram& depthMapProgram);
+
+	/** \brief Checks without blocking whether the upload has finished and the GPU can see the data.
+	*          Has to be called on the GL thread.
+	*/
+	bool isResident();
+
+	/** \brief Uploads only the vertices covered by the patches with glNamedBufferSubData. Has to be called on the GL thread.
+	*   \param mesh The mesh of this buffer with the patches already applied, replaces the one being drawn.
+	*   \return False if the buffer isn't resident yet or the mesh doesn't have the same vertices, it has to be recreated then.
+	*/
+	bool updateVertices(std::shared_ptr<const Mesh> mesh, const std::vector<MeshPatch>& patches);
+
+	//!<stops the worker at the next block boundary, the buffer will never become resident
+	void cancel();
+
+	//!<marks the buffer as no longer used by new draw calls, must be followed by isReleasable() checks
+	void retire();
+
+	//!<true once the GPU has finished all draw calls issued before retire()
+	bool isReleasable();
+
+	GLuint getVAO() const;
+
+	//!<VAO with the coarse index buffer if there is one, otherwise the same as getVAO()
+	GLuint getDepthMapVAO() const;
+
+	const Mesh& getMesh() const;
+
+	//!<chunks of the geometry drawn into the depth map, indices into the buffer bound to getDepthMapVAO()
+	const std::vector<MeshChunk>& getDepthMapChunks() const;
+
+	const BoundingVolumeHierarchy& getDepthMapBoundingVolumeHierarchy() const;
+
+private:
+
+	std::shared_ptr<const Mesh> m_mesh;
+	GLuint m_vao = 0;
+	GLuint m_vbo = 0;
+	GLuint m_ebo = 0;
+	GLuint m_depthMapVao = 0;
+	GLuint m_depthMapEbo = 0;
+	MeshLod m_depthMapLod; //!<written by the worker, only read once the buffer is resident
+	void* m_mappedVertices = nullptr;
+	void* m_mappedIndices = nullptr;
+	void* m_mappedDepthMapIndices = nullptr;
+	std::future<void> m_upload;
+	std::atomic<bool> m_cancelled{ false };
+	GLsync m_uploadFence = nullptr; //!<signaled when the GPU has seen all writes of the worker
+	GLsync m_retireFence = nullptr; //!<signaled when the GPU has finished the last draw using this buffer
+	bool m_resident = false;
+
+	static void copyBlocks(void* destination, const void* source, size_t size, const std::atomic<bool>& cancelled);
+
+	static bool isSignaled(GLsync fence);
+};
@@ -0,0 +1,376 @@
+#include "MeshCache.h"
+
+#include <QSaveFile>
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Parallel.h"
+
+static_assert(std::is_trivially_copyable<Vertex>::value && std::is_trivially_copyable<MeshChunk>::value,
+	"the blocks of a mesh cache are raw copies of the mesh's arrays");
+
+const char* const MeshCache::FORMAT_ID = "tgmesh";
+
+bool MeshCache::save(const Mesh& mesh, const std::string& filename, bool checksums)
+{
+	if (mesh.empty())
+	{
+		return false;
+	}
+
+	const std::vector<Vertex>& vertices = mesh.getVertices();
+	const std::vector<int>& indices = mesh.getIndices();
+	const std::vector<glm::vec2>& uvs = mesh.getUVs();
+	const std::vector<MeshChunk>& chunks = mesh.getChunks();
+	const AABB& bbox = mesh.getBoundingBox();
+	MeshGridMapping gridMapping = mesh.getGridMapping();
+
+	Header header;
+	header.m_flags = checksums ? CHECKSUM_FLAG : 0;
+	header.m_vertexCount = vertices.size();
+	header.m_indexCount = indices.size();
+	header.m_uvCount = uvs.size();
+	header.m_chunkCount = chunks.size();
+	header.m_gridWidth = gridMapping.m_width;
+	header.m_gridHeight = gridMapping.m_height;
+	header.m_heightOffset = gridMapping.m_heightOffset;
+	header.m_heightScale = gridMapping.m_heightScale;
+	header.m_texHeightOffset = gridMapping.m_texHeightOffset;
+	header.m_texHeightScale = gridMapping.m_texHeightScale;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		header.m_bboxMin[i] = bbox.m_min[i];
+		header.m_bboxMax[i] = bbox.m_max[i];
+	}
+
+	const void* blockData[BLOCK_COUNT] = { vertices.data(), indices.data(), uvs.data(), chunks.data() };
+	header.m_blocks[VERTEX_BLOCK].m_size = vertices.size() * sizeof(Vertex);
+	header.m_blocks[INDEX_BLOCK].m_size = indices.size() * sizeof(int);
+	header.m_blocks[UV_BLOCK].m_size = uvs.size() * sizeof(glm::vec2);
+	header.m_blocks[CHUNK_BLOCK].m_size = chunks.size() * sizeof(MeshChunk);
+
+	uint64_t offset = alignOffset(sizeof(Header));
+
+	for (Block& block : header.m_blocks)
+	{
+		block.m_offset = offset;
+		offset = alignOffset(offset + block.m_size);
+	}
+
+	if (checksums)
+	{
+		for (int i = 0; i < BLOCK_COUNT; ++i)
+		{
+			header.m_blocks[i].m_checksum = computeChecksum(blockData[i], header.m_blocks[i].m_size);
+		}
+	}
+
+	QSaveFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	const std::vector<char> padding(BLOCK_ALIGNMENT, 0);
+	bool written = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+	uint64_t position = sizeof(header);
+
+	for (int i = 0; i < BLOCK_COUNT && written; ++i)
+	{
+		const Block& block = header.m_blocks[i];
+
+		qint64 paddingSize = static_cast<qint64>(block.m_offset - position);
+		qint64 blockSize = static_cast<qint64>(block.m_size);
+
+		written = file.write(padding.data(), paddingSize) == paddingSize &&
+			(blockSize == 0 || file.write(static_cast<const char*>(blockData[i]), blockSize) == blockSize);
+
+		position = block.m_offset + block.m_size;
+	}
+
+	if (!written)
+	{
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+std::shared_ptr<const MappedMesh> MeshCache::map(const std::string& filename, bool verifyChecksums)
+{
+	std::shared_ptr<MappedMesh> mappedMesh = std::make_shared<MappedMesh>();
+
+	if (!mappedMesh->open(filename) || (verifyChecksums && !verify(*mappedMesh)))
+	{
+		return nullptr;
+	}
+
+	return mappedMesh;
+}
+
+bool MeshCache::load(const std::string& filename, Mesh& mesh, bool verifyChecksums)
+{
+	std::shared_ptr<const MappedMesh> mappedMesh = map(filename, verifyChecksums);
+
+	if (mappedMesh == nullptr)
+	{
+		return false;
+	}
+
+	const Header& header = mappedMesh->getHeader();
+
+	//the blocks already have the layout of the arrays, so they are copied as a whole
+
+	std::vector<Vertex> vertices(mappedMesh->getVertices(), mappedMesh->getVertices() + mappedMesh->getVertexCount());
+	std::vector<int> indices(mappedMesh->getIndices(), mappedMesh->getIndices() + mappedMesh->getIndexCount());
+	std::vector<glm::vec2> uvs(mappedMesh->getUVs(), mappedMesh->getUVs() + mappedMesh->getUVCount());
+	std::vector<MeshChunk> chunks(mappedMesh->getChunks(), mappedMesh->getChunks() + mappedMesh->getChunkCount());
+
+	AABB bbox(glm::vec3(header.m_bboxMin[0], header.m_bboxMin[1], header.m_bboxMin[2]),
+		glm::vec3(header.m_bboxMax[0], header.m_bboxMax[1], header.m_bboxMax[2]));
+
+	MeshGridMapping gridMapping;
+	gridMapping.m_width = header.m_gridWidth;
+	gridMapping.m_height = header.m_gridHeight;
+	gridMapping.m_heightOffset = header.m_heightOffset;
+	gridMapping.m_heightScale = header.m_heightScale;
+	gridMapping.m_texHeightOffset = header.m_texHeightOffset;
+	gridMapping.m_texHeightScale = header.m_texHeightScale;
+
+	return mesh.set(std::move(vertices), std::move(indices), std::move(uvs), std::move(chunks), bbox, gridMapping);
+}
+
+bool MeshCache::verify(const MappedMesh& mappedMesh)
+{
+	const Header& header = mappedMesh.getHeader();
+
+	if ((header.m_flags & CHECKSUM_FLAG) == 0)
+	{
+		return true;
+	}
+
+	for (int i = 0; i < BLOCK_COUNT; ++i)
+	{
+		if (computeChecksum(mappedMesh.getBlock(i), header.m_blocks[i].m_size) != header.m_blocks[i].m_checksum)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint64_t MeshCache::computeChecksum(const void* data, size_t size)
+{
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+
+	//FNV-1a over 64 bit words, the multiplication only carries upwards, so the high half is folded back in every step
+
+	auto hashWords = [FNV_OFFSET_BASIS, FNV_PRIME](const unsigned char* bytes, size_t size)
+	{
+		uint64_t hash = FNV_OFFSET_BASIS;
+		size_t wordCount = size / sizeof(uint64_t);
+
+		for (size_t i = 0; i < wordCount; ++i)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(word));
+			hash = (hash ^ word) * FNV_PRIME;
+			hash ^= hash >> 32;
+		}
+
+		for (size_t i = wordCount * sizeof(uint64_t); i < size; ++i)
+		{
+			hash = (hash ^ bytes[i]) * FNV_PRIME;
+		}
+
+		return hash;
+	};
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	int partCount = static_cast<int>((size + CHECKSUM_BLOCK_SIZE - 1) / CHECKSUM_BLOCK_SIZE);
+	std::vector<uint64_t> partHashes(partCount);
+
+	Parallel::forRange(partCount, [bytes, size, &partHashes, &hashWords](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			size_t partOffset = static_cast<size_t>(i) * CHECKSUM_BLOCK_SIZE;
+			size_t partSize = std::min(size - partOffset, static_cast<size_t>(CHECKSUM_BLOCK_SIZE));
+			partHashes[i] = hashWords(bytes + partOffset, partSize);
+		}
+	});
+
+	return hashWords(reinterpret_cast<const unsigned char*>(partHashes.data()), partHashes.size() * sizeof(uint64_t));
+}
+
+uint64_t MeshCache::alignOffset(uint64_t offset)
+{
+	return (offset + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+}
+
+bool MappedMesh::open(const std::string& filename)
+{
+	m_file.setFileName(QString::fromStdString(filename));
+	if (!m_file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	m_size = m_file.size();
+	if (m_size < static_cast<qint64>(sizeof(MeshCache::Header)))
+	{
+		return false;
+	}
+
+	m_data = m_file.map(0, m_size);
+	if (m_data == nullptr)
+	{
+		return false;
+	}
+
+	std::memcpy(&m_header, m_data, sizeof(m_header));
+
+	if (m_header.m_magic != MeshCache::MAGIC || m_header.m_version != MeshCache::VERSION ||
+		m_header.m_vertexSize != sizeof(Vertex) || m_header.m_chunkSize != sizeof(MeshChunk))
+	{
+		return false;
+	}
+
+	//the counts are checked against the file size first, so the block sizes can't overflow
+
+	uint64_t fileSize = static_cast<uint64_t>(m_size);
+	const MeshCache::Block* blocks = m_header.m_blocks;
+
+	if (m_header.m_vertexCount == 0 || m_header.m_indexCount == 0 || m_header.m_indexCount % 3 != 0 || m_header.m_chunkCount == 0 ||
+		m_header.m_vertexCount > fileSize / sizeof(Vertex) || m_header.m_indexCount > fileSize / sizeof(int) ||
+		m_header.m_chunkCount > fileSize / sizeof(MeshChunk) ||
+		(m_header.m_uvCount != 0 && m_header.m_uvCount != m_header.m_vertexCount) ||
+		blocks[MeshCache::VERTEX_BLOCK].m_size != m_header.m_vertexCount * sizeof(Vertex) ||
+		blocks[MeshCache::INDEX_BLOCK].m_size != m_header.m_indexCount * sizeof(int) ||
+		blocks[MeshCache::UV_BLOCK].m_size != m_header.m_uvCount * sizeof(glm::vec2) ||
+		blocks[MeshCache::CHUNK_BLOCK].m_size != m_header.m_chunkCount * sizeof(MeshChunk))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < MeshCache::BLOCK_COUNT; ++i)
+	{
+		if (blocks[i].m_offset % MeshCache::BLOCK_ALIGNMENT != 0 || blocks[i].m_offset > fileSize ||
+			blocks[i].m_size > fileSize - blocks[i].m_offset)
+		{
+			return false;
+		}
+	}
+
+	//draw calls are issued per chunk, so a chunk reaching past the indices would make the GPU read out of bounds,
+	//and chunks are drawn as triangle ranges, so like the whole index block they have to hold whole triangles
+
+	const MeshChunk* chunks = getChunks();
+
+	for (size_t i = 0; i < getChunkCount(); ++i)
+	{
+		if (chunks[i].m_firstIndex < 0 || chunks[i].m_indexCount < 0 || chunks[i].m_firstIndex % 3 != 0 || chunks[i].m_indexCount % 3 != 0 ||
+			static_cast<uint64_t>(chunks[i].m_firstIndex) + chunks[i].m_indexCount > m_header.m_indexCount)
+		{
+			return false;
+		}
+	}
+
+	//the indices are used to address the vertices, by the GPU as well as when the normals are recomputed
+
+	return indicesInRange(getIndices(), getIndexCount(), getVertexCount());
+}
+
+bool MappedMesh::indicesInRange(const int* indices, size_t indexCount, size_t vertexCount)
+{
+	const int indicesPerPart = static_cast<int>(MeshCache::CHECKSUM_BLOCK_SIZE / sizeof(int));
+	int partCount = static_cast<int>((indexCount + indicesPerPart - 1) / indicesPerPart);
+	std::atomic<bool> inRange{ true };
+
+	Parallel::forRange(partCount, [indices, indexCount, vertexCount, indicesPerPart, &inRange](int begin, int end)
+	{
+		for (int i = begin; i < end && inRange; ++i)
+		{
+			size_t first = static_cast<size_t>(i) * indicesPerPart;
+			size_t last = std::min(first + indicesPerPart, indexCount);
+			bool partInRange = true;
+
+			for (size_t j = first; j < last; ++j)
+			{
+				partInRange &= indices[j] >= 0 && static_cast<uint64_t>(indices[j]) < vertexCount;
+			}
+
+			if (!partInRange)
+			{
+				inRange = false;
+			}
+		}
+	});
+
+	return inRange;
+}
+
+const MeshCache::Header& MappedMesh::getHeader() const
+{
+	return m_header;
+}
+
+const void* MappedMesh::getBlock(int block) const
+{
+	if (m_data == nullptr || m_header.m_blocks[block].m_size == 0)
+	{
+		return nullptr;
+	}
+
+	return m_data + m_header.m_blocks[block].m_offset;
+}
+
+const Vertex* MappedMesh::getVertices() const
+{
+	return static_cast<const Vertex*>(getBlock(MeshCache::VERTEX_BLOCK));
+}
+
+const int* MappedMesh::getIndices() const
+{
+	return static_cast<const int*>(getBlock(MeshCache::INDEX_BLOCK));
+}
+
+const glm::vec2* MappedMesh::getUVs() const
+{
+	return static_cast<const glm::vec2*>(getBlock(MeshCache::UV_BLOCK));
+}
+
+const MeshChunk* MappedMesh::getChunks() const
+{
+	return static_cast<const MeshChunk*>(getBlock(MeshCache::CHUNK_BLOCK));
+}
+
+size_t MappedMesh::getVertexCount() const
+{
+	return static_cast<size_t>(m_header.m_vertexCount);
+}
+
+size_t MappedMesh::getIndexCount() const
+{
+	return static_cast<size_t>(m_header.m_indexCount);
+}
+
+size_t MappedMesh::getUVCount() const
+{
+	return static_cast<size_t>(m_header.m_uvCount);
+}
+
+size_t MappedMesh::getChunkCount() const
+{
+	return static_cast<size_t>(m_header.m_chunkCount);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <QFile>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Mesh.h"
+
+class MappedMesh;
+
+/** \brief Versioned binary container of a Mesh that is read back by mapping the file and copying its blocks.
+*          A header with the counts, the bounding box and the grid mapping is followed by the vertex, index,
+*          uv and chunk blocks. They hold the in-memory layout of the mesh, each starts at a page boundary
+*          and can be protected by a checksum. Files are only valid on machines with the writer's endianness and struct layout.
+*/
+class MeshCache
+{
+
+public:
+
+	static constexpr uint32_t MAGIC = 0x4853454d; //!<"MESH" in a little endian file
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint32_t CHECKSUM_FLAG = 1; //!<the blocks carry checksums
+	static constexpr size_t BLOCK_ALIGNMENT = 4096; //!<blocks start at page boundaries of the mapping
+	static constexpr size_t CHECKSUM_BLOCK_SIZE = 1024 * 1024; //!<bytes hashed by one task, the checksums of a block's parts are hashed again
+
+	static constexpr int VERTEX_BLOCK = 0;
+	static constexpr int INDEX_BLOCK = 1;
+	static constexpr int UV_BLOCK = 2;
+	static constexpr int CHUNK_BLOCK = 3;
+	static constexpr int BLOCK_COUNT = 4;
+
+	static const char* const FORMAT_ID; //!<export format id and file extension, "tgmesh"
+
+	struct Block
+	{
+		uint64_t m_offset = 0; //!<from the start of the file, a multiple of BLOCK_ALIGNMENT
+		uint64_t m_size = 0; //!<in bytes, without the padding up to the next block
+		uint64_t m_checksum = 0; //!<0 unless the file has the CHECKSUM_FLAG
+	};
+
+	struct Header
+	{
+		uint32_t m_magic = MAGIC;
+		uint32_t m_version = VERSION;
+		uint32_t m_flags = 0;
+		uint32_t m_vertexSize = sizeof(Vertex); //!<the blocks are only usable with the same struct layout
+		uint32_t m_chunkSize = sizeof(MeshChunk);
+		uint32_t m_reserved = 0;
+		uint64_t m_vertexCount = 0;
+		uint64_t m_indexCount = 0;
+		uint64_t m_uvCount = 0;
+		uint64_t m_chunkCount = 0;
+		int32_t m_gridWidth = 0;
+		int32_t m_gridHeight = 0;
+		float m_heightOffset = 0.0f;
+		float m_heightScale = 1.0f;
+		float m_texHeightOffset = 0.0f;
+		float m_texHeightScale = 0.0f;
+		float m_bboxMin[3] = { 0.0f, 0.0f, 0.0f };
+		float m_bboxMax[3] = { 0.0f, 0.0f, 0.0f };
+		Block m_blocks[BLOCK_COUNT];
+	};
+
+	/** \brief Writes the mesh under a temporary name that only replaces the target once it is complete.
+	*   \param checksums Stores a checksum per block, costs one more pass over the data.
+	*/
+	static bool save(const Mesh& mesh, const std::string& filename, bool checksums = true);
+
+	/** \brief Maps a file written by save() without copying or converting anything.
+	*   \param verifyChecksums Compares the checksums if the file has any, which reads every page once.
+	*   \return Null if the file can't be mapped, is truncated, has another version or layout, or a checksum doesn't match.
+	*/
+	static std::shared_ptr<const MappedMesh> map(const std::string& filename, bool verifyChecksums = true);
+
+	/** \brief Maps the file and copies its blocks into the arrays of the mesh, which also rebuilds the bounding volume hierarchy.
+	*          Normals, chunks and the bounding box are taken as stored. The mapping is released once the copy is done.
+	*/
+	static bool load(const std::string& filename, Mesh& mesh, bool verifyChecksums = true);
+
+	//!<true if every block checksum of the file matches, also for files without checksums
+	static bool verify(const MappedMesh& mappedMesh);
+
+private:
+
+	static uint64_t computeChecksum(const void* data, size_t size);
+
+	static uint64_t alignOffset(uint64_t offset);
+};
+
+/** \brief Read-only mapping of a MeshCache file. The blocks stay valid as long as the object exists.
+*/
+class MappedMesh
+{
+
+public:
+
+	MappedMesh() = default;
+
+	MappedMesh(const MappedMesh& other) = delete;
+
+	MappedMesh(MappedMesh&& other) = delete;
+
+	MappedMesh& operator=(const MappedMesh& other) = delete;
+
+	MappedMesh& operator=(MappedMesh&& other) = delete;
+
+	~MappedMesh() = default;
+
+	/** \brief Maps the file and checks the header, the bounds of the blocks, that the indices and chunks hold whole triangles
+	*          and that every index refers to a vertex.
+	*   \return False if the file isn't a MeshCache file this build can use.
+	*/
+	bool open(const std::string& filename);
+
+	const MeshCache::Header& getHeader() const;
+
+	//!<start of a block in the mapping, null if the block is empty
+	const void* getBlock(int block) const;
+
+	const Vertex* getVertices() const;
+
+	const int* getIndices() const;
+
+	const glm::vec2* getUVs() const;
+
+	const MeshChunk* getChunks() const;
+
+	size_t getVertexCount() const;
+
+	size_t getIndexCount() const;
+
+	size_t getUVCount() const;
+
+	size_t getChunkCount() const;
+
+private:
+
+	//!<true if every index is in [0, vertexCount), scanned in parallel parts
+	static bool indicesInRange(const int* indices, size_t indexCount, size_t vertexCount);
+
+	QFile m_file;
+	const uchar* m_data = nullptr; //!<unmapped when m_file is destroyed
+	qint64 m_size = 0;
+	MeshCache::Header m_header;
+};
@@ -0,0 +1,372 @@
+#include "MeshWriter.h"
+
+#include <QString>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Parallel.h"
+
+bool MeshWriter::isSupported(const std::string& formatId)
+{
+	return formatId == "stlb" || formatId == "plyb" || formatId == "obj" || formatId == "objnomtl";
+}
+
+bool MeshWriter::save(const Mesh& mesh, const std::string& filename, const std::string& formatId)
+{
+	if (mesh.empty() || !isSupported(formatId))
+	{
+		return false;
+	}
+
+	QSaveFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	WriteBuffer buffer(file);
+	bool written = false;
+
+	if (formatId == "stlb")
+	{
+		written = writeBinarySTL(mesh, buffer);
+	}
+	else if (formatId == "plyb")
+	{
+		written = writeBinaryPLY(mesh, buffer);
+	}
+	else
+	{
+		written = writeOBJ(mesh, buffer);
+	}
+
+	if (!written || !buffer.flush())
+	{
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+MeshWriter::WriteBuffer::WriteBuffer(QSaveFile& file)
+	: m_file(file)
+	, m_buffer(WRITE_BUFFER_SIZE)
+{
+
+}
+
+void MeshWriter::WriteBuffer::write(const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+
+	while (size > 0)
+	{
+		if (m_size == m_buffer.size())
+		{
+			flush();
+		}
+
+		size_t count = std::min(size, m_buffer.size() - m_size);
+		std::memcpy(m_buffer.data() + m_size, bytes, count);
+
+		m_size += count;
+		bytes += count;
+		size -= count;
+	}
+}
+
+void MeshWriter::WriteBuffer::write(const std::string& text)
+{
+	write(text.data(), text.size());
+}
+
+bool MeshWriter::WriteBuffer::flush()
+{
+	if (m_size > 0 && !m_failed)
+	{
+		m_failed = m_file.write(m_buffer.data(), m_size) != static_cast<qint64>(m_size);
+	}
+
+	m_size = 0;
+
+	return !m_failed;
+}
+
+bool MeshWriter::writeBinarySTL(const Mesh& mesh, WriteBuffer& buffer)
+{
+	const std::vector<Vertex>& vertices = mesh.getVertices();
+	const std::vector<int>& indices = mesh.getIndices();
+
+	//binary STL is little endian, which is the byte order of all platforms the application is built for
+
+	char header[STL_HEADER_SIZE] = {};
+	std::strncpy(header, "Binary STL exported by Terrain Generator", STL_HEADER_SIZE - 1);
+	buffer.write(header, sizeof(header));
+
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	buffer.writeValue(triangleCount);
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const glm::vec3& a = vertices[indices[i]].m_position;
+		const glm::vec3& b = vertices[indices[i + 1]].m_position;
+		const glm::vec3& c = vertices[indices[i + 2]].m_position;
+
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float length = glm::length(normal);
+		if (length > 0.0f)
+		{
+			normal = normal / length;
+		}
+
+		float record[12] = {
+			normal.x, normal.y, normal.z,
+			a.x, a.y, a.z,
+			b.x, b.y, b.z,
+			c.x, c.y, c.z
+		};
+
+		buffer.write(record, sizeof(record));
+		buffer.writeValue(static_cast<uint16_t>(0)); //attribute byte count
+	}
+
+	return true;
+}
+
+bool MeshWriter::writeBinaryPLY(const Mesh& mesh, WriteBuffer& buffer)
+{
+	const std::vector<Vertex>& vertices = mesh.getVertices();
+	const std::vector<int>& indices = mesh.getIndices();
+	const std::vector<glm::vec2>& uvs = mesh.getUVs();
+
+	std::string header =
+		"ply\n"
+		"format binary_little_endian 1.0\n"
+		"comment exported by Terrain Generator\n"
+		"element vertex " + std::to_string(vertices.size()) + "\n"
+		"property float x\n"
+		"property float y\n"
+		"property float z\n"
+		"property float nx\n"
+		"property float ny\n"
+		"property float nz\n" +
+		std::string(uvs.empty() ? "" : "property float s\nproperty float t\n") +
+		"element face " + std::to_string(indices.size() / 3) + "\n"
+		"property list uchar int vertex_indices\n"
+		"end_header\n";
+
+	buffer.write(header);
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		buffer.write(&vertices[i].m_position, sizeof(vertices[i].m_position));
+		buffer.write(&vertices[i].m_normal, sizeof(vertices[i].m_normal));
+
+		if (!uvs.empty())
+		{
+			buffer.write(&uvs[i], sizeof(uvs[i]));
+		}
+	}
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		buffer.writeValue(static_cast<uint8_t>(3));
+		buffer.write(&indices[i], 3 * sizeof(int));
+	}
+
+	return true;
+}
+
+bool MeshWriter::writeOBJ(const Mesh& mesh, WriteBuffer& buffer)
+{
+	const std::vector<Vertex>& vertices = mesh.getVertices();
+	const std::vector<int>& indices = mesh.getIndices();
+	const std::vector<glm::vec2>& uvs = mesh.getUVs();
+
+	buffer.write(std::string("# exported by Terrain Generator\n"));
+
+	writeLines(static_cast<int>(vertices.size()), [&vertices](std::string& text, int line)
+	{
+		const glm::vec3& position = vertices[line].m_position;
+
+		text += "v ";
+		appendFloat(text, position.x);
+		text += ' ';
+		appendFloat(text, position.y);
+		text += ' ';
+		appendFloat(text, position.z);
+		text += '\n';
+	}, buffer);
+
+	writeLines(static_cast<int>(vertices.size()), [&vertices](std::string& text, int line)
+	{
+		const glm::vec3& normal = vertices[line].m_normal;
+
+		text += "vn ";
+		appendFloat(text, normal.x);
+		text += ' ';
+		appendFloat(text, normal.y);
+		text += ' ';
+		appendFloat(text, normal.z);
+		text += '\n';
+	}, buffer);
+
+	writeLines(static_cast<int>(uvs.size()), [&uvs](std::string& text, int line)
+	{
+		text += "vt ";
+		appendFloat(text, uvs[line].x);
+		text += ' ';
+		appendFloat(text, uvs[line].y);
+		text += '\n';
+	}, buffer);
+
+	//indices in OBJ files start at 1, every vertex has the normal and texture coordinates with the same index
+
+	bool hasUVs = !uvs.empty();
+
+	writeLines(static_cast<int>(indices.size() / 3), [&indices, hasUVs](std::string& text, int line)
+	{
+		text += 'f';
+
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			int index = indices[3 * line + corner] + 1;
+
+			text += ' ';
+			appendInt(text, index);
+			text += '/';
+			if (hasUVs)
+			{
+				appendInt(text, index);
+			}
+			text += '/';
+			appendInt(text, index);
+		}
+
+		text += '\n';
+	}, buffer);
+
+	return true;
+}
+
+template<typename Function>
+void MeshWriter::writeLines(int count, Function formatLine, WriteBuffer& buffer)
+{
+	int blockCount = (count + OBJ_LINES_PER_BLOCK - 1) / OBJ_LINES_PER_BLOCK;
+	int blocksPerBatch = std::max(QThread::idealThreadCount(), 1) * Parallel::CHUNKS_PER_THREAD;
+
+	//the strings keep their capacity from batch to batch, so formatting doesn't allocate after the first batch
+
+	std::vector<std::string> texts(blocksPerBatch);
+
+	for (int firstBlock = 0; firstBlock < blockCount; firstBlock += blocksPerBatch)
+	{
+		int batchSize = std::min(blocksPerBatch, blockCount - firstBlock);
+
+		Parallel::forRange(batchSize, [&texts, &formatLine, firstBlock, count](int begin, int end)
+		{
+			for (int block = begin; block < end; ++block)
+			{
+				std::string& text = texts[block];
+				text.clear();
+
+				int firstLine = (firstBlock + block) * OBJ_LINES_PER_BLOCK;
+				int lastLine = std::min(firstLine + OBJ_LINES_PER_BLOCK, count);
+
+				for (int line = firstLine; line < lastLine; ++line)
+				{
+					formatLine(text, line);
+				}
+			}
+		});
+
+		for (int block = 0; block < batchSize; ++block)
+		{
+			buffer.write(texts[block]);
+		}
+	}
+}
+
+void MeshWriter::appendFloat(std::string& text, float value)
+{
+	if (!std::isfinite(value))
+	{
+		text += '0';
+		return;
+	}
+
+	uint64_t denominator = 1;
+	for (int i = 0; i < FLOAT_DECIMALS; ++i)
+	{
+		denominator *= 10;
+	}
+
+	double magnitude = std::round(std::fabs(static_cast<double>(value)) * denominator);
+	uint64_t fixedPoint = static_cast<uint64_t>(std::min(magnitude, 9.0e18));
+
+	if (value < 0.0f && fixedPoint != 0)
+	{
+		text += '-';
+	}
+
+	char digits[24];
+	int length = 0;
+
+	uint64_t integerPart = fixedPoint / denominator;
+	do
+	{
+		digits[length++] = static_cast<char>('0' + integerPart % 10);
+		integerPart /= 10;
+	} while (integerPart > 0);
+
+	std::reverse(digits, digits + length);
+	text.append(digits, length);
+
+	uint64_t fraction = fixedPoint % denominator;
+	if (fraction == 0)
+	{
+		return;
+	}
+
+	length = FLOAT_DECIMALS;
+	for (int i = FLOAT_DECIMALS - 1; i >= 0; --i)
+	{
+		digits[i] = static_cast<char>('0' + fraction % 10);
+		fraction /= 10;
+	}
+
+	while (digits[length - 1] == '0')
+	{
+		length--;
+	}
+
+	text += '.';
+	text.append(digits, length);
+}
+
+void MeshWriter::appendInt(std::string& text, int value)
+{
+	if (value < 0)
+	{
+		text += '-';
+	}
+
+	uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+
+	char digits[12];
+	int length = 0;
+
+	do
+	{
+		digits[length++] = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude > 0);
+
+	std::reverse(digits, digits + length);
+	text.append(digits, length);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QSaveFile>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+/** \brief Writes binary STL, binary PLY and OBJ files straight from the buffers of a Mesh.
+*          The data is streamed through one large buffer instead of being copied into an aiScene first,
+*          so no memory is allocated per face. OBJ text is formatted in parallel, block by block.
+*/
+class MeshWriter
+{
+
+public:
+
+	static constexpr size_t WRITE_BUFFER_SIZE = 4 * 1024 * 1024; //!<bytes collected before each write to the file
+	static constexpr int OBJ_LINES_PER_BLOCK = 16384; //!<lines of OBJ text formatted by one task
+
+	//!<true for the export format ids of Assimp that are handled here: "stlb", "plyb", "obj" and "objnomtl"
+	static bool isSupported(const std::string& formatId);
+
+	/** \brief Writes the mesh in one of the supported formats.
+	*          The file is written under a temporary name and only replaces the target once it is complete.
+	*   \return False if the format isn't supported, the mesh is empty or the file couldn't be written.
+	*/
+	static bool save(const Mesh& mesh, const std::string& filename, const std::string& formatId);
+
+private:
+
+	/** \brief Collects small writes and passes them to the file in blocks of WRITE_BUFFER_SIZE.
+	*/
+	class WriteBuffer
+	{
+
+	public:
+
+		explicit WriteBuffer(QSaveFile& file);
+
+		WriteBuffer(const WriteBuffer& other) = delete;
+
+		WriteBuffer(WriteBuffer&& other) = delete;
+
+		WriteBuffer& operator=(const WriteBuffer& other) = delete;
+
+		WriteBuffer& operator=(WriteBuffer&& other) = delete;
+
+		~WriteBuffer() = default;
+
+		void write(const void* data, size_t size);
+
+		void write(const std::string& text);
+
+		template<typename T>
+		void writeValue(T value)
+		{
+			write(&value, sizeof(value));
+		}
+
+		//!<passes the remaining bytes to the file, returns false if any write has failed
+		bool flush();
+
+	private:
+
+		QSaveFile& m_file;
+		std::vector<char> m_buffer;
+		size_t m_size = 0;
+		bool m_failed = false;
+	};
+
+	static constexpr int STL_HEADER_SIZE = 80;
+	static constexpr int FLOAT_DECIMALS = 6; //!<digits after the decimal point in OBJ files
+
+	static bool writeBinarySTL(const Mesh& mesh, WriteBuffer& buffer);
+
+	static bool writeBinaryPLY(const Mesh& mesh, WriteBuffer& buffer);
+
+	static bool writeOBJ(const Mesh& mesh, WriteBuffer& buffer);
+
+	/** \brief Formats count lines in parallel and writes them in order.
+	*          Blocks of lines are formatted a few at a time, so the text of the whole mesh is never held in memory.
+	*   \param formatLine Appends the text of one line to a string.
+	*/
+	template<typename Function>
+	static void writeLines(int count, Function formatLine, WriteBuffer& buffer);
+
+	//!<fixed point without trailing zeros, independent of the locale unlike printf
+	static void appendFloat(std::string& text, float value);
+
+	static void appendInt(std::string& text, int value);
+};
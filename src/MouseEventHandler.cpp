@@ -12,7 +12,18 @@ MouseEventHandler::MouseEventHandler(MyGLWidget* glWidget, QObject* parent)
 
 void MouseEventHandler::init(MyGLWidget* glWidget, float rotationSpeed, float zoomSpeed)
 {
+	if (m_glWidget != nullptr)
+	{
+		disconnect(&m_glWidget->getFrameScheduler(), &FrameScheduler::frameStarted, this, &MouseEventHandler::onFrameStarted);
+	}
+
 	m_glWidget = glWidget;
+
+	if (m_glWidget != nullptr)
+	{
+		connect(&m_glWidget->getFrameScheduler(), &FrameScheduler::frameStarted, this, &MouseEventHandler::onFrameStarted);
+	}
+
 	m_rotationSpeed = rotationSpeed;
 	m_zoomSpeed = zoomSpeed;
 }
@@ -69,16 +80,16 @@ bool MouseEventHandler::eventFilter(QObject* obj, QEvent* event)
 	{
 		QMouseEvent* mouseEvent = static_cast<QMouseEvent*>(event);
 
-		bool change = false;
+		//high rate mice deliver many moves per frame, they are only accumulated here and applied once per frame
 
-		OrbitPerspectiveCamera camera = m_glWidget->getRenderer().getCamera();
+		bool change = false;
 
 		if (m_leftMousePressed == true)
 		{
 			QPointF diff = mouseEvent->pos() - m_lastLeftMousePos;
 			m_lastLeftMousePos = mouseEvent->pos();
 
-			camera.m_orbitCamera.addRotation(glm::vec2(glm::radians(diff.y()) * m_rotationSpeed, glm::radians(diff.x()) * m_rotationSpeed));
+			m_pendingRotation += glm::vec2(glm::radians(diff.y()) * m_rotationSpeed, glm::radians(diff.x()) * m_rotationSpeed);
 			change = true;
 		}
 
@@ -87,14 +98,13 @@ bool MouseEventHandler::eventFilter(QObject* obj, QEvent* event)
 			float diff = mouseEvent->pos().y() - m_lastRightMousePos.y();
 			m_lastRightMousePos = mouseEvent->pos();
 
-			camera.m_orbitCamera.addDistance(diff * m_zoomSpeed);
+			m_pendingDistance += diff * m_zoomSpeed;
 			change = true;
 		}
 
 		if (change == true)
 		{
-			m_glWidget->getRenderer().setCamera(camera);
-			m_glWidget->updateGL();
+			m_glWidget->requestFrame();
 		}
 
 		return true;
@@ -103,3 +113,21 @@ bool MouseEventHandler::eventFilter(QObject* obj, QEvent* event)
 
 	return QObject::eventFilter(obj, event);
 }
+
+void MouseEventHandler::onFrameStarted()
+{
+	if (m_pendingRotation == glm::vec2(0.0f, 0.0f) && m_pendingDistance == 0.0f)
+	{
+		return;
+	}
+
+	OrbitPerspectiveCamera camera = m_glWidget->getRenderer().getCamera();
+
+	camera.m_orbitCamera.addRotation(m_pendingRotation);
+	camera.m_orbitCamera.addDistance(m_pendingDistance);
+
+	m_glWidget->getRenderer().setCamera(camera);
+
+	m_pendingRotation = glm::vec2(0.0f, 0.0f);
+	m_pendingDistance = 0.0f;
+}
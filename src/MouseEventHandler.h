@@ -3,6 +3,8 @@
 #include <QObject>
 #include <QPointF>
 
+#include <glm/glm.hpp>
+
 #include "MyGLWidget.h"
 
 class MouseEventHandler : public QObject
@@ -32,6 +34,11 @@ public:
 
 	bool eventFilter(QObject* obj, QEvent* event) override;
 
+private slots:
+
+	//!<applies the movement accumulated since the previous frame to the camera
+	void onFrameStarted();
+
 private:
 
 	MyGLWidget* m_glWidget = nullptr;
@@ -39,6 +46,8 @@ private:
 	bool m_leftMousePressed = false;
 	QPointF m_lastLeftMousePos;
 	QPointF m_lastRightMousePos;
+	glm::vec2 m_pendingRotation = glm::vec2(0.0f, 0.0f); //!<radians accumulated since the last frame started
+	float m_pendingDistance = 0.0f; //!<zoom accumulated since the last frame started
 
 	float m_rotationSpeed = 0.5f;
 	float m_zoomSpeed = 0.5f;
@@ -2,30 +2,72 @@
 #include "MyGLWidget.h"
 
 MyGLWidget::MyGLWidget(QWidget* parent)
-	: QGLWidget(parent)
+	: QOpenGLWidget(parent)
+	, m_frameScheduler(&m_renderThread)
+	, m_renderer(&m_renderThread)
 {
+	qRegisterMetaType<FrameTimings>("FrameTimings");
 
+	connect(&m_renderThread, &RenderThread::frameReady, this, &MyGLWidget::onFrameReady, Qt::QueuedConnection);
+	connect(this, &QOpenGLWidget::frameSwapped, &m_frameScheduler, &FrameScheduler::onFrameSwapped);
 }
 
-Renderer& MyGLWidget::getRenderer() 
+MyGLWidget::~MyGLWidget()
+{
+	makeCurrent();
+	m_renderThread.stop();
+	doneCurrent();
+}
+
+RendererProxy& MyGLWidget::getRenderer() 
 {
 	return m_renderer;
 }
 
+FrameScheduler& MyGLWidget::getFrameScheduler()
+{
+	return m_frameScheduler;
+}
+
+void MyGLWidget::requestFrame()
+{
+	m_frameScheduler.requestFrame();
+}
+
 void MyGLWidget::initializeGL()
 {
-	m_renderer.init();
+	//function pointers for the blit in paintGL and for texture uploads done by the GUI thread
+	glewInit();
+
+	m_renderThread.init(context());
+
+	requestFrame();
 }
 
 void MyGLWidget::paintGL()
 {
-	int micro = m_renderer.render();
+	qreal pixelRatio = devicePixelRatioF();
 
-	emit renderingFinished(micro / 1000.0f);
+	if (!m_renderThread.present(defaultFramebufferObject(), width() * pixelRatio, height() * pixelRatio))
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
 }
 
 void MyGLWidget::resizeGL(int width, int height)
 {
-	m_renderer.setViewportSize(width, height);
+	qreal pixelRatio = devicePixelRatioF();
+
+	m_renderer.setViewportSize(width * pixelRatio, height * pixelRatio);
+
+	requestFrame();
 }
 
+void MyGLWidget::onFrameReady(const FrameTimings& timings)
+{
+	m_frameScheduler.onFrameRendered();
+
+	update();
+
+	emit renderingFinished(timings);
+}
@@ -2,38 +2,50 @@
 
 #include <GL/glew.h>
 
-#include <QGLWidget>
+#include <QOpenGLWidget>
 
-#include "Renderer.h"
+#include "FrameScheduler.h"
+#include "FrameTimings.h"
+#include "RendererProxy.h"
+#include "RenderThread.h"
 
-class MyGLWidget : public QGLWidget
+/** \brief Shows the frames of a Renderer that runs on its own thread.
+*/
+class MyGLWidget : public QOpenGLWidget
 {
 
     Q_OBJECT
 
 private:
 
-	Renderer m_renderer;
+	RenderThread m_renderThread;
+	FrameScheduler m_frameScheduler;
+	RendererProxy m_renderer;
 
 public:
 
 	explicit MyGLWidget(QWidget* parent = nullptr);
 
-	MyGLWidget(const MyGLWidget& other) = default;
+	MyGLWidget(const MyGLWidget& other) = delete;
 
-	MyGLWidget(MyGLWidget&& other) = default;
+	MyGLWidget(MyGLWidget&& other) = delete;
 
-	MyGLWidget& operator=(const MyGLWidget& other) = default;
+	MyGLWidget& operator=(const MyGLWidget& other) = delete;
 
-	MyGLWidget& operator=(MyGLWidget&& other) = default;
+	MyGLWidget& operator=(MyGLWidget&& other) = delete;
 
-	~MyGLWidget() override = default;
+	~MyGLWidget() override;
 
-	Renderer& getRenderer();
+	RendererProxy& getRenderer();
+
+	FrameScheduler& getFrameScheduler();
+
+	//!<schedules a frame with all state changes submitted until it starts, returns immediately
+	void requestFrame();
 
 signals:
 
-	void renderingFinished(float ms);
+	void renderingFinished(const FrameTimings& timings);
 
 protected:
 
@@ -43,4 +55,8 @@ protected:
 
 	void resizeGL(int width, int heigh) override;
 
+private slots:
+
+	void onFrameReady(const FrameTimings& timings);
+
 };
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+/** \brief Splits index ranges into chunks that are processed on the global thread pool.
+*/
+class Parallel
+{
+
+public:
+
+	static constexpr int CHUNKS_PER_THREAD = 4; //!<more chunks than threads even out chunks that finish early
+
+	/** \brief Calls function(begin, end) for consecutive chunks covering [0, count) and returns when all of them are done.
+	*   \param minChunkSize Chunks aren't made smaller than this, small ranges run on the calling thread.
+	*/
+	template<typename Function>
+	static void forRange(int count, Function function, int minChunkSize = 1)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+
+		int threadCount = std::max(QThread::idealThreadCount(), 1);
+		int chunkCount = std::min(threadCount * CHUNKS_PER_THREAD, (count + minChunkSize - 1) / std::max(minChunkSize, 1));
+
+		if (chunkCount <= 1)
+		{
+			function(0, count);
+			return;
+		}
+
+		std::vector<int> chunks(chunkCount);
+		std::iota(chunks.begin(), chunks.end(), 0);
+
+		QtConcurrent::blockingMap(chunks, [count, chunkCount, &function](int chunk)
+		{
+			int begin = static_cast<int>(static_cast<int64_t>(count) * chunk / chunkCount);
+			int end = static_cast<int>(static_cast<int64_t>(count) * (chunk + 1) / chunkCount);
+			function(begin, end);
+		});
+	}
+};
@@ -0,0 +1,37 @@
+#include "RenderCommandQueue.h"
+
+#include <utility>
+
+bool RenderCommandQueue::push(Command command)
+{
+	size_t tail = m_tail.load(std::memory_order_relaxed);
+	size_t next = (tail + 1) % CAPACITY;
+
+	if (next == m_head.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	m_commands[tail] = std::move(command);
+
+	m_tail.store(next, std::memory_order_release);
+
+	return true;
+}
+
+bool RenderCommandQueue::pop(Command& command)
+{
+	size_t head = m_head.load(std::memory_order_relaxed);
+
+	if (head == m_tail.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	command = std::move(m_commands[head]);
+	m_commands[head] = nullptr;
+
+	m_head.store((head + 1) % CAPACITY, std::memory_order_release);
+
+	return true;
+}
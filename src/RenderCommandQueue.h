@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+class Renderer;
+
+/** \brief Fixed size single producer, single consumer ring of renderer state changes.
+*          The GUI thread pushes and the render thread pops, neither of them ever takes a lock.
+*/
+class RenderCommandQueue
+{
+
+public:
+
+	using Command = std::function<void(Renderer&)>;
+
+	static constexpr size_t CAPACITY = 1024; //!<one slot is always kept free to tell a full ring from an empty one
+
+	RenderCommandQueue() = default;
+
+	RenderCommandQueue(const RenderCommandQueue& other) = delete;
+
+	RenderCommandQueue(RenderCommandQueue&& other) = delete;
+
+	RenderCommandQueue& operator=(const RenderCommandQueue& other) = delete;
+
+	RenderCommandQueue& operator=(RenderCommandQueue&& other) = delete;
+
+	~RenderCommandQueue() = default;
+
+	//!<producer side, returns false if the ring is full
+	bool push(Command command);
+
+	//!<consumer side, returns false if the ring is empty
+	bool pop(Command& command);
+
+private:
+
+	std::array<Command, CAPACITY> m_commands;
+	std::atomic<size_t> m_head{ 0 }; //!<next slot to pop, written only by the consumer
+	std::atomic<size_t> m_tail{ 0 }; //!<next slot to push, written only by the producer
+};
@@ -0,0 +1,285 @@
+#include "RenderThread.h"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <chrono>
+
+#include "Renderer.h"
+
+RenderThread::RenderThread(QObject* parent)
+	: QThread(parent)
+{
+
+}
+
+RenderThread::~RenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_frameRequestMutex);
+		m_stopRequested = true;
+	}
+	m_frameRequestCondition.notify_one();
+
+	wait();
+}
+
+bool RenderThread::init(QOpenGLContext* shareContext)
+{
+	if (isRunning() || shareContext == nullptr)
+	{
+		return false;
+	}
+
+	m_context = std::make_unique<QOpenGLContext>();
+	m_context->setFormat(shareContext->format());
+	m_context->setShareContext(shareContext);
+
+	if (!m_context->create())
+	{
+		m_context = nullptr;
+		return false;
+	}
+
+	//the surface has to be created on the GUI thread, the context is made current on the render thread
+
+	m_surface = std::make_unique<QOffscreenSurface>();
+	m_surface->setFormat(m_context->format());
+	m_surface->create();
+
+	m_context->moveToThread(this);
+
+	start();
+
+	return true;
+}
+
+void RenderThread::submit(RenderCommandQueue::Command command)
+{
+	//the render thread drains the queue before every frame, so a full queue only lasts until it wakes up
+
+	while (!m_commands.push(command))
+	{
+		requestFrame();
+		QThread::yieldCurrentThread();
+	}
+}
+
+void RenderThread::requestFrame()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_frameRequestMutex);
+		m_frameRequested = true;
+	}
+	m_frameRequestCondition.notify_one();
+}
+
+void RenderThread::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_frameRequestMutex);
+		m_stopRequested = true;
+	}
+	m_frameRequestCondition.notify_one();
+
+	wait();
+
+	if (m_presentFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_presentFramebuffer);
+		m_presentFramebuffer = 0;
+	}
+
+	m_surface = nullptr;
+	m_context = nullptr;
+}
+
+bool RenderThread::present(GLuint targetFramebuffer, int width, int height)
+{
+	//take the newest frame if the render thread has published one since the last call
+
+	if (m_readySlot.load(std::memory_order_acquire) & FRESH_FRAME_BIT)
+	{
+		m_presentSlot = m_readySlot.exchange(m_presentSlot, std::memory_order_acq_rel) & ~FRESH_FRAME_BIT;
+	}
+
+	FrameSlot& slot = m_slots[m_presentSlot];
+
+	if (slot.m_texture == 0)
+	{
+		return false;
+	}
+
+	if (slot.m_renderedFence != nullptr)
+	{
+		glWaitSync(slot.m_renderedFence, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(slot.m_renderedFence);
+		slot.m_renderedFence = nullptr;
+	}
+
+	if (m_presentFramebuffer == 0)
+	{
+		glCreateFramebuffers(1, &m_presentFramebuffer);
+	}
+
+	//framebuffers aren't shared between contexts, so the shared texture is attached to one of this context
+
+	glNamedFramebufferTexture(m_presentFramebuffer, GL_COLOR_ATTACHMENT0, slot.m_texture, 0);
+	glBlitNamedFramebuffer(m_presentFramebuffer, targetFramebuffer,
+		0, 0, slot.m_width, slot.m_height,
+		0, 0, width, height,
+		GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	if (slot.m_presentedFence != nullptr)
+	{
+		glDeleteSync(slot.m_presentedFence);
+	}
+	slot.m_presentedFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	return true;
+}
+
+void RenderThread::run()
+{
+	m_context->makeCurrent(m_surface.get());
+
+	{
+		Renderer renderer;
+		renderer.init();
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_frameRequestMutex);
+
+				auto isWoken = [this]() { return m_frameRequested || m_stopRequested; };
+
+				//a mesh upload in flight only becomes visible when a frame is drawn, so keep polling until it has landed
+
+				if (renderer.isUpdatePending())
+				{
+					m_frameRequestCondition.wait_for(lock, std::chrono::milliseconds(UPDATE_POLL_INTERVAL), isWoken);
+				}
+				else
+				{
+					m_frameRequestCondition.wait(lock, isWoken);
+				}
+
+				if (m_stopRequested)
+				{
+					break;
+				}
+
+				m_frameRequested = false;
+			}
+
+			RenderCommandQueue::Command command;
+			while (m_commands.pop(command))
+			{
+				command(renderer);
+			}
+
+			LayeredMaterial::deleteReleasedTextures();
+
+			FrameSlot& slot = m_slots[m_renderSlot];
+			prepareSlot(slot, renderer.getViewportWidth(), renderer.getViewportHeight());
+
+			renderer.setFramebuffer(slot.m_framebuffer);
+			FrameTimings timings = renderer.render();
+
+			slot.m_renderedFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+
+			m_renderSlot = m_readySlot.exchange(m_renderSlot | FRESH_FRAME_BIT, std::memory_order_acq_rel) & ~FRESH_FRAME_BIT;
+
+			emit frameReady(timings);
+		}
+
+		for (FrameSlot& slot : m_slots)
+		{
+			deleteSlot(slot);
+		}
+	}
+
+	//the renderer's material has been destroyed with it
+
+	LayeredMaterial::deleteReleasedTextures();
+
+	m_context->doneCurrent();
+	m_context->moveToThread(QCoreApplication::instance()->thread());
+}
+
+void RenderThread::prepareSlot(FrameSlot& slot, int width, int height) const
+{
+	//the widget may still be copying the previous frame of this slot
+
+	if (slot.m_presentedFence != nullptr)
+	{
+		glWaitSync(slot.m_presentedFence, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(slot.m_presentedFence);
+		slot.m_presentedFence = nullptr;
+	}
+
+	//a frame that was never presented is simply overwritten
+
+	if (slot.m_renderedFence != nullptr)
+	{
+		glDeleteSync(slot.m_renderedFence);
+		slot.m_renderedFence = nullptr;
+	}
+
+	if (slot.m_texture != 0 && slot.m_width == width && slot.m_height == height)
+	{
+		return;
+	}
+
+	if (slot.m_texture != 0)
+	{
+		glDeleteTextures(1, &slot.m_texture);
+		glDeleteRenderbuffers(1, &slot.m_depthBuffer);
+	}
+
+	slot.m_width = std::max(width, 1);
+	slot.m_height = std::max(height, 1);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &slot.m_texture);
+	glTextureStorage2D(slot.m_texture, 1, GL_RGBA8, slot.m_width, slot.m_height);
+
+	glCreateRenderbuffers(1, &slot.m_depthBuffer);
+	glNamedRenderbufferStorage(slot.m_depthBuffer, GL_DEPTH_COMPONENT24, slot.m_width, slot.m_height);
+
+	if (slot.m_framebuffer == 0)
+	{
+		glCreateFramebuffers(1, &slot.m_framebuffer);
+	}
+
+	glNamedFramebufferTexture(slot.m_framebuffer, GL_COLOR_ATTACHMENT0, slot.m_texture, 0);
+	glNamedFramebufferRenderbuffer(slot.m_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, slot.m_depthBuffer);
+}
+
+void RenderThread::deleteSlot(FrameSlot& slot) const
+{
+	if (slot.m_renderedFence != nullptr)
+	{
+		glDeleteSync(slot.m_renderedFence);
+	}
+
+	if (slot.m_presentedFence != nullptr)
+	{
+		glDeleteSync(slot.m_presentedFence);
+	}
+
+	if (slot.m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &slot.m_framebuffer);
+	}
+
+	if (slot.m_texture != 0)
+	{
+		glDeleteTextures(1, &slot.m_texture);
+		glDeleteRenderbuffers(1, &slot.m_depthBuffer);
+	}
+
+	slot = FrameSlot();
+}
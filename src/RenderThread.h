@@ -0,0 +1,112 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <QMetaType>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "FrameTimings.h"
+#include "RenderCommandQueue.h"
+
+Q_DECLARE_METATYPE(FrameTimings)
+
+/** \brief Runs the Renderer in its own GL context on a separate thread.
+*          Frames are rendered on demand into one of three textures shared with the widget's context,
+*          the widget blits the newest finished one, so neither thread ever waits for the other.
+*/
+class RenderThread : public QThread
+{
+
+	Q_OBJECT
+
+public:
+
+	static constexpr int FRAME_SLOT_COUNT = 3;
+	static constexpr int UPDATE_POLL_INTERVAL = 16; //!<milliseconds between frames while a mesh upload is in flight
+
+	explicit RenderThread(QObject* parent = nullptr);
+
+	RenderThread(const RenderThread& other) = delete;
+
+	RenderThread(RenderThread&& other) = delete;
+
+	RenderThread& operator=(const RenderThread& other) = delete;
+
+	RenderThread& operator=(RenderThread&& other) = delete;
+
+	~RenderThread() override;
+
+	/** \brief Creates the render context and starts the thread. Has to be called on the GUI thread.
+	*   \param shareContext Context of the widget that presents the frames.
+	*   \return False if the render context couldn't be created.
+	*/
+	bool init(QOpenGLContext* shareContext);
+
+	//!<queues a state change, it is applied on the render thread before the next requested frame
+	void submit(RenderCommandQueue::Command command);
+
+	//!<wakes the render thread, requests arriving before it starts rendering are merged into one frame
+	void requestFrame();
+
+	/** \brief Stops the thread and releases the presentation resources.
+	*          Has to be called on the GUI thread with the widget's context current.
+	*/
+	void stop();
+
+	/** \brief Copies the newest finished frame into the target framebuffer.
+	*          Has to be called on the GUI thread with the widget's context current.
+	*   \return False if no frame has been finished yet.
+	*/
+	bool present(GLuint targetFramebuffer, int width, int height);
+
+signals:
+
+	void frameReady(const FrameTimings& timings);
+
+protected:
+
+	void run() override;
+
+private:
+
+	struct FrameSlot
+	{
+		GLuint m_texture = 0;
+		GLuint m_depthBuffer = 0;
+		GLuint m_framebuffer = 0; //!<only valid in the render context
+		int m_width = 0;
+		int m_height = 0;
+		GLsync m_renderedFence = nullptr; //!<signaled when the frame in m_texture is complete
+		GLsync m_presentedFence = nullptr; //!<signaled when the widget has finished copying m_texture
+	};
+
+	static constexpr int FRESH_FRAME_BIT = 4; //!<set in m_readySlot while the frame there hasn't been presented
+
+	std::array<FrameSlot, FRAME_SLOT_COUNT> m_slots;
+	int m_renderSlot = 0; //!<owned by the render thread
+	std::atomic<int> m_readySlot{ 1 }; //!<exchanged between the threads
+	int m_presentSlot = 2; //!<owned by the GUI thread
+	GLuint m_presentFramebuffer = 0; //!<only valid in the widget's context
+
+	std::unique_ptr<QOpenGLContext> m_context;
+	std::unique_ptr<QOffscreenSurface> m_surface;
+
+	RenderCommandQueue m_commands;
+
+	std::mutex m_frameRequestMutex;
+	std::condition_variable m_frameRequestCondition;
+	bool m_frameRequested = false;
+	bool m_stopRequested = false;
+
+	void prepareSlot(FrameSlot& slot, int width, int height) const;
+
+	void deleteSlot(FrameSlot& slot) const;
+};
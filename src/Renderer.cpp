@@ -9,6 +9,7 @@
 bool Renderer::m_glewInitialized = false;
 
 Renderer::Renderer()
+	: m_mesh(std::make_shared<Mesh>())
 {
 	std::vector<MaterialLayer> materialLayers = { MaterialLayer(Material(), 1.0f) };
 	m_material.init(materialLayers);
@@ -18,26 +19,15 @@ Renderer::~Renderer()
 {
 	if (m_glewInitialized == false) return;
 
-	if (glIsBuffer(m_terrainVBO))
-	{
-		glDeleteBuffers(1, &m_terrainVBO);
-	}
-
-	if (glIsBuffer(m_terrainEBO))
-	{
-		glDeleteBuffers(1, &m_terrainEBO);
-	}
+	m_terrainBuffer = nullptr;
+	m_pendingTerrainBuffer = nullptr;
+	m_retiredTerrainBuffers.clear();
 
 	if (glIsBuffer(m_depthMapFBO))
 	{
 		glDeleteBuffers(1, &m_depthMapFBO);
 	}
 
-	if (glIsVertexArray(m_terrainVAO))
-	{
-		glDeleteVertexArrays(1, &m_terrainVAO);
-	}
-
 	if (glIsTexture(m_depthMapTextureID))
 	{
 		glDeleteTextures(1, &m_depthMapTextureID);
@@ -61,6 +51,7 @@ void Renderer::init()
 		m_glewInitialized = true;
 
 		createDepthMap();
+		createUniformBuffers();
 	}
 }
 
@@ -101,7 +92,18 @@ void Renderer::setCamera(const OrbitPerspectiveCamera& camera)
 
 void Renderer::setMesh(const Mesh& mesh)
 {
-	m_mesh = mesh;
+	setMesh(std::make_shared<const Mesh>(mesh));
+}
+
+void Renderer::setMesh(std::shared_ptr<const Mesh> mesh)
+{
+	if (mesh == nullptr)
+	{
+		return;
+	}
+
+	m_mesh = std::move(mesh);
+	m_editableMesh = nullptr;
 
 	setLightCamera();
 
@@ -160,42 +162,82 @@ void Renderer::enableShadows(bool shadowsEnabled)
 	m_shadowsEnabled = shadowsEnabled;
 
 	m_needToUpdateShadowUniforms = true;
+	m_needToDrawDepthMap = true;
 }
 
-void Renderer::setMode(GLenum mode) const
+void Renderer::setMode(GLenum mode)
 {
 	if (m_glewInitialized == false) return;
 
 	glPolygonMode(GL_FRONT_AND_BACK, mode);
+
+	//the polygon mode applies to the depth pass as well
+	m_needToDrawDepthMap = true;
 }
 
-int Renderer::render() 
+void Renderer::setFramebuffer(GLuint framebuffer)
 {
-	if (m_glewInitialized == false) return 0;
+	m_framebuffer = framebuffer;
+}
+
+FrameTimings Renderer::render() 
+{
+	FrameTimings timings;
+
+	if (m_glewInitialized == false) return timings;
 
-	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+	using Clock = std::chrono::high_resolution_clock;
+	using Milliseconds = std::chrono::duration<float, std::milli>;
 
+	Clock::time_point frameStart = Clock::now();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	m_uploadTimer.begin();
 	drawSetup();
+	m_uploadTimer.end();
+
+	Clock::time_point uploadEnd = Clock::now();
 
-	if (m_shadowsEnabled)
+	if (m_terrainBuffer != nullptr)
 	{
-		drawDepthMap();
-		drawTerrain();
+		const Mesh& mesh = m_terrainBuffer->getMesh();
+		cullChunks(Frustum(m_camera.getViewProjectionMatrix()), mesh.getBoundingVolumeHierarchy(), mesh.getChunks(), m_terrainDrawCommands);
 	}
-	else
+
+	m_depthMapTimer.begin();
+	if (m_shadowsEnabled && m_needToDrawDepthMap && m_terrainBuffer != nullptr)
 	{
-		drawTerrain();
+		cullChunks(Frustum(m_lightCamera.getViewProjectionMatrix()), 
+			m_terrainBuffer->getDepthMapBoundingVolumeHierarchy(), 
+			m_terrainBuffer->getDepthMapChunks(), 
+			m_depthMapDrawCommands);
+
+		drawDepthMap();
+
+		m_needToDrawDepthMap = false;
 	}
+	m_depthMapTimer.end();
 
-	glFinish();
+	Clock::time_point depthMapEnd = Clock::now();
 
-	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
-	
-	std::chrono::duration<int64_t, std::micro> elapsed = std::chrono::duration_cast<std::chrono::duration<int64_t, std::micro>>(t2 - t1);
+	m_terrainTimer.begin();
+	drawTerrain();
+	m_terrainTimer.end();
+
+	Clock::time_point frameEnd = Clock::now();
+
+	timings.m_upload.m_cpu = Milliseconds(uploadEnd - frameStart).count();
+	timings.m_depthMap.m_cpu = Milliseconds(depthMapEnd - uploadEnd).count();
+	timings.m_terrain.m_cpu = Milliseconds(frameEnd - depthMapEnd).count();
+	timings.m_cpuTotal = Milliseconds(frameEnd - frameStart).count();
+
+	timings.m_upload.m_gpu = m_uploadTimer.getElapsed();
+	timings.m_depthMap.m_gpu = m_depthMapTimer.getElapsed();
+	timings.m_terrain.m_gpu = m_terrainTimer.getElapsed();
 
-	return elapsed.count();
+	return timings;
 }
 
 const DirectionalLight& Renderer::getLight() const
@@ -210,7 +252,7 @@ const OrbitPerspectiveCamera& Renderer::getCamera() const
 
 const Mesh& Renderer::getMesh() const
 {
-	return m_mesh;
+	return *m_mesh;
 }
 
 const LayeredMaterial& Renderer::getMaterial() const
@@ -243,6 +285,21 @@ GLint Renderer::getMode() const
 	return polygonMode;
 }
 
+int Renderer::getViewportWidth() const
+{
+	return m_viewPortWidth;
+}
+
+int Renderer::getViewportHeight() const
+{
+	return m_viewPortHeight;
+}
+
+bool Renderer::isUpdatePending() const
+{
+	return m_pendingTerrainBuffer != nullptr;
+}
+
 bool Renderer::setShaders()
 {
 	if (m_glewInitialized == false) return false;
@@ -290,6 +347,7 @@ bool Renderer::setShaders()
 	}
 
 	m_needToCompileShaders = false;
+	m_needToDrawDepthMap = true;
 
 	return true;
 }
@@ -313,77 +371,119 @@ void Renderer::createDepthMap()
 	glNamedFramebufferReadBuffer(m_depthMapFBO, GL_NONE);
 	
 	m_needToUpdateShadowUniforms = true;
+	m_needToDrawDepthMap = true;
 }
 
-void Renderer::processScene()
+void Renderer::createUniformBuffers()
 {
 	if (m_glewInitialized == false) return;
 
-	if (glIsBuffer(m_terrainVBO))
+	m_materialBlock.create(MaterialBlock::BINDING, sizeof(MaterialBlock));
+	m_lightBlock.create(LightBlock::BINDING, sizeof(LightBlock));
+	m_shadowBlock.create(ShadowBlock::BINDING, sizeof(ShadowBlock));
+
+	m_needToUpdateLightUniforms = true;
+	m_needToUpdateMaterialUniforms = true;
+	m_needToUpdateShadowUniforms = true;
+}
+
+void Renderer::updateMesh(const std::vector<MeshPatch>& patches)
+{
+	if (patches.empty() || !m_mesh->isGrid())
 	{
-		glDeleteBuffers(1, &m_terrainVBO);
+		return;
 	}
 
-	if (glIsBuffer(m_terrainEBO))
+	//the mesh that arrived with setMesh() is shared with the GUI thread, it is copied once and then patched in place,
+	//unless an upload in flight may still be reading the copy
+
+	if (m_editableMesh == nullptr || m_pendingTerrainBuffer != nullptr)
 	{
-		glDeleteBuffers(1, &m_terrainEBO);
+		m_editableMesh = std::make_shared<Mesh>(*m_mesh);
+		m_mesh = m_editableMesh;
 	}
 
-	if (glIsVertexArray(m_terrainVAO))
+	m_editableMesh->applyPatches(patches);
+
+	if (m_pendingTerrainBuffer == nullptr && m_terrainBuffer != nullptr && m_terrainBuffer->updateVertices(m_mesh, patches))
 	{
-		glDeleteVertexArrays(1, &m_terrainVAO);
+		m_needToUpdateMeshUniforms = true;
 	}
-
-	if (m_terrainProgram.isLinked() && !m_mesh.empty())
+	else
 	{
-		const Vertex* vertices = m_mesh.getVertices().data();
-		int verticesSize = m_mesh.getVertices().size();
-		const int* indices = m_mesh.getIndices().data();
-		int indicesSize = m_mesh.getIndices().size();
-		m_terrainIndexCount = indicesSize;
+		m_needToProcessScene = true;
+	}
 
-		glGenVertexArrays(1, &m_terrainVAO);
-		glBindVertexArray(m_terrainVAO);
+	setLightCamera();
+}
 
-		glGenBuffers(1, &m_terrainVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_terrainVBO);
-		glBufferData(GL_ARRAY_BUFFER, verticesSize * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+void Renderer::processScene()
+{
+	if (m_glewInitialized == false) return;
 
-		m_terrainProgram.setVertexAttribPointer("position", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_position)));
-		m_terrainProgram.setVertexAttribPointer("texCoords", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_texCoords)));
-		m_terrainProgram.setVertexAttribPointer("normal", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_normal)));
+	//an upload of an older mesh that is still in flight will never be shown
 
-		m_depthMapProgram.setVertexAttribPointer("position", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_position)));
-		m_depthMapProgram.setVertexAttribPointer("normal", 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<GLvoid*>(offsetof(Vertex, m_normal)));
+	if (m_pendingTerrainBuffer != nullptr)
+	{
+		m_pendingTerrainBuffer->retire();
+		m_retiredTerrainBuffers.push_back(std::move(m_pendingTerrainBuffer));
+	}
 
-		glGenBuffers(1, &m_terrainEBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_terrainEBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indicesSize * sizeof(int), indices, GL_STATIC_DRAW);
+	if (m_terrainProgram.isLinked() && !m_mesh->empty())
+	{
+		std::unique_ptr<MeshBuffer> meshBuffer = std::make_unique<MeshBuffer>();
 
-		glBindVertexArray(0);
+		if (meshBuffer->create(m_mesh, getDepthMapStride(), m_terrainProgram, m_depthMapProgram))
+		{
+			m_pendingTerrainBuffer = std::move(meshBuffer);
+		}
+	}
+	else if (m_terrainBuffer != nullptr)
+	{
+		m_terrainBuffer->retire();
+		m_retiredTerrainBuffers.push_back(std::move(m_terrainBuffer));
 	}
 
 	m_needToProcessScene = false;
 }
 
-void Renderer::updateLightUniforms()
+void Renderer::updateTerrainBuffers()
 {
-	if (m_glewInitialized == false) return;
+	//the previous mesh keeps being drawn until the new one is completely on the GPU
 
-	if (m_terrainProgram.isLinked())
+	if (m_pendingTerrainBuffer != nullptr && m_pendingTerrainBuffer->isResident())
 	{
-		m_terrainProgram.use();
-		m_terrainProgram.setUniform("light.color", 1, m_light.m_color);
-		m_terrainProgram.setUniform("light.direction", 1, m_light.m_direction);
-		m_terrainProgram.setUniform("lightVP", 1, GL_FALSE, m_lightCamera.getViewProjectionMatrix());
-	}
+		if (m_terrainBuffer != nullptr)
+		{
+			m_terrainBuffer->retire();
+			m_retiredTerrainBuffers.push_back(std::move(m_terrainBuffer));
+		}
 
-	if (m_depthMapProgram.isLinked())
-	{
-		m_depthMapProgram.use();
-		m_depthMapProgram.setUniform("vp", 1, GL_FALSE, m_lightCamera.getViewProjectionMatrix());
+		m_terrainBuffer = std::move(m_pendingTerrainBuffer);
+
+		m_needToUpdateMeshUniforms = true;
+		m_needToDrawDepthMap = true;
 	}
 
+	m_retiredTerrainBuffers.erase(
+		std::remove_if(m_retiredTerrainBuffers.begin(), m_retiredTerrainBuffers.end(), [](const std::unique_ptr<MeshBuffer>& meshBuffer)
+		{
+			return meshBuffer->isReleasable();
+		}),
+		m_retiredTerrainBuffers.end());
+}
+
+void Renderer::updateLightUniforms()
+{
+	if (m_glewInitialized == false) return;
+
+	LightBlock lightBlock;
+	lightBlock.m_viewProjection = m_lightCamera.getViewProjectionMatrix();
+	lightBlock.m_direction = m_light.m_direction;
+	lightBlock.m_color = m_light.m_color;
+
+	m_lightBlock.update(lightBlock);
+
 	m_needToUpdateLightUniforms = false;
 }
 
@@ -418,34 +518,31 @@ void Renderer::updateMaterialUniforms()
 			glBindTextureUnit(0, 0);
 		}
 
-		const std::vector<MaterialLayer>& materialLayers = m_material.getMaterialLayers();
-		m_terrainProgram.setUniform("materialCount", static_cast<GLint>(materialLayers.size()));
 		m_terrainProgram.setUniform("diffuseTex", 0);
+	}
 
-		for (int i = 0; i < materialLayers.size(); ++i)
-		{
-			std::string iStr = std::to_string(i);
-
-			const MaterialLayer& materialLayer = materialLayers[i];
-
-			m_terrainProgram.setUniform("materials[" + iStr + "].maxY", materialLayer.m_maxY);
-			m_terrainProgram.setUniform("materials[" + iStr + "].ambient", 1, materialLayer.m_material.m_ambient);
-			m_terrainProgram.setUniform("materials[" + iStr + "].diffuse", 1, materialLayer.m_material.m_diffuse);
-			m_terrainProgram.setUniform("materials[" + iStr + "].specular", 1, materialLayer.m_material.m_specular);
-			m_terrainProgram.setUniform("materials[" + iStr + "].shininess", materialLayer.m_material.m_shininess);
-			m_terrainProgram.setUniform("materials[" + iStr + "].textureScale", 1, materialLayer.m_material.m_textureScale);
-
-			if (materialLayer.m_textureEnabled && m_material.hasTexture(i) && glIsTexture(m_material.getTextureID()))
-			{
-				m_terrainProgram.setUniform("materials[" + iStr + "].hasDiffuseTex", 1);
-			}
-			else
-			{
-				m_terrainProgram.setUniform("materials[" + iStr + "].hasDiffuseTex", 0);
-			}
-		}
+	const std::vector<MaterialLayer>& materialLayers = m_material.getMaterialLayers();
+
+	MaterialBlock materialBlock;
+	materialBlock.m_materialCount = std::min(static_cast<int>(materialLayers.size()), MAX_MATERIAL_LAYERS);
+
+	for (int i = 0; i < materialBlock.m_materialCount; ++i)
+	{
+		const MaterialLayer& materialLayer = materialLayers[i];
+		MaterialUniforms& uniforms = materialBlock.m_materials[i];
+
+		uniforms.m_maxY = materialLayer.m_maxY;
+		uniforms.m_ambient = materialLayer.m_material.m_ambient;
+		uniforms.m_diffuse = materialLayer.m_material.m_diffuse;
+		uniforms.m_specular = materialLayer.m_material.m_specular;
+		uniforms.m_shininess = materialLayer.m_material.m_shininess;
+		uniforms.m_textureScale = glm::vec4(materialLayer.m_material.m_textureScale, 1.0f);
+		uniforms.m_hasDiffuseTex = materialLayer.m_textureEnabled && m_material.hasTexture(i) && glIsTexture(m_material.getTextureID());
+		uniforms.m_textureLayer = std::max(m_material.getTextureLayer(i), 0);
 	}
 
+	m_materialBlock.update(materialBlock);
+
 	m_needToUpdateMaterialUniforms = false;
 }
 
@@ -453,26 +550,21 @@ void Renderer::updateShadowUniforms()
 {
 	if (m_glewInitialized == false) return;
 
+	ShadowBlock shadowBlock;
+	shadowBlock.m_poissonSpread = m_poissonSpread;
+	shadowBlock.m_bias = m_shadowBias;
+	shadowBlock.m_enabled = m_shadowsEnabled && glIsTexture(m_depthMapTextureID);
+
+	m_shadowBlock.update(shadowBlock);
+
 	if (m_terrainProgram.isLinked())
 	{
 		m_terrainProgram.use();
-
 		m_terrainProgram.setUniform("shadowMap", 1);
-		m_terrainProgram.setUniform("poissonSpread", m_poissonSpread);
-		m_terrainProgram.setUniform("shadowBias", m_shadowBias);
-
-		if (m_shadowsEnabled && glIsTexture(m_depthMapTextureID))
-		{
-			m_terrainProgram.setUniform("shadowsEnabled", 1);
-			glBindTextureUnit(1, m_depthMapTextureID);
-		}
-		else
-		{
-			m_terrainProgram.setUniform("shadowsEnabled", 0);
-			glBindTextureUnit(1, 0);
-		}
 	}
 
+	glBindTextureUnit(1, shadowBlock.m_enabled ? m_depthMapTextureID : 0);
+
 	m_needToUpdateShadowUniforms = false;
 }
 
@@ -483,8 +575,9 @@ void Renderer::updateMeshUniforms()
 	if (m_terrainProgram.isLinked())
 	{
 		m_terrainProgram.use();
-		m_terrainProgram.setUniform("minY", m_mesh.getBoundingBox().m_min.y);
-		m_terrainProgram.setUniform("maxY", m_mesh.getBoundingBox().m_max.y);
+		const Mesh& mesh = m_terrainBuffer != nullptr ? m_terrainBuffer->getMesh() : *m_mesh;
+		m_terrainProgram.setUniform("minY", mesh.getBoundingBox().m_min.y);
+		m_terrainProgram.setUniform("maxY", mesh.getBoundingBox().m_max.y);
 	}
 
 	m_needToUpdateMeshUniforms = false;
@@ -510,7 +603,8 @@ void Renderer::updateUniforms()
 
 void Renderer::setLightCamera()
 {
-	float radius = sqrt(pow(sqrt(pow(m_mesh.getBoundingBox().m_size.x, 2.0) + pow(m_mesh.getBoundingBox().m_size.y, 2.0)), 2.0) + pow(m_mesh.getBoundingBox().m_size.z, 2.0)) / 2.0;
+	const AABB& bbox = m_mesh->getBoundingBox();
+	float radius = sqrt(pow(sqrt(pow(bbox.m_size.x, 2.0) + pow(bbox.m_size.y, 2.0)), 2.0) + pow(bbox.m_size.z, 2.0)) / 2.0;
 	glm::vec3 pos = -m_light.m_direction;
 	pos = glm::normalize(pos);
 	pos *= radius;
@@ -522,6 +616,58 @@ void Renderer::setLightCamera()
 	m_lightCamera.m_freeLookCamera.setRotation(m_light.m_direction, lightUp);
 
 	m_needToUpdateLightUniforms = true;
+	m_needToDrawDepthMap = true;
+}
+
+int Renderer::getDepthMapStride() const
+{
+	//triangles smaller than a shadow map texel don't change the depth map, 
+	//so grid cells are merged until they are about as large as one texel
+
+	float gridSpacing = m_mesh->getGridSpacing();
+
+	if (gridSpacing <= 0.0f)
+	{
+		return 1;
+	}
+
+	float texelSize = (m_lightCamera.m_orthoCamera.getRight() - m_lightCamera.m_orthoCamera.getLeft()) / SHADOWMAP_WIDTH;
+
+	int stride = 1;
+	while (stride * 2 * gridSpacing <= texelSize)
+	{
+		stride *= 2;
+	}
+
+	return stride;
+}
+
+void Renderer::cullChunks(const Frustum& frustum, const BoundingVolumeHierarchy& bvh, const std::vector<MeshChunk>& chunks, DrawCommands& drawCommands)
+{
+	drawCommands.m_counts.clear();
+	drawCommands.m_offsets.clear();
+
+	bvh.cull(frustum, m_visibleChunks);
+
+	//chunks are stored back to back in the index buffer, so consecutive visible chunks are merged into one draw
+
+	int end = -1;
+	for (int chunkIndex : m_visibleChunks)
+	{
+		const MeshChunk& chunk = chunks[chunkIndex];
+
+		if (chunk.m_firstIndex == end)
+		{
+			drawCommands.m_counts.back() += chunk.m_indexCount;
+		}
+		else
+		{
+			drawCommands.m_counts.push_back(chunk.m_indexCount);
+			drawCommands.m_offsets.push_back(reinterpret_cast<const GLvoid*>(chunk.m_firstIndex * sizeof(int)));
+		}
+
+		end = chunk.m_firstIndex + chunk.m_indexCount;
+	}
 }
 
 void Renderer::drawSetup()
@@ -536,26 +682,33 @@ void Renderer::drawSetup()
 		processScene();
 	}
 
+	updateTerrainBuffers();
+
 	updateUniforms();
 }
 
 void Renderer::drawTerrain() const
 {
-	if (m_glewInitialized == false || !m_terrainProgram.isLinked() || !glIsVertexArray(m_terrainVAO))
+	if (m_glewInitialized == false || !m_terrainProgram.isLinked() || m_terrainBuffer == nullptr)
 	{
 		return;
 	}
 
 	m_terrainProgram.use();
 
-	glBindVertexArray(m_terrainVAO);
+	glBindVertexArray(m_terrainBuffer->getVAO());
 
-	glDrawElements(GL_TRIANGLES, m_terrainIndexCount, GL_UNSIGNED_INT, NULL);
+	glMultiDrawElements(
+		GL_TRIANGLES, 
+		m_terrainDrawCommands.m_counts.data(), 
+		GL_UNSIGNED_INT, 
+		m_terrainDrawCommands.m_offsets.data(), 
+		m_terrainDrawCommands.m_counts.size());
 }
 
 void Renderer::drawDepthMap() const
 {
-	if (m_glewInitialized == false || !m_depthMapProgram.isLinked() || !glIsVertexArray(m_terrainVAO) || !glIsFramebuffer(m_depthMapFBO))
+	if (m_glewInitialized == false || !m_depthMapProgram.isLinked() || m_terrainBuffer == nullptr || !glIsFramebuffer(m_depthMapFBO))
 	{
 		return;
 	}
@@ -567,11 +720,16 @@ void Renderer::drawDepthMap() const
 	
 	glClear(GL_DEPTH_BUFFER_BIT);
 
-	glBindVertexArray(m_terrainVAO);
+	glBindVertexArray(m_terrainBuffer->getDepthMapVAO());
 
-	glDrawElements(GL_TRIANGLES, m_terrainIndexCount, GL_UNSIGNED_INT, NULL);
+	glMultiDrawElements(
+		GL_TRIANGLES, 
+		m_depthMapDrawCommands.m_counts.data(), 
+		GL_UNSIGNED_INT, 
+		m_depthMapDrawCommands.m_offsets.data(), 
+		m_depthMapDrawCommands.m_counts.size());
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
 
 	glViewport(0, 0, m_viewPortWidth, m_viewPortHeight);
 }
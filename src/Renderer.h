@@ -2,21 +2,29 @@
 
 #include <GL/glew.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "DirectionalLight.h"
+#include "FrameTimings.h"
+#include "Frustum.h"
+#include "GpuTimer.h"
 #include "Material.h"
 #include "Mesh.h"
+#include "MeshBuffer.h"
 #include "OrbitPerspectiveCamera.h"
 #include "FreeLookOrthoCamera.h"
 #include "ShaderProgram.h"
+#include "UniformBlocks.h"
+#include "UniformBuffer.h"
 
 class Renderer
 {
 
 public:
 
-	static constexpr int MAX_MATERIAL_LAYERS = 14;
+	static constexpr int MAX_MATERIAL_LAYERS = MaterialBlock::MAX_MATERIALS;
 
 	Renderer();
 	
@@ -40,6 +48,14 @@ public:
 
 	void setMesh(const Mesh& mesh);
 
+	//!<takes over an immutable mesh without copying it
+	void setMesh(std::shared_ptr<const Mesh> mesh);
+
+	/** \brief Applies patches of an edited heightmap to the current mesh.
+	*          The resident vertex buffer is updated in place, only a mesh whose upload is still in flight is uploaded again.
+	*/
+	void updateMesh(const std::vector<MeshPatch>& patches);
+
 	void setMaterial(const LayeredMaterial& material);
 
 	void setShaders(const std::string& terrainVSSource,
@@ -53,9 +69,15 @@ public:
 
 	void enableShadows(bool shadowsEnabled);
 
-	void setMode(GLenum mode) const;
+	void setMode(GLenum mode);
 
-	int render();
+	//!<framebuffer the frames are drawn into, 0 for the default framebuffer of the current context
+	void setFramebuffer(GLuint framebuffer);
+
+	/** \brief Draws one frame without waiting for the GPU.
+	*   \return CPU times of this frame and the latest available GPU times of each pass.
+	*/
+	FrameTimings render();
 
 	const DirectionalLight& getLight() const;
 
@@ -73,8 +95,21 @@ public:
 
 	GLint getMode() const;
 
+	int getViewportWidth() const;
+
+	int getViewportHeight() const;
+
+	//!<true while a new mesh is being uploaded and will only be shown by a later frame
+	bool isUpdatePending() const;
+
 private:
 
+	struct DrawCommands
+	{
+		std::vector<GLsizei> m_counts;
+		std::vector<const GLvoid*> m_offsets;
+	};
+
 	static bool m_glewInitialized; 
 	bool m_needToCompileShaders = false;
 	bool m_needToProcessScene = false;
@@ -83,9 +118,11 @@ private:
 	bool m_needToUpdateMaterialUniforms = false;
 	bool m_needToUpdateShadowUniforms = false;
 	bool m_needToUpdateMeshUniforms = false;
+	bool m_needToDrawDepthMap = true; //!<the shadow map is only redrawn when the light, the mesh or the depth pass changes
 
-	int m_viewPortWidth;
-	int m_viewPortHeight;
+	int m_viewPortWidth = 0;
+	int m_viewPortHeight = 0;
+	GLuint m_framebuffer = 0;
 
 	LayeredMaterial m_material;
 
@@ -94,11 +131,14 @@ private:
 	DirectionalLight m_light;
 	FreeLookOrthoCamera m_lightCamera;
 
-	Mesh m_mesh;
-	GLuint m_terrainVAO; 
-	GLuint m_terrainVBO; 
-	GLuint m_terrainEBO;
-	int m_terrainIndexCount = 0; 
+	std::shared_ptr<const Mesh> m_mesh; //!<latest mesh, shared with the upload in flight
+	std::shared_ptr<Mesh> m_editableMesh; //!<copy of m_mesh owned by the render thread once it has been patched, otherwise null
+	std::unique_ptr<MeshBuffer> m_terrainBuffer; //!<resident mesh that is being drawn
+	std::unique_ptr<MeshBuffer> m_pendingTerrainBuffer; //!<mesh being uploaded, replaces m_terrainBuffer once resident
+	std::vector<std::unique_ptr<MeshBuffer>> m_retiredTerrainBuffers; //!<buffers waiting for the GPU to finish with them
+	std::vector<int> m_visibleChunks;
+	DrawCommands m_terrainDrawCommands;
+	DrawCommands m_depthMapDrawCommands;
 	std::string m_terrainVSSource;
 	std::string m_terrainFSSource;
 	ShaderProgram m_terrainProgram;
@@ -114,12 +154,24 @@ private:
 	std::string m_depthMapFSSource;
 	ShaderProgram m_depthMapProgram;
 
+	UniformBuffer m_materialBlock;
+	UniformBuffer m_lightBlock;
+	UniformBuffer m_shadowBlock;
+
+	GpuTimer m_uploadTimer;
+	GpuTimer m_depthMapTimer;
+	GpuTimer m_terrainTimer;
+
 	bool setShaders();
 
 	void createDepthMap();
 
+	void createUniformBuffers();
+
 	void processScene();
 
+	void updateTerrainBuffers();
+
 	void updateLightUniforms();
 
 	void updateCameraUniforms();
@@ -134,6 +186,10 @@ private:
 
 	void setLightCamera();
 
+	int getDepthMapStride() const;
+
+	void cullChunks(const Frustum& frustum, const BoundingVolumeHierarchy& bvh, const std::vector<MeshChunk>& chunks, DrawCommands& drawCommands);
+
 	void drawSetup();
 
 	void drawTerrain() const;
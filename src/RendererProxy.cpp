@@ -0,0 +1,205 @@
+#include "RendererProxy.h"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <vector>
+
+#include "Renderer.h"
+#include "RenderThread.h"
+
+RendererProxy::RendererProxy(RenderThread* renderThread)
+	: m_renderThread(renderThread)
+	, m_mesh(std::make_shared<Mesh>())
+{
+	std::vector<MaterialLayer> materialLayers = { MaterialLayer(Material(), 1.0f) };
+	m_material.init(materialLayers);
+}
+
+void RendererProxy::setViewportSize(int width, int height)
+{
+	//the renderer adapts the aspect ratio of its camera, the copy here has to follow
+
+	m_camera.m_perspectiveCamera.setAspect(static_cast<float>(width) / static_cast<float>(std::max(height, 1)));
+
+	m_renderThread->submit([width, height](Renderer& renderer)
+	{
+		renderer.setViewportSize(width, height);
+	});
+}
+
+void RendererProxy::setLight(const DirectionalLight& light)
+{
+	m_light = light;
+
+	m_renderThread->submit([light](Renderer& renderer)
+	{
+		renderer.setLight(light);
+	});
+}
+
+void RendererProxy::setCamera(const OrbitPerspectiveCamera& camera)
+{
+	m_camera = camera;
+
+	m_renderThread->submit([camera](Renderer& renderer)
+	{
+		renderer.setCamera(camera);
+	});
+}
+
+void RendererProxy::setMesh(const Mesh& mesh)
+{
+	std::shared_ptr<const Mesh> sharedMesh = std::make_shared<const Mesh>(mesh);
+	m_mesh = sharedMesh;
+	m_editableMesh = nullptr;
+
+	m_renderThread->submit([sharedMesh](Renderer& renderer)
+	{
+		renderer.setMesh(sharedMesh);
+	});
+}
+
+void RendererProxy::updateMesh(const std::vector<MeshPatch>& patches)
+{
+	if (patches.empty())
+	{
+		return;
+	}
+
+	if (m_editableMesh == nullptr)
+	{
+		m_editableMesh = std::make_shared<Mesh>(*m_mesh);
+		m_mesh = m_editableMesh;
+	}
+
+	m_editableMesh->applyPatches(patches);
+
+	std::shared_ptr<const std::vector<MeshPatch>> sharedPatches = std::make_shared<const std::vector<MeshPatch>>(patches);
+
+	m_renderThread->submit([sharedPatches](Renderer& renderer)
+	{
+		renderer.updateMesh(*sharedPatches);
+	});
+}
+
+void RendererProxy::setMaterial(const LayeredMaterial& material)
+{
+	m_material = material;
+
+	GLsync uploadFence = nullptr;
+
+	if (QOpenGLContext::currentContext() != nullptr && GLEW_ARB_sync)
+	{
+		uploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+
+	m_renderThread->submit([material, uploadFence](Renderer& renderer)
+	{
+		if (uploadFence != nullptr)
+		{
+			glWaitSync(uploadFence, 0, GL_TIMEOUT_IGNORED);
+			glDeleteSync(uploadFence);
+		}
+
+		renderer.setMaterial(material);
+	});
+}
+
+void RendererProxy::setShaders(const std::string& terrainVSSource,
+	const std::string& terrainFSSource,
+	const std::string& depthMapVSSource,
+	const std::string& depthMapFSSource)
+{
+	m_renderThread->submit([terrainVSSource, terrainFSSource, depthMapVSSource, depthMapFSSource](Renderer& renderer)
+	{
+		renderer.setShaders(terrainVSSource, terrainFSSource, depthMapVSSource, depthMapFSSource);
+	});
+}
+
+void RendererProxy::setPoissonSpread(int poissonSpread)
+{
+	if (poissonSpread > 0)
+	{
+		m_poissonSpread = poissonSpread;
+
+		m_renderThread->submit([poissonSpread](Renderer& renderer)
+		{
+			renderer.setPoissonSpread(poissonSpread);
+		});
+	}
+}
+
+void RendererProxy::setShadowBias(float shadowBias)
+{
+	if (shadowBias >= 0.0f)
+	{
+		m_shadowBias = shadowBias;
+
+		m_renderThread->submit([shadowBias](Renderer& renderer)
+		{
+			renderer.setShadowBias(shadowBias);
+		});
+	}
+}
+
+void RendererProxy::enableShadows(bool shadowsEnabled)
+{
+	m_shadowsEnabled = shadowsEnabled;
+
+	m_renderThread->submit([shadowsEnabled](Renderer& renderer)
+	{
+		renderer.enableShadows(shadowsEnabled);
+	});
+}
+
+void RendererProxy::setMode(GLenum mode)
+{
+	m_mode = mode;
+
+	m_renderThread->submit([mode](Renderer& renderer)
+	{
+		renderer.setMode(mode);
+	});
+}
+
+const DirectionalLight& RendererProxy::getLight() const
+{
+	return m_light;
+}
+
+const OrbitPerspectiveCamera& RendererProxy::getCamera() const
+{
+	return m_camera;
+}
+
+const Mesh& RendererProxy::getMesh() const
+{
+	return *m_mesh;
+}
+
+const LayeredMaterial& RendererProxy::getMaterial() const
+{
+	return m_material;
+}
+
+int RendererProxy::getPoissonSpread() const
+{
+	return m_poissonSpread;
+}
+
+float RendererProxy::getShadowBias() const
+{
+	return m_shadowBias;
+}
+
+bool RendererProxy::shadowsEnabled() const
+{
+	return m_shadowsEnabled;
+}
+
+GLint RendererProxy::getMode() const
+{
+	return m_mode;
+}
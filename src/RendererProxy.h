@@ -0,0 +1,95 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DirectionalLight.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "OrbitPerspectiveCamera.h"
+
+class RenderThread;
+
+/** \brief GUI side of the Renderer that lives on the render thread.
+*          Setters keep a copy of the new state for the getters and forward it to the
+*          render thread as a command, so the GUI never waits for a frame.
+*/
+class RendererProxy
+{
+
+public:
+
+	explicit RendererProxy(RenderThread* renderThread);
+
+	RendererProxy(const RendererProxy& other) = delete;
+
+	RendererProxy(RendererProxy&& other) = delete;
+
+	RendererProxy& operator=(const RendererProxy& other) = delete;
+
+	RendererProxy& operator=(RendererProxy&& other) = delete;
+
+	~RendererProxy() = default;
+
+	void setViewportSize(int width, int height);
+
+	void setLight(const DirectionalLight& light);
+
+	void setCamera(const OrbitPerspectiveCamera& camera);
+
+	void setMesh(const Mesh& mesh);
+
+	//!<patches the mesh in place, the render thread only receives the patched vertices
+	void updateMesh(const std::vector<MeshPatch>& patches);
+
+	/** \brief Forwards the material together with the texture data uploaded by the GUI thread.
+	*          If a GL context is current, a fence makes the render thread wait for those uploads.
+	*/
+	void setMaterial(const LayeredMaterial& material);
+
+	void setShaders(const std::string& terrainVSSource,
+		const std::string& terrainFSSource,
+		const std::string& depthMapVSSource,
+		const std::string& depthMapFSSource);
+
+	void setPoissonSpread(int poissonSpread);
+
+	void setShadowBias(float shadowBias);
+
+	void enableShadows(bool shadowsEnabled);
+
+	void setMode(GLenum mode);
+
+	const DirectionalLight& getLight() const;
+
+	const OrbitPerspectiveCamera& getCamera() const;
+
+	const Mesh& getMesh() const;
+
+	const LayeredMaterial& getMaterial() const;
+
+	int getPoissonSpread() const;
+
+	float getShadowBias() const;
+
+	bool shadowsEnabled() const;
+
+	GLint getMode() const;
+
+private:
+
+	RenderThread* m_renderThread = nullptr;
+
+	DirectionalLight m_light;
+	OrbitPerspectiveCamera m_camera;
+	std::shared_ptr<const Mesh> m_mesh; //!<shared with the render thread and never modified, unless it is m_editableMesh
+	std::shared_ptr<Mesh> m_editableMesh; //!<copy of m_mesh owned by the GUI thread once it has been patched, otherwise null
+	LayeredMaterial m_material;
+	int m_poissonSpread = 700;
+	float m_shadowBias = 0.001f;
+	bool m_shadowsEnabled = true;
+	GLint m_mode = GL_FILL;
+};
@@ -1,5 +1,7 @@
 #include "ShaderProgram.h"
 
+#include <algorithm>
+
 ShaderProgram::ShaderProgram(std::initializer_list<Shader> shaders)
 {
 	linkShaders(shaders);
@@ -20,6 +22,8 @@ ShaderProgram::ShaderProgram(ShaderProgram&& other)
 	m_id = other.m_id;
 	m_shaders = std::move(other.m_shaders);
 	m_errorMessage = std::move(other.m_errorMessage);
+	m_uniformLocations = std::move(other.m_uniformLocations);
+	m_attribLocations = std::move(other.m_attribLocations);
 
 	other.m_id = 0;
 }
@@ -48,6 +52,8 @@ ShaderProgram& ShaderProgram::operator=(ShaderProgram&& other)
 	m_id = other.m_id;
 	m_shaders = std::move(other.m_shaders);
 	m_errorMessage = std::move(other.m_errorMessage);
+	m_uniformLocations = std::move(other.m_uniformLocations);
+	m_attribLocations = std::move(other.m_attribLocations);
 
 	other.m_id = 0;
 
@@ -103,10 +109,74 @@ bool ShaderProgram::linkShaders(const std::vector<Shader>& shaders)
 	{
 		m_errorMessage = "";
 
+		cacheLocations();
+
 		return true;
 	}
 }
 
+void ShaderProgram::cacheLocations()
+{
+	m_uniformLocations.clear();
+	m_attribLocations.clear();
+
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	GLint attribMaxNameLength = 0;
+	glGetProgramiv(m_id, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &attribMaxNameLength);
+	std::vector<GLchar> name(std::max(maxNameLength, attribMaxNameLength) + 1);
+
+	GLint uniformCount = 0;
+	glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+	for (GLint i = 0; i < uniformCount; ++i)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_id, i, name.size(), &length, &size, &type, name.data());
+
+		std::string uniformName(name.data(), length);
+		GLint location = glGetUniformLocation(m_id, uniformName.c_str());
+
+		//members of uniform blocks have no location
+		if (location == -1)
+		{
+			continue;
+		}
+
+		m_uniformLocations[uniformName] = location;
+
+		//arrays of basic types are reported as "name[0]", make them reachable as "name" and "name[i]" too
+		size_t bracket = uniformName.size() > 3 ? uniformName.size() - 3 : std::string::npos;
+		if (bracket != std::string::npos && uniformName.compare(bracket, 3, "[0]") == 0)
+		{
+			std::string baseName = uniformName.substr(0, bracket);
+			m_uniformLocations[baseName] = location;
+
+			for (GLint element = 1; element < size; ++element)
+			{
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				m_uniformLocations[elementName] = glGetUniformLocation(m_id, elementName.c_str());
+			}
+		}
+	}
+
+	GLint attribCount = 0;
+	glGetProgramiv(m_id, GL_ACTIVE_ATTRIBUTES, &attribCount);
+
+	for (GLint i = 0; i < attribCount; ++i)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(m_id, i, name.size(), &length, &size, &type, name.data());
+
+		std::string attribName(name.data(), length);
+		m_attribLocations[attribName] = glGetAttribLocation(m_id, attribName.c_str());
+	}
+}
+
 void ShaderProgram::setVertexAttribPointer(
 	const std::string& name, 
 	GLint size, 
@@ -116,6 +186,10 @@ void ShaderProgram::setVertexAttribPointer(
 	const GLvoid* pointer) const
 {
 	GLint location = getAttribLocation(name);
+	if (location == -1)
+	{
+		return;
+	}
 	glEnableVertexAttribArray(location);
 	glVertexAttribPointer(location, size, type, normalized, stride, pointer);
 }
@@ -185,6 +259,8 @@ void ShaderProgram::clear()
 	}
 	m_shaders.clear();
 	m_errorMessage = "";
+	m_uniformLocations.clear();
+	m_attribLocations.clear();
 }
 
 bool ShaderProgram::isLinked() const
@@ -204,10 +280,14 @@ const std::string& ShaderProgram::getErrorMessage() const
 
 GLint ShaderProgram::getAttribLocation(const std::string& name) const
 {
-	return glGetAttribLocation(m_id, name.c_str());
+	auto it = m_attribLocations.find(name);
+
+	return it != m_attribLocations.end() ? it->second : -1;
 }
 
 GLint ShaderProgram::getUniformLocation(const std::string& name) const
 {
-	return glGetUniformLocation(m_id, name.c_str());
+	auto it = m_uniformLocations.find(name);
+
+	return it != m_uniformLocations.end() ? it->second : -1;
 }
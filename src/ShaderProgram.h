@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Shader.h"
@@ -15,6 +17,10 @@ private:
 	GLuint m_id = 0;
 	std::vector<Shader> m_shaders;
 	std::string m_errorMessage;
+	std::unordered_map<std::string, GLint> m_uniformLocations; //!<filled once after linking
+	std::unordered_map<std::string, GLint> m_attribLocations; //!<filled once after linking
+
+	void cacheLocations();
 
 public:
 
@@ -0,0 +1,456 @@
+#include "TextureCompressor.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+const unsigned char TextureCompressor::KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+GLenum TextureCompressor::getPreferredFormat()
+{
+	if (GLEW_EXT_texture_compression_s3tc)
+	{
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	}
+
+	return GL_RGBA8;
+}
+
+TextureImage TextureCompressor::compress(const QImage& image, GLenum internalFormat, bool useCache)
+{
+	QImage sourceImage = image.convertToFormat(QImage::Format_RGBA8888);
+
+	TextureImage textureImage;
+	textureImage.m_internalFormat = internalFormat;
+	textureImage.m_width = sourceImage.width();
+	textureImage.m_height = sourceImage.height();
+
+	if (sourceImage.isNull())
+	{
+		return textureImage;
+	}
+
+	bool compressed = internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+	//uncompressed chains are cheap to rebuild, only the encoded ones are worth the disk space
+
+	QString cachePath;
+	if (compressed && useCache)
+	{
+		cachePath = getCachePath(hashImage(sourceImage, internalFormat));
+		if (readKTX(cachePath, internalFormat, textureImage))
+		{
+			return textureImage;
+		}
+	}
+
+	std::vector<QImage> mipChain = buildMipChain(sourceImage);
+	textureImage.m_levels.resize(mipChain.size());
+
+	for (int i = 0; i < mipChain.size(); ++i)
+	{
+		const QImage& level = mipChain[i];
+
+		if (compressed)
+		{
+			textureImage.m_levels[i] = encodeBC1(level);
+		}
+		else
+		{
+			std::vector<unsigned char>& data = textureImage.m_levels[i];
+			int rowSize = level.width() * 4;
+			data.resize(rowSize * level.height());
+			for (int y = 0; y < level.height(); ++y)
+			{
+				std::memcpy(data.data() + y * rowSize, level.constScanLine(y), rowSize);
+			}
+		}
+	}
+
+	if (!cachePath.isEmpty())
+	{
+		writeKTX(cachePath, textureImage);
+	}
+
+	return textureImage;
+}
+
+std::vector<QImage> TextureCompressor::buildMipChain(const QImage& image)
+{
+	std::vector<QImage> mipChain;
+	mipChain.push_back(image.convertToFormat(QImage::Format_RGBA8888));
+
+	while (mipChain.back().width() > 1 || mipChain.back().height() > 1)
+	{
+		const QImage& source = mipChain.back();
+		int sourceWidth = source.width();
+		int sourceHeight = source.height();
+
+		QImage level(std::max(sourceWidth / 2, 1), std::max(sourceHeight / 2, 1), QImage::Format_RGBA8888);
+		int levelWidth = level.width();
+
+		//take the raw pointers up front, the rows are written from several threads
+
+		const uchar* sourceBits = source.constBits();
+		int sourceStride = source.bytesPerLine();
+		uchar* levelBits = level.bits();
+		int levelStride = level.bytesPerLine();
+
+		std::vector<int> rows(level.height());
+		std::iota(rows.begin(), rows.end(), 0);
+
+		QtConcurrent::blockingMap(rows, [=](int y)
+		{
+			//odd sizes repeat the last row or column instead of reading past the edge
+
+			const uchar* sourceRow0 = sourceBits + std::min(2 * y, sourceHeight - 1) * sourceStride;
+			const uchar* sourceRow1 = sourceBits + std::min(2 * y + 1, sourceHeight - 1) * sourceStride;
+			uchar* levelRow = levelBits + y * levelStride;
+
+			for (int x = 0; x < levelWidth; ++x)
+			{
+				int x0 = std::min(2 * x, sourceWidth - 1) * 4;
+				int x1 = std::min(2 * x + 1, sourceWidth - 1) * 4;
+
+				for (int c = 0; c < 4; ++c)
+				{
+					int sum = sourceRow0[x0 + c] + sourceRow0[x1 + c] + sourceRow1[x0 + c] + sourceRow1[x1 + c];
+					levelRow[x * 4 + c] = static_cast<uchar>((sum + 2) / 4);
+				}
+			}
+		});
+
+		mipChain.push_back(level);
+	}
+
+	return mipChain;
+}
+
+std::vector<unsigned char> TextureCompressor::encodeBC1(const QImage& image)
+{
+	QImage sourceImage = image.convertToFormat(QImage::Format_RGBA8888);
+
+	int width = sourceImage.width();
+	int height = sourceImage.height();
+	int blocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	int blocksY = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	std::vector<unsigned char> blocks(blocksX * blocksY * BC1_BLOCK_BYTES);
+
+	const uchar* sourceBits = sourceImage.constBits();
+	int sourceStride = sourceImage.bytesPerLine();
+	unsigned char* blockBits = blocks.data();
+
+	std::vector<int> blockRows(blocksY);
+	std::iota(blockRows.begin(), blockRows.end(), 0);
+
+	QtConcurrent::blockingMap(blockRows, [=](int blockY)
+	{
+		unsigned char texels[BLOCK_SIZE * BLOCK_SIZE][4];
+
+		for (int blockX = 0; blockX < blocksX; ++blockX)
+		{
+			//blocks overhanging the edge of the image repeat its last texels
+
+			for (int y = 0; y < BLOCK_SIZE; ++y)
+			{
+				const uchar* row = sourceBits + std::min(blockY * BLOCK_SIZE + y, height - 1) * sourceStride;
+				for (int x = 0; x < BLOCK_SIZE; ++x)
+				{
+					std::memcpy(texels[y * BLOCK_SIZE + x], row + std::min(blockX * BLOCK_SIZE + x, width - 1) * 4, 4);
+				}
+			}
+
+			encodeBC1Block(texels, blockBits + (blockY * blocksX + blockX) * BC1_BLOCK_BYTES);
+		}
+	});
+
+	return blocks;
+}
+
+void TextureCompressor::encodeBC1Block(const unsigned char texels[BLOCK_SIZE * BLOCK_SIZE][4], unsigned char* block)
+{
+	const int texelCount = BLOCK_SIZE * BLOCK_SIZE;
+
+	int minColor[3] = { 255, 255, 255 };
+	int maxColor[3] = { 0, 0, 0 };
+	int mean[3] = { 0, 0, 0 };
+
+	for (int i = 0; i < texelCount; ++i)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			minColor[c] = std::min(minColor[c], static_cast<int>(texels[i][c]));
+			maxColor[c] = std::max(maxColor[c], static_cast<int>(texels[i][c]));
+			mean[c] += texels[i][c];
+		}
+	}
+
+	for (int c = 0; c < 3; ++c)
+	{
+		mean[c] /= texelCount;
+	}
+
+	//the endpoints lie on the diagonal of the bounding box that follows the colors best,
+	//channels falling while the channel with the largest range rises get their endpoints swapped
+
+	int axis = 0;
+	for (int c = 1; c < 3; ++c)
+	{
+		if (maxColor[c] - minColor[c] > maxColor[axis] - minColor[axis])
+		{
+			axis = c;
+		}
+	}
+
+	for (int c = 0; c < 3; ++c)
+	{
+		if (c == axis)
+		{
+			continue;
+		}
+
+		int covariance = 0;
+		for (int i = 0; i < texelCount; ++i)
+		{
+			covariance += (texels[i][c] - mean[c]) * (texels[i][axis] - mean[axis]);
+		}
+
+		if (covariance < 0)
+		{
+			std::swap(minColor[c], maxColor[c]);
+		}
+	}
+
+	//pull the endpoints slightly inwards, the extremes are usually outliers
+
+	for (int c = 0; c < 3; ++c)
+	{
+		int inset = (maxColor[c] - minColor[c]) / 16;
+		maxColor[c] -= inset;
+		minColor[c] += inset;
+	}
+
+	uint16_t color0 = toRGB565(maxColor);
+	uint16_t color1 = toRGB565(minColor);
+
+	//the four color mode is selected by color0 > color1
+
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		fromRGB565(color0, palette[0]);
+		fromRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < texelCount; ++i)
+		{
+			int bestIndex = 0;
+			int bestDistance = std::numeric_limits<int>::max();
+
+			for (int p = 0; p < 4; ++p)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					int difference = texels[i][c] - palette[p][c];
+					distance += difference * difference;
+				}
+
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+
+			indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+		}
+	}
+
+	block[0] = color0 & 0xFF;
+	block[1] = color0 >> 8;
+	block[2] = color1 & 0xFF;
+	block[3] = color1 >> 8;
+	block[4] = indices & 0xFF;
+	block[5] = (indices >> 8) & 0xFF;
+	block[6] = (indices >> 16) & 0xFF;
+	block[7] = indices >> 24;
+}
+
+uint64_t TextureCompressor::hashImage(const QImage& image, GLenum internalFormat)
+{
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+
+	auto hashBytes = [&hash, FNV_PRIME](const uchar* bytes, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+	};
+
+	uint32_t description[3] = { static_cast<uint32_t>(image.width()), static_cast<uint32_t>(image.height()), internalFormat };
+	hashBytes(reinterpret_cast<const uchar*>(description), sizeof(description));
+
+	for (int y = 0; y < image.height(); ++y)
+	{
+		hashBytes(image.constScanLine(y), image.width() * 4);
+	}
+
+	return hash;
+}
+
+QString TextureCompressor::getCachePath(uint64_t hash)
+{
+	QDir cacheDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/textures");
+	cacheDir.mkpath(".");
+
+	return cacheDir.filePath(QString::number(hash, 16).rightJustified(16, '0') + ".ktx");
+}
+
+bool TextureCompressor::readKTX(const QString& filename, GLenum internalFormat, TextureImage& textureImage)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	unsigned char identifier[sizeof(KTX_IDENTIFIER)];
+	uint32_t header[KTX_HEADER_FIELDS];
+
+	if (file.read(reinterpret_cast<char*>(identifier), sizeof(identifier)) != sizeof(identifier) ||
+		std::memcmp(identifier, KTX_IDENTIFIER, sizeof(identifier)) != 0 ||
+		file.read(reinterpret_cast<char*>(header), sizeof(header)) != sizeof(header))
+	{
+		return false;
+	}
+
+	uint32_t endianness = header[0];
+	uint32_t fileInternalFormat = header[4];
+	GLsizei width = header[6];
+	GLsizei height = header[7];
+	uint32_t levelCount = header[11];
+	uint32_t keyValueDataSize = header[12];
+
+	if (endianness != KTX_ENDIANNESS || fileInternalFormat != internalFormat ||
+		width != textureImage.m_width || height != textureImage.m_height || levelCount == 0 ||
+		!file.seek(file.pos() + keyValueDataSize))
+	{
+		return false;
+	}
+
+	std::vector<std::vector<unsigned char>> levels(levelCount);
+
+	for (uint32_t i = 0; i < levelCount; ++i)
+	{
+		uint32_t levelSize = 0;
+		if (file.read(reinterpret_cast<char*>(&levelSize), sizeof(levelSize)) != sizeof(levelSize) ||
+			levelSize != static_cast<uint32_t>(getBC1LevelSize(std::max(width >> i, 1), std::max(height >> i, 1))))
+		{
+			return false;
+		}
+
+		levels[i].resize(levelSize);
+		if (file.read(reinterpret_cast<char*>(levels[i].data()), levelSize) != levelSize)
+		{
+			return false;
+		}
+
+		file.seek(file.pos() + 3 - (levelSize + 3) % 4);
+	}
+
+	textureImage.m_levels = std::move(levels);
+
+	return true;
+}
+
+bool TextureCompressor::writeKTX(const QString& filename, const TextureImage& textureImage)
+{
+	//write the whole file under a temporary name first, a half written entry would never be read again
+
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	uint32_t header[KTX_HEADER_FIELDS] = {
+		KTX_ENDIANNESS,
+		0, //glType, 0 for compressed formats
+		1, //glTypeSize
+		0, //glFormat, 0 for compressed formats
+		textureImage.m_internalFormat,
+		GL_RGB, //glBaseInternalFormat
+		static_cast<uint32_t>(textureImage.m_width),
+		static_cast<uint32_t>(textureImage.m_height),
+		0, //pixelDepth
+		0, //numberOfArrayElements
+		1, //numberOfFaces
+		static_cast<uint32_t>(textureImage.m_levels.size()),
+		0 //bytesOfKeyValueData
+	};
+
+	file.write(reinterpret_cast<const char*>(KTX_IDENTIFIER), sizeof(KTX_IDENTIFIER));
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	const char padding[3] = {};
+
+	for (const std::vector<unsigned char>& level : textureImage.m_levels)
+	{
+		uint32_t levelSize = level.size();
+		file.write(reinterpret_cast<const char*>(&levelSize), sizeof(levelSize));
+		file.write(reinterpret_cast<const char*>(level.data()), levelSize);
+		file.write(padding, 3 - (levelSize + 3) % 4);
+	}
+
+	return file.commit();
+}
+
+uint16_t TextureCompressor::toRGB565(const int color[3])
+{
+	uint16_t red = static_cast<uint16_t>((color[0] * 31 + 127) / 255);
+	uint16_t green = static_cast<uint16_t>((color[1] * 63 + 127) / 255);
+	uint16_t blue = static_cast<uint16_t>((color[2] * 31 + 127) / 255);
+
+	return (red << 11) | (green << 5) | blue;
+}
+
+void TextureCompressor::fromRGB565(uint16_t packed, int color[3])
+{
+	int red = (packed >> 11) & 31;
+	int green = (packed >> 5) & 63;
+	int blue = packed & 31;
+
+	color[0] = (red << 3) | (red >> 2);
+	color[1] = (green << 2) | (green >> 4);
+	color[2] = (blue << 3) | (blue >> 2);
+}
+
+int TextureCompressor::getBC1LevelSize(int width, int height)
+{
+	return ((width + BLOCK_SIZE - 1) / BLOCK_SIZE) * ((height + BLOCK_SIZE - 1) / BLOCK_SIZE) * BC1_BLOCK_BYTES;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+#include "TextureImage.h"
+
+/** \brief Builds mip chains for material textures and encodes them into BC1 blocks.
+*          Encoded chains are kept in a disk cache keyed by a hash of the source texels,
+*          so reopening the same textures skips the encoding.
+*/
+class TextureCompressor
+{
+
+public:
+
+	/** \brief Returns the format the textures should be stored in on the current GL implementation.
+	*          Falls back to GL_RGBA8 if S3TC isn't supported. Has to be called after glewInit.
+	*/
+	static GLenum getPreferredFormat();
+
+	/** \brief Builds the mip chain of the image and encodes it into the given format.
+	*   \param image Image in the layout expected by the GPU, as returned by Utility::toTextureFormat.
+	*   \param internalFormat GL_RGBA8 or GL_COMPRESSED_RGB_S3TC_DXT1_EXT.
+	*   \param useCache Look the result up in the disk cache first and store it there if it wasn't found.
+	*/
+	static TextureImage compress(const QImage& image, GLenum internalFormat, bool useCache = true);
+
+	//!<halves the image repeatedly with a box filter down to 1x1, rows of each level are filtered in parallel
+	static std::vector<QImage> buildMipChain(const QImage& image);
+
+	//!<encodes an RGBA8888 image into BC1 blocks of 8 bytes each, rows of blocks are encoded in parallel
+	static std::vector<unsigned char> encodeBC1(const QImage& image);
+
+private:
+
+	static constexpr int BLOCK_SIZE = 4; //!<BC1 encodes blocks of 4x4 texels
+	static constexpr int BC1_BLOCK_BYTES = 8;
+
+	static const unsigned char KTX_IDENTIFIER[12];
+	static constexpr uint32_t KTX_ENDIANNESS = 0x04030201;
+	static constexpr int KTX_HEADER_FIELDS = 13; //!<32-bit fields following the identifier
+
+	static uint16_t toRGB565(const int color[3]);
+
+	static void fromRGB565(uint16_t packed, int color[3]);
+
+	static int getBC1LevelSize(int width, int height);
+
+	static void encodeBC1Block(const unsigned char texels[BLOCK_SIZE * BLOCK_SIZE][4], unsigned char* block);
+
+	//!<64-bit FNV-1a hash of the texels together with the size and the target format
+	static uint64_t hashImage(const QImage& image, GLenum internalFormat);
+
+	static QString getCachePath(uint64_t hash);
+
+	//!<reads a mip chain from a KTX file, returns false if the file is missing or doesn't match
+	static bool readKTX(const QString& filename, GLenum internalFormat, TextureImage& textureImage);
+
+	static bool writeKTX(const QString& filename, const TextureImage& textureImage);
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+//!<mip chain of one texture, ready to be uploaded into a layer of the material's array texture
+struct TextureImage
+{
+	GLenum m_internalFormat = GL_RGBA8; //!<GL_RGBA8 or GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	GLsizei m_width = 0; //!<size of the largest level
+	GLsizei m_height = 0;
+	std::vector<std::vector<unsigned char>> m_levels; //!<largest level first, halved down to 1x1
+};
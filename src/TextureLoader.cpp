@@ -0,0 +1,63 @@
+#include "TextureLoader.h"
+
+#include <QtConcurrent>
+
+#include <numeric>
+
+#include "TextureCompressor.h"
+#include "Utility.h"
+
+ImageCache TextureLoader::m_imageCache;
+
+LoadedTexture TextureLoader::load(const QString& filename, int layerIndex, QVector<QImage> layerImages, const QSize& textureSize, GLenum textureFormat)
+{
+	LoadedTexture texture;
+	texture.m_layerIndex = layerIndex;
+	texture.m_filename = filename;
+	texture.m_image = m_imageCache.load(filename);
+
+	if (texture.m_image.isNull())
+	{
+		return texture;
+	}
+
+	//summing every texel of a large image is slow, a smoothly scaled copy has nearly the same average
+
+	texture.m_averageColor = Utility::getAverageColor(texture.m_image.scaled(
+		AVERAGE_COLOR_SAMPLE_SIZE,
+		AVERAGE_COLOR_SAMPLE_SIZE,
+		Qt::IgnoreAspectRatio,
+		Qt::SmoothTransformation));
+
+	QSize imageSize = texture.m_image.size();
+
+	if (imageSize.width() * imageSize.height() > textureSize.width() * textureSize.height())
+	{
+		//the array texture takes the size of the largest texture, so the others have to be scaled up to it
+
+		texture.m_reallocate = true;
+		texture.m_textureSize = imageSize;
+		texture.m_textureImages.resize(layerImages.size());
+
+		layerImages[layerIndex] = texture.m_image;
+		const QVector<QImage>& images = layerImages;
+
+		std::vector<int> layers(images.size());
+		std::iota(layers.begin(), layers.end(), 0);
+
+		QtConcurrent::blockingMap(layers, [&texture, &images, imageSize, textureFormat](int layer)
+		{
+			if (!images.at(layer).isNull())
+			{
+				texture.m_textureImages[layer] = TextureCompressor::compress(Utility::toTextureFormat(images.at(layer), imageSize), textureFormat);
+			}
+		});
+	}
+	else
+	{
+		texture.m_textureSize = textureSize;
+		texture.m_textureImages.push_back(TextureCompressor::compress(Utility::toTextureFormat(texture.m_image, textureSize), textureFormat));
+	}
+
+	return texture;
+}
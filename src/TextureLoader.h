@@ -0,0 +1,46 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <QColor>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+#include "ImageCache.h"
+#include "TextureImage.h"
+
+//!<texture of one material layer, decoded and prepared for the material's array texture
+struct LoadedTexture
+{
+	int m_layerIndex = 0;
+	QString m_filename;
+	QImage m_image; //!<the decoded file, null if it couldn't be read
+	QColor m_averageColor;
+	QSize m_textureSize; //!<size of the array texture the texture images were prepared for
+	bool m_reallocate = false; //!<the image is larger than the array texture, so m_textureImages holds every layer
+	std::vector<TextureImage> m_textureImages; //!<one for each layer if m_reallocate is set, otherwise only the loaded one
+};
+
+class TextureLoader
+{
+
+public:
+
+	/** \brief Decodes the texture of a material layer and prepares it for the material's array texture.
+	*          Decoded files are cached, so loading the same unmodified file again skips the decoding.
+	*          If the image is larger than the array texture, the textures of all layers are scaled up to it in parallel.
+	*   \param layerImages Source images of all layers, the one of the loaded layer gets replaced.
+	*   \param textureSize Current size of the array texture, empty if it doesn't exist yet.
+	*/
+	static LoadedTexture load(const QString& filename, int layerIndex, QVector<QImage> layerImages, const QSize& textureSize, GLenum textureFormat);
+
+private:
+
+	static constexpr int AVERAGE_COLOR_SAMPLE_SIZE = 64; //!<the average color is taken from a copy scaled to this size
+
+	static ImageCache m_imageCache;
+};
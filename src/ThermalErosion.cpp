@@ -0,0 +1,157 @@
+#include "ThermalErosion.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define THERMALEROSION_USE_SSE2
+#endif
+
+#include "Parallel.h"
+
+Heightmap ThermalErosion::erode(const Heightmap& heightmap, int iterations, float talus)
+{
+	Heightmap source = heightmap;
+
+	if (source.isEmpty() || iterations <= 0)
+	{
+		return source;
+	}
+
+	Heightmap target(source.getWidth(), source.getHeight());
+
+	int tileCountX = (source.getWidth() + TILE_SIZE - 1) / TILE_SIZE;
+	int tileCountY = (source.getHeight() + TILE_SIZE - 1) / TILE_SIZE;
+
+	for (int iteration = 0; iteration < iterations; iteration += TEMPORAL_BLOCK)
+	{
+		int steps = iterations - iteration < TEMPORAL_BLOCK ? iterations - iteration : TEMPORAL_BLOCK;
+
+		Parallel::forRange(tileCountX * tileCountY, [&source, &target, tileCountX, steps, talus](int begin, int end)
+		{
+			std::vector<float> front;
+			std::vector<float> back;
+
+			for (int tile = begin; tile < end; ++tile)
+			{
+				erodeTile(source, target, (tile % tileCountX) * TILE_SIZE, (tile / tileCountX) * TILE_SIZE, steps, talus, front, back);
+			}
+		});
+
+		std::swap(source, target);
+	}
+
+	return source;
+}
+
+void ThermalErosion::erodeTile(const Heightmap& source, Heightmap& target, int beginX, int beginY, int steps, float talus,
+	std::vector<float>& front, std::vector<float>& back)
+{
+	int width = source.getWidth();
+	int height = source.getHeight();
+	int endX = std::min(beginX + TILE_SIZE, width);
+	int endY = std::min(beginY + TILE_SIZE, height);
+
+	//the halo is clipped at the map borders, where the missing neighbours don't exchange material
+
+	int haloBeginX = std::max(beginX - steps, 0);
+	int haloBeginY = std::max(beginY - steps, 0);
+	int localWidth = std::min(endX + steps, width) - haloBeginX;
+	int localHeight = std::min(endY + steps, height) - haloBeginY;
+
+	front.resize(static_cast<size_t>(localWidth) * localHeight);
+	back.resize(front.size());
+
+	for (int row = 0; row < localHeight; ++row)
+	{
+		const float* sourceRow = source.getRow(haloBeginY + row) + haloBeginX;
+		std::copy(sourceRow, sourceRow + localWidth, front.begin() + static_cast<size_t>(row) * localWidth);
+	}
+
+	for (int step = 0; step < steps; ++step)
+	{
+		//samples only stay valid one step closer to the tile than the ones they are computed from
+
+		int margin = steps - 1 - step;
+		int computeBeginX = std::max(beginX - margin, 0) - haloBeginX;
+		int computeEndX = std::min(endX + margin, width) - haloBeginX;
+		int computeBeginY = std::max(beginY - margin, 0) - haloBeginY;
+		int computeEndY = std::min(endY + margin, height) - haloBeginY;
+
+		for (int row = computeBeginY; row < computeEndY; ++row)
+		{
+			const float* center = front.data() + static_cast<size_t>(row) * localWidth;
+			const float* up = row > 0 ? center - localWidth : center;
+			const float* down = row < localHeight - 1 ? center + localWidth : center;
+
+			stepRow(up, center, down, back.data() + static_cast<size_t>(row) * localWidth, computeBeginX, computeEndX, localWidth, talus);
+		}
+
+		std::swap(front, back);
+	}
+
+	for (int row = beginY; row < endY; ++row)
+	{
+		const float* localRow = front.data() + static_cast<size_t>(row - haloBeginY) * localWidth + (beginX - haloBeginX);
+		std::copy(localRow, localRow + (endX - beginX), target.getRow(row) + beginX);
+	}
+}
+
+void ThermalErosion::stepRow(const float* up, const float* center, const float* down, float* result, int begin, int end, int width, float talus)
+{
+	//the flow from a neighbour is rate * (max(d - talus, 0) + min(d + talus, 0)) for the height difference d,
+	//it is odd in d, so whatever one sample gains its neighbour loses
+
+	auto flow = [talus](float difference)
+	{
+		return std::max(difference - talus, 0.0f) + std::min(difference + talus, 0.0f);
+	};
+
+	auto stepSample = [&](int col)
+	{
+		float value = center[col];
+		float left = col > 0 ? center[col - 1] : value;
+		float right = col < width - 1 ? center[col + 1] : value;
+
+		result[col] = value + TRANSFER_RATE * ((flow(up[col] - value) + flow(down[col] - value)) + (flow(left - value) + flow(right - value)));
+	};
+
+	int col = begin;
+
+	//the first and last column lack a neighbour, they are left to the scalar path
+
+	for (; col < end && col < 1; ++col)
+	{
+		stepSample(col);
+	}
+
+#ifdef THERMALEROSION_USE_SSE2
+	const __m128 zeros = _mm_setzero_ps();
+	const __m128 taluses = _mm_set1_ps(talus);
+	const __m128 rates = _mm_set1_ps(TRANSFER_RATE);
+
+	auto flows = [zeros, taluses](__m128 differences)
+	{
+		return _mm_add_ps(_mm_max_ps(_mm_sub_ps(differences, taluses), zeros), _mm_min_ps(_mm_add_ps(differences, taluses), zeros));
+	};
+
+	int vectorEnd = std::min(end, width - 1);
+
+	for (; col + 4 <= vectorEnd; col += 4)
+	{
+		__m128 values = _mm_loadu_ps(center + col);
+
+		__m128 sum = _mm_add_ps(
+			_mm_add_ps(flows(_mm_sub_ps(_mm_loadu_ps(up + col), values)), flows(_mm_sub_ps(_mm_loadu_ps(down + col), values))),
+			_mm_add_ps(flows(_mm_sub_ps(_mm_loadu_ps(center + col - 1), values)), flows(_mm_sub_ps(_mm_loadu_ps(center + col + 1), values))));
+
+		_mm_storeu_ps(result + col, _mm_add_ps(values, _mm_mul_ps(rates, sum)));
+	}
+#endif
+
+	for (; col < end; ++col)
+	{
+		stepSample(col);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "Heightmap.h"
+
+/** \brief Thermal erosion, material slides down wherever the slope to a neighbour is steeper than the talus.
+*          Every iteration moves a fixed part of the excess height difference between each pair of neighbouring samples,
+*          which keeps the stencil symmetric, so the total volume is preserved and each sample is updated independently.
+*
+*          Iterations ping-pong between two maps. Several iterations run per tile in thread local buffers that stay in cache,
+*          tiles carry a halo that shrinks by one sample per iteration, so the map is only read and written once per block.
+*/
+class ThermalErosion
+{
+
+public:
+
+	static constexpr int TILE_SIZE = 128;
+	static constexpr int TEMPORAL_BLOCK = 8; //!<iterations run on a tile before it is written back, also the width of its halo
+
+	/** \brief Erodes a copy of the heightmap.
+	*   \param iterations Number of stencil iterations.
+	*   \param talus Height difference between neighbouring samples that is stable, steeper slopes collapse.
+	*   \return The eroded heightmap, the input if it is empty or iterations isn't positive.
+	*/
+	static Heightmap erode(const Heightmap& heightmap, int iterations, float talus);
+
+private:
+
+	static constexpr float TRANSFER_RATE = 0.125f; //!<part of the excess moved per iteration, half of what keeps the four neighbour stencil monotone
+
+	/** \brief Runs the given number of iterations on one tile.
+	*   \param front, back Local buffers of the tile, reused across tiles.
+	*/
+	static void erodeTile(const Heightmap& source, Heightmap& target, int beginX, int beginY, int steps, float talus,
+		std::vector<float>& front, std::vector<float>& back);
+
+	/** \brief Computes columns [begin, end) of one row, neighbours missing at the edges of the row don't exchange material.
+	*   \param up, down The rows above and below, the row itself at the edges of the buffer.
+	*/
+	static void stepRow(const float* up, const float* center, const float* down, float* result, int begin, int end, int width, float talus);
+};
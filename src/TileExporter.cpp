@@ -0,0 +1,172 @@
+#include "TileExporter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QString>
+
+#include <algorithm>
+#include <cstdint>
+
+#include "AssimpIO.h"
+#include "Mesh.h"
+#include "Parallel.h"
+
+bool TileExporter::save(const Heightmap& heightmap, float heightOffset, float heightScale, int columns, int rows, const std::string& filename, const std::string& formatId, const std::string& extension)
+{
+	int width = heightmap.getWidth();
+	int height = heightmap.getHeight();
+
+	if (heightmap.isEmpty() || columns < 1 || rows < 1 || columns > getMaxTileCount(width) || rows > getMaxTileCount(height))
+	{
+		return false;
+	}
+
+	std::string baseName = QFileInfo(QString::fromStdString(filename)).fileName().toStdString();
+
+	std::vector<Tile> tiles(columns * rows);
+
+	for (int row = 0; row < rows; ++row)
+	{
+		for (int column = 0; column < columns; ++column)
+		{
+			Tile& tile = tiles[row * columns + column];
+			tile.m_column = column;
+			tile.m_row = row;
+			tile.m_rect = getTileRect(width, height, columns, rows, column, row);
+			tile.m_filename = getTileFilename(baseName, column, row, extension);
+		}
+	}
+
+	std::string directory = filename.substr(0, filename.size() - baseName.size());
+
+	//every task builds and writes its tiles one after another, a tile's mesh is released before the next one is built
+
+	Parallel::forRange(static_cast<int>(tiles.size()), [&heightmap, &tiles, heightOffset, heightScale, &directory, &formatId](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			Tile& tile = tiles[i];
+
+			Mesh mesh;
+			if (mesh.set(heightmap, tile.m_rect, heightOffset, heightScale))
+			{
+				tile.m_bbox = mesh.getBoundingBox();
+				tile.m_written = AssimpIO::saveMesh(mesh, directory + tile.m_filename, formatId);
+			}
+		}
+	});
+
+	//an incomplete grid is useless without its manifest, so the tiles that were written are removed again
+
+	bool allWritten = std::all_of(tiles.begin(), tiles.end(), [](const Tile& tile)
+	{
+		return tile.m_written;
+	});
+
+	if (!allWritten || !writeManifest(filename + ".json", heightmap, columns, rows, formatId, tiles))
+	{
+		removeTiles(directory, tiles);
+		return false;
+	}
+
+	return true;
+}
+
+HeightmapRect TileExporter::getTileRect(int width, int height, int columns, int rows, int column, int row)
+{
+	//the cells are distributed as evenly as possible, the vertices on the borders belong to both tiles
+
+	auto getBorder = [](int vertexCount, int tileCount, int tile)
+	{
+		return static_cast<int>(static_cast<int64_t>(vertexCount - 1) * tile / tileCount);
+	};
+
+	HeightmapRect rect;
+	rect.m_left = getBorder(width, columns, column);
+	rect.m_top = getBorder(height, rows, row);
+	rect.m_right = getBorder(width, columns, column + 1) + 1;
+	rect.m_bottom = getBorder(height, rows, row + 1) + 1;
+
+	return rect;
+}
+
+int TileExporter::getMaxTileCount(int vertexCount)
+{
+	return std::max(vertexCount - 1, 0);
+}
+
+std::string TileExporter::getTileFilename(const std::string& baseName, int column, int row, const std::string& extension)
+{
+	return baseName + "_" + std::to_string(column) + "_" + std::to_string(row) + "." + extension;
+}
+
+void TileExporter::removeTiles(const std::string& directory, const std::vector<Tile>& tiles)
+{
+	for (const Tile& tile : tiles)
+	{
+		if (tile.m_written)
+		{
+			QFile::remove(QString::fromStdString(directory + tile.m_filename));
+		}
+	}
+}
+
+bool TileExporter::writeManifest(const std::string& filename, const Heightmap& heightmap, int columns, int rows, const std::string& formatId, const std::vector<Tile>& tiles)
+{
+	auto toJson = [](const glm::vec3& vector)
+	{
+		QJsonArray array;
+		array.append(vector.x);
+		array.append(vector.y);
+		array.append(vector.z);
+		return array;
+	};
+
+	//the rectangles are written with inclusive right and bottom edges, the indices of the last vertex column and row
+
+	QJsonArray tileArray;
+
+	for (const Tile& tile : tiles)
+	{
+		QJsonObject tileObject;
+		tileObject["column"] = tile.m_column;
+		tileObject["row"] = tile.m_row;
+		tileObject["file"] = QString::fromStdString(tile.m_filename);
+		tileObject["left"] = tile.m_rect.m_left;
+		tileObject["top"] = tile.m_rect.m_top;
+		tileObject["right"] = tile.m_rect.m_right - 1;
+		tileObject["bottom"] = tile.m_rect.m_bottom - 1;
+		tileObject["bboxMin"] = toJson(tile.m_bbox.m_min);
+		tileObject["bboxMax"] = toJson(tile.m_bbox.m_max);
+		tileArray.append(tileObject);
+	}
+
+	QJsonObject manifest;
+	manifest["version"] = MANIFEST_VERSION;
+	manifest["format"] = QString::fromStdString(formatId);
+	manifest["heightmapWidth"] = heightmap.getWidth();
+	manifest["heightmapHeight"] = heightmap.getHeight();
+	manifest["columns"] = columns;
+	manifest["rows"] = rows;
+	manifest["tiles"] = tileArray;
+
+	QSaveFile file(QString::fromStdString(filename));
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	QByteArray json = QJsonDocument(manifest).toJson();
+
+	if (file.write(json) != json.size())
+	{
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AABB.h"
+#include "Heightmap.h"
+
+/** \brief Exports the mesh of a heightmap as a grid of tiles, one file per tile, and a manifest describing the grid.
+*          Neighbouring tiles share their edge vertices and are placed and lit like the mesh of the whole heightmap,
+*          so they join without seams. The tiles are built and written on the worker threads one at a time per thread,
+*          so the memory needed is bounded by the number of threads instead of the size of the terrain.
+*/
+class TileExporter
+{
+
+public:
+
+	static constexpr int MANIFEST_VERSION = 1;
+
+	/** \brief Splits the grid of the heightmap's vertices into columns x rows tiles and writes them next to the manifest.
+	*   \param heightOffset y of a vertex with height 0, like the grid mapping of the displayed mesh or Mesh::getDefaultHeightMapping().
+	*   \param heightScale y units per unit of height.
+	*   \param filename Path of the manifest without extension, tiles are named <filename>_<column>_<row>.<extension>
+	*                   and the manifest <filename>.json.
+	*   \param formatId Export format of the tiles, one of AssimpIO::getExportFormats().
+	*   \param extension File extension of the format.
+	*   \return False if a tile would be smaller than one cell or any of the files couldn't be written,
+	*           the tiles written until then are removed again.
+	*/
+	static bool save(const Heightmap& heightmap, float heightOffset, float heightScale, int columns, int rows, const std::string& filename, const std::string& formatId, const std::string& extension);
+
+	/** \brief Returns the rectangle of grid vertices of a tile.
+	*          Its right and bottom edge are the left and top edge of the next tiles, so every tile has one more vertex than cells.
+	*/
+	static HeightmapRect getTileRect(int width, int height, int columns, int rows, int column, int row);
+
+	//!<largest number of tiles along an axis of the given number of vertices, every tile needs at least one cell
+	static int getMaxTileCount(int vertexCount);
+
+private:
+
+	struct Tile
+	{
+		int m_column = 0;
+		int m_row = 0;
+		HeightmapRect m_rect;
+		std::string m_filename; //!<relative to the manifest
+		AABB m_bbox;
+		bool m_written = false;
+	};
+
+	static std::string getTileFilename(const std::string& baseName, int column, int row, const std::string& extension);
+
+	//!<deletes the files of the tiles that have been written
+	static void removeTiles(const std::string& directory, const std::vector<Tile>& tiles);
+
+	static bool writeManifest(const std::string& filename, const Heightmap& heightmap, int columns, int rows, const std::string& formatId, const std::vector<Tile>& tiles);
+};
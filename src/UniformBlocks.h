@@ -0,0 +1,54 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+//std140 mirrors of the uniform blocks declared in the shaders, 
+//every member is 4 or 16 bytes wide so the C++ layout matches without hidden padding
+
+struct MaterialUniforms
+{
+	glm::vec4 m_ambient;
+	glm::vec4 m_diffuse;
+	glm::vec4 m_specular;
+	glm::vec4 m_textureScale;
+	GLint m_shininess = 0;
+	GLint m_hasDiffuseTex = 0;
+	GLfloat m_maxY = 1.0f; //!<upper bound of the layer relative to the height of the mesh (0-1)
+	GLint m_textureLayer = 0; //!<slot of the layer's texture in the array texture
+};
+
+struct MaterialBlock
+{
+	static constexpr GLuint BINDING = 0;
+	static constexpr int MAX_MATERIALS = 14;
+
+	MaterialUniforms m_materials[MAX_MATERIALS];
+	GLint m_materialCount = 0; //!<the actual number of materials in the array
+	GLint m_padding[3] = {};
+};
+
+struct LightBlock
+{
+	static constexpr GLuint BINDING = 1;
+
+	glm::mat4 m_viewProjection; //!<light-space view-projection used for the shadow map
+	glm::vec4 m_direction;
+	glm::vec4 m_color;
+};
+
+struct ShadowBlock
+{
+	static constexpr GLuint BINDING = 2;
+
+	GLint m_enabled = 0;
+	GLint m_poissonSpread = 0;
+	GLfloat m_bias = 0.0f;
+	GLfloat m_padding = 0.0f;
+};
+
+static_assert(sizeof(MaterialUniforms) == 80, "MaterialUniforms doesn't match the std140 layout");
+static_assert(sizeof(MaterialBlock) == 14 * 80 + 16, "MaterialBlock doesn't match the std140 layout");
+static_assert(sizeof(LightBlock) == 96, "LightBlock doesn't match the std140 layout");
+static_assert(sizeof(ShadowBlock) == 16, "ShadowBlock doesn't match the std140 layout");
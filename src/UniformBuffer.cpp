@@ -0,0 +1,43 @@
+#include "UniformBuffer.h"
+
+UniformBuffer::~UniformBuffer()
+{
+	if (m_id != 0 && glIsBuffer(m_id))
+	{
+		glDeleteBuffers(1, &m_id);
+	}
+}
+
+void UniformBuffer::create(GLuint binding, GLsizeiptr size)
+{
+	if (m_id != 0 && glIsBuffer(m_id))
+	{
+		glDeleteBuffers(1, &m_id);
+	}
+
+	m_binding = binding;
+
+	glCreateBuffers(1, &m_id);
+	glNamedBufferStorage(m_id, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_id);
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size) const
+{
+	if (m_id == 0)
+	{
+		return;
+	}
+
+	glNamedBufferSubData(m_id, 0, size, data);
+}
+
+GLuint UniformBuffer::getID() const
+{
+	return m_id;
+}
+
+GLuint UniformBuffer::getBinding() const
+{
+	return m_binding;
+}
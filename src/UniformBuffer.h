@@ -0,0 +1,43 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/** \brief Uniform buffer object bound to a fixed binding point.
+*          The whole block is replaced with a single glNamedBufferSubData call.
+*/
+class UniformBuffer
+{
+
+public:
+
+	UniformBuffer() = default;
+
+	UniformBuffer(const UniformBuffer& other) = delete;
+
+	UniformBuffer(UniformBuffer&& other) = delete;
+
+	UniformBuffer& operator=(const UniformBuffer& other) = delete;
+
+	UniformBuffer& operator=(UniformBuffer&& other) = delete;
+
+	~UniformBuffer();
+
+	void create(GLuint binding, GLsizeiptr size);
+
+	void update(const void* data, GLsizeiptr size) const;
+
+	template<typename T>
+	void update(const T& block) const
+	{
+		update(&block, sizeof(T));
+	}
+
+	GLuint getID() const;
+
+	GLuint getBinding() const;
+
+private:
+
+	GLuint m_id = 0;
+	GLuint m_binding = 0;
+};
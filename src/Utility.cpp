@@ -1,5 +1,18 @@
 #include "Utility.h"
 
+#include <QPainter>
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTILITY_USE_SSE2
+#endif
+
+#include "Parallel.h"
+
 QPixmap Utility::heightmapToQPixmap(const Heightmap& heightmap)
 {
 	if (heightmap.isEmpty())
@@ -7,43 +20,164 @@ QPixmap Utility::heightmapToQPixmap(const Heightmap& heightmap)
 		return QPixmap(0, 0);
 	}
 
-	QImage image(heightmap.getWidth(), heightmap.getHeight(), QImage::Format_ARGB32);
+	return QPixmap::fromImage(heightmapToQImage(heightmap));
+}
+
+Heightmap Utility::QPixmapToHeightmap(const QPixmap& pixmap)
+{
+	if (pixmap.isNull())
+	{
+		return Heightmap();
+	}
 
-	Heightmap convertedHeightmap = heightmap;
-	convertedHeightmap.normalize();
+	return QImageToHeightmap(pixmap.toImage());
+}
 
-	for (int row = 0; row < heightmap.getHeight(); ++row)
+QImage Utility::heightmapToQImage(const Heightmap& heightmap, QImage::Format format)
+{
+	if (heightmap.isEmpty())
 	{
-		for (int col = 0; col < heightmap.getWidth(); ++col)
+		return QImage();
+	}
+
+	int width = heightmap.getWidth();
+	int height = heightmap.getHeight();
+
+	//the image is normalized on the fly, find the range of the heights first
+
+	float min = std::numeric_limits<float>::max();
+	float max = std::numeric_limits<float>::lowest();
+	std::mutex rangeMutex;
+
+	Parallel::forRange(height, [&heightmap, width, &min, &max, &rangeMutex](int begin, int end)
+	{
+		float chunkMin = std::numeric_limits<float>::max();
+		float chunkMax = std::numeric_limits<float>::lowest();
+
+		for (int row = begin; row < end; ++row)
 		{
-			int value = static_cast<int>(convertedHeightmap.at(row, col) * 255);
-			image.setPixelColor(col, row, QColor(value, value, value, 255));
+			const float* heights = heightmap.getRow(row);
+			for (int col = 0; col < width; ++col)
+			{
+				chunkMin = std::min(chunkMin, heights[col]);
+				chunkMax = std::max(chunkMax, heights[col]);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(rangeMutex);
+		min = std::min(min, chunkMin);
+		max = std::max(max, chunkMax);
+	}, MIN_ROWS_PER_CHUNK);
+
+	bool wide = format == QImage::Format_Grayscale16;
+	QImage image(width, height, wide ? QImage::Format_Grayscale16 : QImage::Format_Grayscale8);
+
+	float range = max - min;
+	float scale = (range > 0.0f ? 1.0f / range : 0.0f) * (wide ? 65535.0f : 255.0f);
+
+	//take the raw pointer up front, the rows are written from several threads
+
+	uchar* bits = image.bits();
+	int stride = image.bytesPerLine();
+
+	Parallel::forRange(height, [&heightmap, width, min, scale, wide, bits, stride](int begin, int end)
+	{
+		for (int row = begin; row < end; ++row)
+		{
+			uchar* scanLine = bits + static_cast<size_t>(row) * stride;
+
+			if (wide)
+			{
+				packRow16(heightmap.getRow(row), reinterpret_cast<quint16*>(scanLine), width, min, scale);
+			}
+			else
+			{
+				packRow8(heightmap.getRow(row), scanLine, width, min, scale);
+			}
 		}
+	}, MIN_ROWS_PER_CHUNK);
+
+	return image;
+}
+
+void Utility::updateQPixmap(const Heightmap& heightmap, const std::vector<HeightmapRect>& rects, float min, float max, QPixmap& pixmap)
+{
+	if (pixmap.width() != heightmap.getWidth() || pixmap.height() != heightmap.getHeight())
+	{
+		return;
 	}
 
-	return QPixmap::fromImage(image);
+	float range = max - min;
+	float scale = range > 0.0f ? 255.0f / range : 0.0f;
+
+	//the caller should drop other references to the pixmap first, otherwise the painter detaches a full copy
+
+	QPainter painter(&pixmap);
+
+	for (const HeightmapRect& rect : rects)
+	{
+		int width = rect.m_right - rect.m_left;
+		int height = rect.m_bottom - rect.m_top;
+
+		if (width <= 0 || height <= 0)
+		{
+			continue;
+		}
+
+		QImage image(width, height, QImage::Format_Grayscale8);
+
+		for (int row = 0; row < height; ++row)
+		{
+			packRow8(heightmap.getRow(rect.m_top + row) + rect.m_left, image.scanLine(row), width, min, scale);
+		}
+
+		painter.drawImage(rect.m_left, rect.m_top, image);
+	}
 }
 
-Heightmap Utility::QPixmapToHeightmap(const QPixmap& pixmap)
+Heightmap Utility::QImageToHeightmap(const QImage& image)
 {
 	Heightmap result;
 
-	if (pixmap.isNull())
+	if (image.isNull())
 	{
 		return result;
 	}
 
-	QImage image = pixmap.toImage();
+	//images with more than 8 bits per channel keep their precision, color images are read by their red channel
+
+	bool gray = image.format() == QImage::Format_Grayscale8 || image.format() == QImage::Format_Grayscale16;
+	bool wide = image.format() == QImage::Format_Grayscale16 || image.depth() > 32;
+	QImage::Format format = gray ? image.format() : (wide ? QImage::Format_RGBA64 : QImage::Format_RGBA8888);
+	const QImage convertedImage = image.format() == format ? image : image.convertToFormat(format);
 
-	result.setSize(pixmap.width(), pixmap.height());
+	int width = convertedImage.width();
+	result.setSize(width, convertedImage.height());
 
-	for (int row = 0; row < result.getHeight(); ++row)
+	Parallel::forRange(result.getHeight(), [&result, &convertedImage, width, gray, wide](int begin, int end)
 	{
-		for (int col = 0; col < result.getWidth(); ++col)
+		for (int row = begin; row < end; ++row)
 		{
-			result.at(row, col) = image.pixelColor(col, row).redF();
+			const uchar* pixels = convertedImage.constScanLine(row);
+
+			if (gray && wide)
+			{
+				unpackRow16(reinterpret_cast<const quint16*>(pixels), result.getRow(row), width);
+			}
+			else if (gray)
+			{
+				unpackRow8(pixels, result.getRow(row), width);
+			}
+			else if (wide)
+			{
+				unpackRedRow16(reinterpret_cast<const quint16*>(pixels), result.getRow(row), width);
+			}
+			else
+			{
+				unpackRedRow8(pixels, result.getRow(row), width);
+			}
 		}
-	}
+	}, MIN_ROWS_PER_CHUNK);
 
 	return result;
 }
@@ -85,3 +219,150 @@ QColor Utility::getAverageColor(const QImage& image)
 		green / (image.width() * image.height()), 
 		blue / (image.width() * image.height()));
 }
+
+QImage Utility::toTextureFormat(const QImage& image, const QSize& size)
+{
+	QImage textureImage = image;
+	if (textureImage.size() != size)
+	{
+		textureImage = textureImage.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	}
+
+	return textureImage.convertToFormat(QImage::Format_RGBA8888).mirrored();
+}
+
+void Utility::packRow8(const float* heights, uchar* pixels, int count, float offset, float scale)
+{
+	int i = 0;
+
+#ifdef UTILITY_USE_SSE2
+	const __m128 offsets = _mm_set1_ps(offset);
+	const __m128 scales = _mm_set1_ps(scale);
+	const __m128 halves = _mm_set1_ps(0.5f);
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i values0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + i), offsets), scales), halves));
+		__m128i values1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + i + 4), offsets), scales), halves));
+		__m128i values2 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + i + 8), offsets), scales), halves));
+		__m128i values3 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + i + 12), offsets), scales), halves));
+
+		__m128i words0 = _mm_packs_epi32(values0, values1);
+		__m128i words1 = _mm_packs_epi32(values2, values3);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), _mm_packus_epi16(words0, words1));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		int value = static_cast<int>((heights[i] - offset) * scale + 0.5f);
+		pixels[i] = static_cast<uchar>(std::min(std::max(value, 0), 255));
+	}
+}
+
+void Utility::packRow16(const float* heights, quint16* pixels, int count, float offset, float scale)
+{
+	int i = 0;
+
+#ifdef UTILITY_USE_SSE2
+	const __m128 offsets = _mm_set1_ps(offset);
+	const __m128 scales = _mm_set1_ps(scale);
+	const __m128 halves = _mm_set1_ps(0.5f);
+
+	//SSE2 only packs with signed saturation, so the values are shifted into the signed range and back
+
+	const __m128i signedBias = _mm_set1_epi32(32768);
+	const __m128i signBits = _mm_set1_epi16(static_cast<short>(0x8000));
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i values0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + i), offsets), scales), halves));
+		__m128i values1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + i + 4), offsets), scales), halves));
+
+		__m128i words = _mm_packs_epi32(_mm_sub_epi32(values0, signedBias), _mm_sub_epi32(values1, signedBias));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), _mm_xor_si128(words, signBits));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		int value = static_cast<int>((heights[i] - offset) * scale + 0.5f);
+		pixels[i] = static_cast<quint16>(std::min(std::max(value, 0), 65535));
+	}
+}
+
+void Utility::unpackRow8(const uchar* pixels, float* heights, int count)
+{
+	const float scale = 1.0f / 255.0f;
+
+	int i = 0;
+
+#ifdef UTILITY_USE_SSE2
+	const __m128 scales = _mm_set1_ps(scale);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+		__m128i words0 = _mm_unpacklo_epi8(bytes, zero);
+		__m128i words1 = _mm_unpackhi_epi8(bytes, zero);
+
+		_mm_storeu_ps(heights + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words0, zero)), scales));
+		_mm_storeu_ps(heights + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words0, zero)), scales));
+		_mm_storeu_ps(heights + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words1, zero)), scales));
+		_mm_storeu_ps(heights + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words1, zero)), scales));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		heights[i] = pixels[i] * scale;
+	}
+}
+
+void Utility::unpackRow16(const quint16* pixels, float* heights, int count)
+{
+	const float scale = 1.0f / 65535.0f;
+
+	int i = 0;
+
+#ifdef UTILITY_USE_SSE2
+	const __m128 scales = _mm_set1_ps(scale);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+
+		_mm_storeu_ps(heights + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)), scales));
+		_mm_storeu_ps(heights + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)), scales));
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		heights[i] = pixels[i] * scale;
+	}
+}
+
+void Utility::unpackRedRow8(const uchar* pixels, float* heights, int count)
+{
+	const float scale = 1.0f / 255.0f;
+
+	for (int i = 0; i < count; ++i)
+	{
+		heights[i] = pixels[4 * i] * scale;
+	}
+}
+
+void Utility::unpackRedRow16(const quint16* pixels, float* heights, int count)
+{
+	const float scale = 1.0f / 65535.0f;
+
+	for (int i = 0; i < count; ++i)
+	{
+		heights[i] = pixels[4 * i] * scale;
+	}
+}
@@ -4,6 +4,8 @@
 #include <QPixmap>
 #include <QImage>
 
+#include <vector>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -18,6 +20,21 @@ public:
 
 	static Heightmap QPixmapToHeightmap(const QPixmap& pixmap);
 
+	/** \brief Converts the heightmap into a grayscale image, normalized to the full range of the format.
+	*          Rows are converted in parallel, straight from the heightmap into the scanlines.
+	*   \param format QImage::Format_Grayscale8 or QImage::Format_Grayscale16.
+	*/
+	static QImage heightmapToQImage(const Heightmap& heightmap, QImage::Format format = QImage::Format_Grayscale8);
+
+	/** \brief Redraws only the dirty rectangles of a pixmap created from the heightmap.
+	*   \param min Height that was mapped to black when the whole pixmap was created.
+	*   \param max Height that was mapped to white when the whole pixmap was created.
+	*/
+	static void updateQPixmap(const Heightmap& heightmap, const std::vector<HeightmapRect>& rects, float min, float max, QPixmap& pixmap);
+
+	//!<reads the image as heights in the range 0-1, the red channel of color images, 16-bit images keep their precision
+	static Heightmap QImageToHeightmap(const QImage& image);
+
 	static QString vecToQColorName(glm::vec4 color);
 
 	static QColor vecToQColor(glm::vec4 color);
@@ -25,4 +42,25 @@ public:
 	static glm::vec4 QColorToVec(const QColor& color);
 
 	static QColor getAverageColor(const QImage& image);
+
+	//!<scales the image and converts it to bottom-up RGBA8888 rows as expected by TextureCompressor
+	static QImage toTextureFormat(const QImage& image, const QSize& size);
+
+private:
+
+	static constexpr int MIN_ROWS_PER_CHUNK = 16;
+
+	static void packRow8(const float* heights, uchar* pixels, int count, float offset, float scale);
+
+	static void packRow16(const float* heights, quint16* pixels, int count, float offset, float scale);
+
+	static void unpackRow8(const uchar* pixels, float* heights, int count);
+
+	static void unpackRow16(const quint16* pixels, float* heights, int count);
+
+	//!<red channel of Format_RGBA8888 pixels
+	static void unpackRedRow8(const uchar* pixels, float* heights, int count);
+
+	//!<red channel of Format_RGBA64 pixels
+	static void unpackRedRow16(const quint16* pixels, float* heights, int count);
 };
@@ -3,11 +3,16 @@
 in vec3 position;
 in vec3 normal;
 
-uniform mat4 vp;
+layout(std140, binding = 1) uniform LightBlock
+{
+	mat4 viewProjection;
+	vec4 direction;
+	vec4 color;
+} light;
 
 void main()
 {
     //normal offset shadows
     //http://urho3d.prophpbb.com/topic1991.html
-    gl_Position = vp * vec4(position - normal, 1.0f);
+    gl_Position = light.viewProjection * vec4(position - normal, 1.0f);
 }
@@ -1,24 +1,16 @@
 #version 430
 
+//std140 layout, mirrored by MaterialUniforms in UniformBlocks.h
 struct Material
 {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+	vec4 textureScale;
     int shininess;
-	vec3 textureScale;
-
-	sampler2D diffuseTex;
-
-	bool hasDiffuseTex;
-
+	int hasDiffuseTex;
 	float maxY; //the upper bound of this material's layer in relation to the height of the mesh (the range is 0-1)
-};
-
-struct DirectionalLight
-{
-    vec3 direction;
-    vec3 color;
+	int textureLayer; //the slot of this material's texture in diffuseTex
 };
 
 in vec3 TexCoords;
@@ -29,14 +21,28 @@ in vec3 LightSpacePos;
 
 const int MAX_MATERIALS = 14;
 
+layout(std140, binding = 0) uniform MaterialBlock
+{
+	Material materials[MAX_MATERIALS];
+	int materialCount; //the actual number of materials in the array
+};
+
+layout(std140, binding = 1) uniform LightBlock
+{
+	mat4 viewProjection;
+	vec4 direction;
+	vec4 color;
+} light;
+
+layout(std140, binding = 2) uniform ShadowBlock
+{
+	int enabled;
+	int poissonSpread;
+	float bias;
+} shadow;
+
 uniform sampler2DShadow shadowMap;
-uniform int shadowsEnabled;
-uniform Material materials[MAX_MATERIALS];
 uniform sampler2DArray diffuseTex;
-uniform int materialCount; //the actual number of materials in the array
-uniform DirectionalLight light;
-uniform int poissonSpread;
-uniform float shadowBias;
 
 uniform float minY; //the minimum world-space y-coordinate in the mesh
 uniform float maxY; //the maximum world-space y-coordinate in the mesh
@@ -62,7 +68,7 @@ float calculateVisibility()
 
     for (int i = 0; i < 4; ++i)
     {
-        visibility += texture(shadowMap, shadowCoords + vec3(poissonDisk[i] / poissonSpread, -shadowBias), 0.0);
+        visibility += texture(shadowMap, shadowCoords + vec3(poissonDisk[i] / shadow.poissonSpread, -shadow.bias), 0.0);
     }
 
     visibility /= 4.0;
@@ -74,7 +80,7 @@ void main()
 {
     //calculate shadow
     float visibility = 1.0;
-    if (shadowsEnabled == 1)
+    if (shadow.enabled == 1)
     {
         visibility = calculateVisibility();
     }
@@ -90,21 +96,21 @@ void main()
     }
 
     //calculate the ambient color
-    vec3 ambient = light.color.rgb * materials[index].ambient;
+    vec3 ambient = light.color.rgb * materials[index].ambient.rgb;
   	
     //calculate the diffuse color
     vec3 normal = normalize(Normal);
-    float diffuseCoef = max(dot(normal, -light.direction), 0.0);
-    vec3 diffuse = light.color.rgb * diffuseCoef * materials[index].diffuse;
+    float diffuseCoef = max(dot(normal, -light.direction.xyz), 0.0);
+    vec3 diffuse = light.color.rgb * diffuseCoef * materials[index].diffuse.rgb;
 	diffuse *= visibility;
 	
 	//https://gamedevelopment.tutsplus.com/articles/use-tri-planar-texture-mapping-for-better-terrain--gamedev-13821
     
-	vec3 texCoords = TexCoords / materials[index].textureScale;
+	vec3 texCoords = TexCoords / materials[index].textureScale.xyz;
 
-	vec3 xaxis = vec3(texture(diffuseTex, vec3(texCoords.yz, index)));
-    vec3 yaxis = vec3(texture(diffuseTex, vec3(texCoords.xz, index)));
-    vec3 zaxis = vec3(texture(diffuseTex, vec3(texCoords.xy, index)));
+	vec3 xaxis = vec3(texture(diffuseTex, vec3(texCoords.yz, materials[index].textureLayer)));
+    vec3 yaxis = vec3(texture(diffuseTex, vec3(texCoords.xz, materials[index].textureLayer)));
+    vec3 zaxis = vec3(texture(diffuseTex, vec3(texCoords.xy, materials[index].textureLayer)));
 
 	//blend the results of the 3 planar projections for the current texture
 	vec3 blending = abs(Normal);
@@ -119,9 +125,9 @@ void main()
 
     //calculate the specular color
     vec3 cameraDir = normalize(CameraPos - WorldPos);
-    vec3 reflectDir = reflect(light.direction, normal);  
+    vec3 reflectDir = reflect(light.direction.xyz, normal);  
     float specularCoef = pow(max(dot(cameraDir, reflectDir), 0.0), materials[index].shininess);
-    vec3 specular = light.color.rgb * (specularCoef * materials[index].specular) * visibility; 
+    vec3 specular = light.color.rgb * (specularCoef * materials[index].specular.rgb) * visibility; 
 
     fragColor = vec4(ambient + diffuse + specular, 1.0f);
 }
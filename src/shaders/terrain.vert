@@ -4,8 +4,14 @@ in vec3 position;
 in vec3 normal;
 in vec3 texCoords;
 
+layout(std140, binding = 1) uniform LightBlock
+{
+	mat4 viewProjection;
+	vec4 direction;
+	vec4 color;
+} light;
+
 uniform mat4 cameraVP;
-uniform mat4 lightVP;
 uniform vec3 cameraPos;
 
 out vec3 TexCoords;
@@ -21,5 +27,5 @@ void main()
     CameraPos = cameraPos;
     TexCoords = texCoords;
     Normal = normal;
-    LightSpacePos = vec3(lightVP * vec4(position, 1));
+    LightSpacePos = vec3(light.viewProjection * vec4(position, 1));
 }